@@ -0,0 +1,211 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_track.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+enum class LoopMode
+{
+	once,        // Holds the last keyframe after the end
+	loop         // Wraps around, interpolating from the last keyframe back to the first
+};
+
+// Keyframed tracks with their timing, immutable and shared by all the instances playing it
+// Clip time starts at 0 regardless of the first keyframe time
+class AnimationClip
+{
+  public:
+	AnimationClip(){};
+
+	AnimationClip(TrackTable a_tracks, const std::vector<float> &a_keyframe_times, LoopMode a_loop_mode = LoopMode::loop) :
+		m_tracks(std::move(a_tracks)), m_sampler(a_keyframe_times), m_loop_mode(a_loop_mode)
+	{
+		assert(this->m_tracks.keyframes_count() == a_keyframe_times.size() && "Keyframe times don't match the tracks");
+
+		unsigned int last = this->m_tracks.keyframes_count() - 1;
+
+		this->m_start       = a_keyframe_times.front();
+		this->m_duration    = a_keyframe_times.back() - a_keyframe_times.front();
+		this->m_sample_rate = static_cast<float>(last) / this->m_duration;
+
+		// Clips authored with the last keyframe equal to the first don't need the extra segment
+		this->m_wraps = false;
+		for (unsigned int t = 0; t < this->m_tracks.tracks_count() && !this->m_wraps; ++t)
+			this->m_wraps = !keyframes_equal(this->m_tracks.keyframe(static_cast<int>(t), 0), this->m_tracks.keyframe(static_cast<int>(t), last));
+
+		this->m_loop_duration = this->m_duration + (this->m_wraps ? 1.0f / this->m_sample_rate : 0.0f);
+	}
+
+	const TrackTable &tracks() const
+	{
+		return this->m_tracks;
+	}
+
+	// Time from the first to the last keyframe
+	float duration() const
+	{
+		return this->m_duration;
+	}
+
+	// Length of one cycle when looping, one keyframe interval longer than duration() if the clip wraps around
+	float loop_duration() const
+	{
+		return this->m_loop_duration;
+	}
+
+	// Average keyframes per second
+	float sample_rate() const
+	{
+		return this->m_sample_rate;
+	}
+
+	LoopMode loop_mode() const
+	{
+		return this->m_loop_mode;
+	}
+
+	// a_time must be in [0, loop_duration()], a_cursor is per instance
+	KeyframeSpan sample(float a_time, KeyframeCursor &a_cursor) const
+	{
+		KeyframeSpan span;
+
+		if (this->m_loop_mode == LoopMode::loop && this->m_wraps && a_time >= this->m_duration)
+		{
+			span.m_from = this->m_tracks.keyframes_count() - 1;
+			span.m_to   = 0;
+			span.m_t    = std::min((a_time - this->m_duration) * this->m_sample_rate, 1.0f);
+		}
+		else
+		{
+			this->m_sampler.find(this->m_start + a_time, a_cursor, span.m_from, span.m_t);
+			span.m_to = span.m_from + 1;
+		}
+
+		return span;
+	}
+
+  private:
+	static bool keyframes_equal(const Transform &a_left, const Transform &a_right)
+	{
+		const float epsilon = 1e-5f;
+
+		return std::abs(std::abs(quaternion_dot(a_left.m_rotation, a_right.m_rotation)) - 1.0f) < epsilon &&
+			   std::abs(a_left.m_translation.x - a_right.m_translation.x) < epsilon &&
+			   std::abs(a_left.m_translation.y - a_right.m_translation.y) < epsilon &&
+			   std::abs(a_left.m_translation.z - a_right.m_translation.z) < epsilon &&
+			   std::abs(a_left.m_scale.x - a_right.m_scale.x) < epsilon &&
+			   std::abs(a_left.m_scale.y - a_right.m_scale.y) < epsilon &&
+			   std::abs(a_left.m_scale.z - a_right.m_scale.z) < epsilon;
+	}
+
+	TrackTable      m_tracks;
+	KeyframeSampler m_sampler;
+	LoopMode        m_loop_mode     = LoopMode::loop;
+	float           m_start         = 0.0f;
+	float           m_duration      = 0.0f;
+	float           m_loop_duration = 0.0f;
+	float           m_sample_rate   = 0.0f;
+	bool            m_wraps         = false;
+};
+
+// Per instance playback state of a clip, many players can share one clip
+class AnimationPlayer
+{
+  public:
+	AnimationPlayer(){};
+
+	AnimationPlayer(const AnimationClip *a_clip, float a_time = 0.0f, float a_speed = 1.0f) :
+		m_clip(a_clip), m_speed(a_speed)
+	{
+		this->seek(a_time);
+	}
+
+	const AnimationClip *clip() const
+	{
+		return this->m_clip;
+	}
+
+	float time() const
+	{
+		return this->m_time;
+	}
+
+	float speed() const
+	{
+		return this->m_speed;
+	}
+
+	// Negative speeds play backwards
+	void set_speed(float a_speed)
+	{
+		this->m_speed = a_speed;
+	}
+
+	// Only once clips finish
+	bool finished() const
+	{
+		return this->m_clip->loop_mode() == LoopMode::once && (this->m_speed >= 0.0f ? this->m_time >= this->m_clip->duration() : this->m_time <= 0.0f);
+	}
+
+	// Jumps to a_time, wrapped or clamped according to the loop mode of the clip
+	void seek(float a_time)
+	{
+		if (this->m_clip->loop_mode() == LoopMode::loop)
+		{
+			float period = this->m_clip->loop_duration();
+
+			a_time = std::fmod(a_time, period);
+			if (a_time < 0.0f)
+				a_time += period;
+		}
+		else
+			a_time = std::min(std::max(a_time, 0.0f), this->m_clip->duration());
+
+		this->m_time = a_time;
+	}
+
+	// Moves time forward by a_delta_time seconds of wall clock time scaled by the speed
+	void advance(float a_delta_time)
+	{
+		this->seek(this->m_time + a_delta_time * this->m_speed);
+	}
+
+	// Keyframes and fraction for the current time
+	KeyframeSpan sample()
+	{
+		return this->m_clip->sample(this->m_time, this->m_cursor);
+	}
+
+  private:
+	const AnimationClip *m_clip  = nullptr;
+	float                m_time  = 0.0f;
+	float                m_speed = 1.0f;
+	KeyframeCursor       m_cursor;
+};
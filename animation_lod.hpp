@@ -0,0 +1,209 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "skeleton.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Authoring description of one animation level of detail
+typedef struct
+{
+	float                    m_screen_size;            // Used while the character covers at least this fraction of the viewport height
+	unsigned int             m_update_interval;        // Pose is updated every m_update_interval frames
+	std::vector<std::string> m_dropped;                // Node name patterns to drop with all their descendants, '*' matches anything, like "L_index*" or "*End"
+} AnimationLodLevel;
+
+// Fraction of the viewport height covered by something a_height tall a_distance away from a camera with a_fov_y vertical field of view
+inline float lod_screen_size(float a_height, float a_distance, float a_fov_y)
+{
+	return a_height / (2.0f * a_distance * std::tan(a_fov_y * 0.5f));
+}
+
+// Animation levels of detail of a skeleton, created once at load time
+// Dropped nodes aren't evaluated at all and dropped joints aren't in the palette. Vertices skinned to a dropped joint
+// are remapped to its closest kept ancestor joint, so the dropped subtree follows its parent rigidly in its bind pose
+// Each level has its own compact palette, so palette building and upload costs scale down with the level as well
+class AnimationLod
+{
+  public:
+	AnimationLod(){};
+
+	// a_levels go from the most detailed to the least, with decreasing screen sizes
+	AnimationLod(const Skeleton &a_skeleton, const std::vector<AnimationLodLevel> &a_levels)
+	{
+		assert(!a_levels.empty() && "At least one level is required");
+
+		for (auto &description : a_levels)
+		{
+			assert(description.m_update_interval > 0 && "Update interval must be at least 1");
+
+			Level             level;
+			std::vector<bool> dropped(a_skeleton.size(), false);
+
+			level.m_screen_size     = description.m_screen_size;
+			level.m_update_interval = description.m_update_interval;
+			level.m_joint_remap.resize(a_skeleton.joints_count());
+
+			// Joint index of every node, -1 for non joints
+			std::vector<int> node_joints(a_skeleton.size(), -1);
+
+			for (unsigned int i = 0, joint = 0; i < a_skeleton.size(); ++i)
+			{
+				int parent = a_skeleton.parent(i);
+
+				if (a_skeleton.is_joint(i))
+					node_joints[i] = static_cast<int>(joint++);
+
+				// Parents come first so a dropped parent is already known
+				dropped[i] = parent != -1 && dropped[static_cast<unsigned int>(parent)];
+
+				for (auto &pattern : description.m_dropped)
+					dropped[i] = dropped[i] || matches(a_skeleton.name(i).c_str(), pattern.c_str());
+
+				assert((parent != -1 || !dropped[i]) && "Root nodes can't be dropped");
+
+				if (!dropped[i])
+				{
+					level.m_nodes.push_back(static_cast<uint16_t>(i));
+
+					if (a_skeleton.is_joint(i))
+					{
+						level.m_joint_remap[static_cast<unsigned int>(node_joints[i])] = static_cast<uint16_t>(level.m_joints.size());
+						level.m_joints.push_back(static_cast<uint16_t>(node_joints[i]));
+						level.m_joint_nodes.push_back(static_cast<uint16_t>(i));
+					}
+				}
+				else if (a_skeleton.is_joint(i))
+				{
+					// Closest kept ancestor joint, which is already remapped
+					int ancestor = parent;
+					while (ancestor != -1 && (dropped[static_cast<unsigned int>(ancestor)] || !a_skeleton.is_joint(static_cast<unsigned int>(ancestor))))
+						ancestor = a_skeleton.parent(static_cast<unsigned int>(ancestor));
+
+					assert(ancestor != -1 && "Dropped joints need a kept ancestor joint");
+
+					level.m_joint_remap[static_cast<unsigned int>(node_joints[i])] = level.m_joint_remap[static_cast<unsigned int>(node_joints[static_cast<unsigned int>(ancestor)])];
+				}
+			}
+
+			this->m_levels.push_back(std::move(level));
+		}
+	}
+
+	unsigned int levels_count() const
+	{
+		return static_cast<unsigned int>(this->m_levels.size());
+	}
+
+	// Most detailed level whose screen size a_screen_size still covers, see lod_screen_size
+	unsigned int select(float a_screen_size) const
+	{
+		for (unsigned int i = 0; i < this->m_levels.size(); ++i)
+			if (a_screen_size >= this->m_levels[i].m_screen_size)
+				return i;
+
+		return this->levels_count() - 1;
+	}
+
+	// Whether an instance at a_level should be updated on a_frame, a_instance staggers instances so their updates spread over frames
+	bool needs_update(unsigned int a_level, unsigned int a_frame, unsigned int a_instance = 0) const
+	{
+		return (a_frame + a_instance) % this->m_levels[a_level].m_update_interval == 0;
+	}
+
+	unsigned int update_interval(unsigned int a_level) const
+	{
+		return this->m_levels[a_level].m_update_interval;
+	}
+
+	// Kept nodes, parent before child
+	const std::vector<uint16_t> &nodes(unsigned int a_level) const
+	{
+		return this->m_levels[a_level].m_nodes;
+	}
+
+	// Kept joints in skeleton joint indices, the palette of a level has one entry for each in this order
+	const std::vector<uint16_t> &joints(unsigned int a_level) const
+	{
+		return this->m_levels[a_level].m_joints;
+	}
+
+	// Node of each kept joint
+	const std::vector<uint16_t> &joint_nodes(unsigned int a_level) const
+	{
+		return this->m_levels[a_level].m_joint_nodes;
+	}
+
+	unsigned int joints_count(unsigned int a_level) const
+	{
+		return static_cast<unsigned int>(this->m_levels[a_level].m_joints.size());
+	}
+
+	// Palette entry of a_level used by skeleton joint a_joint
+	unsigned int palette_index(unsigned int a_level, unsigned int a_joint) const
+	{
+		return this->m_levels[a_level].m_joint_remap[a_joint];
+	}
+
+	// Vertex joint indices of a mesh remapped into the compact palette of a_level, a_count indices
+	std::vector<int> remap_vertex_joints(unsigned int a_level, const int *a_joints, unsigned int a_count) const
+	{
+		std::vector<int> joints(a_count);
+
+		for (unsigned int i = 0; i < a_count; ++i)
+			joints[i] = static_cast<int>(this->palette_index(a_level, static_cast<unsigned int>(a_joints[i])));
+
+		return joints;
+	}
+
+  private:
+	typedef struct
+	{
+		float                 m_screen_size;
+		unsigned int          m_update_interval;
+		std::vector<uint16_t> m_nodes;
+		std::vector<uint16_t> m_joints;
+		std::vector<uint16_t> m_joint_nodes;
+		std::vector<uint16_t> m_joint_remap;        // Palette index for every skeleton joint
+	} Level;
+
+	// Glob style matching with '*' only
+	static bool matches(const char *a_name, const char *a_pattern)
+	{
+		if (*a_pattern == '\0')
+			return *a_name == '\0';
+
+		if (*a_pattern == '*')
+			return matches(a_name, a_pattern + 1) || (*a_name != '\0' && matches(a_name + 1, a_pattern));
+
+		return *a_name == *a_pattern && matches(a_name + 1, a_pattern + 1);
+	}
+
+	std::vector<Level> m_levels;
+};
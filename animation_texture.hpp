@@ -0,0 +1,138 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_clip.hpp"
+#include "geometry.hpp"
+#include "palette_cache.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+// Palettes of a BakedClip in a RGBA32F texture for skinning shaders to sample, a row per frame with the three rows of every joint's
+// Matrix3x4 one after the other. Characters drawn with it cost nothing to animate on the CPU, only their clip time changes
+// Like BakedClip it's only right for characters playing the clip on its own without lods
+class AnimationTexture
+{
+  public:
+	AnimationTexture(){};
+
+	// Clips with more frames than GL_MAX_TEXTURE_SIZE rows are resampled down to that many, rigs too wide for a row get no texture, check valid()
+	AnimationTexture(const BakedClip &a_clip) :
+		m_frames_count(a_clip.frames_count()), m_joints_count(a_clip.joints_count()), m_duration(a_clip.duration()), m_loop(a_clip.loop_mode() == LoopMode::loop)
+	{
+		GLint max_size = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+		if (this->m_joints_count * 3 > static_cast<unsigned int>(max_size))
+		{
+			std::printf("GL_MAX_TEXTURE_SIZE of %d texels is too small for the %u texel palettes of %u joints, no animation texture\n",
+						max_size, this->m_joints_count * 3, this->m_joints_count);
+			this->m_frames_count = 0;
+			return;
+		}
+
+		const Matrix3x4       *frames = a_clip.frame(0);
+		std::vector<Matrix3x4> resampled;
+
+		if (this->m_frames_count > static_cast<unsigned int>(max_size))
+		{
+			std::printf("GL_MAX_TEXTURE_SIZE of %d rows only fits %d frames, resampling %u frames to %d\n", max_size, max_size, this->m_frames_count, max_size);
+
+			// Same spacing as BakedClip, the shader only needs the frame count to find the rows
+			this->m_frames_count = static_cast<unsigned int>(max_size);
+			resampled.resize(this->m_frames_count * this->m_joints_count);
+
+			float span = static_cast<float>(this->m_loop ? this->m_frames_count : this->m_frames_count - 1);
+			for (unsigned int i = 0; i < this->m_frames_count; ++i)
+				a_clip.sample(this->m_duration * static_cast<float>(i) / span, resampled.data() + i * this->m_joints_count);
+
+			frames = resampled.data();
+		}
+
+		glGenTextures(1, &this->m_texture);
+		glBindTexture(GL_TEXTURE_2D, this->m_texture);
+
+		// Only read with texelFetch, the shader interpolates between frames itself
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(this->m_joints_count * 3), static_cast<GLsizei>(this->m_frames_count), 0, GL_RGBA, GL_FLOAT,
+					 frames->m_values);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+	}
+
+	AnimationTexture(const AnimationTexture &) = delete;
+	AnimationTexture &operator=(const AnimationTexture &) = delete;
+
+	~AnimationTexture()
+	{
+		if (this->m_texture != -1u)
+			glDeleteTextures(1, &this->m_texture);
+	}
+
+	// a_geometry's draws sample this texture instead of taking palettes, it must outlive the geometry's draws
+	void attach(AnimatedGeometry &a_geometry) const
+	{
+		a_geometry.set_animation_texture(this->m_texture, this->m_frames_count, this->m_duration, this->m_loop);
+	}
+
+	bool valid() const
+	{
+		return this->m_texture != -1u;
+	}
+
+	GLuint texture() const
+	{
+		return this->m_texture;
+	}
+
+	unsigned int frames_count() const
+	{
+		return this->m_frames_count;
+	}
+
+	float duration() const
+	{
+		return this->m_duration;
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_frames_count * this->m_joints_count * sizeof(Matrix3x4);
+	}
+
+  private:
+	GLuint       m_texture      = -1;
+	unsigned int m_frames_count = 0;
+	unsigned int m_joints_count = 0;
+	float        m_duration     = 0.0f;
+	bool         m_loop         = true;
+};
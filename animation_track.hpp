@@ -0,0 +1,244 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Two keyframes to interpolate between and the fraction from one to the other
+// m_to is m_from + 1 except when a looping clip wraps around from its last keyframe to the first
+typedef struct
+{
+	unsigned int m_from;
+	unsigned int m_to;
+	float        m_t;
+} KeyframeSpan;
+
+// Dense table of decomposed keyframes for all animated nodes of a skeleton
+// Each node maps to a track index or -1 if it isn't animated, so there are no tree lookups per frame
+// Keys are stored contiguously key major, all tracks of keyframe k are next to each other so sampling a pose
+// only touches two short runs of memory for keyframe k and k + 1
+class TrackTable
+{
+  public:
+	TrackTable(){};
+
+	// Storage for a_tracks_count tracks is laid out up front, so adding a track only writes its own keys
+	TrackTable(unsigned int a_nodes_count, unsigned int a_keyframes_count, unsigned int a_tracks_count) :
+		m_node_tracks(a_nodes_count, -1),
+		m_rotations(a_tracks_count * a_keyframes_count),
+		m_translations(a_tracks_count * a_keyframes_count),
+		m_scales(a_tracks_count * a_keyframes_count),
+		m_tracks_count(a_tracks_count),
+		m_keyframes_count(a_keyframes_count)
+	{}
+
+	// Tracks must be added with all their keyframes at once, all a_tracks_count of them before sampling
+	void add_track(unsigned int a_node, const std::vector<Transform> &a_keyframes)
+	{
+		assert(a_node < this->m_node_tracks.size());
+		assert(this->m_node_tracks[a_node] == -1 && "Node already has a track");
+		assert(a_keyframes.size() == this->m_keyframes_count);
+		assert(this->m_added_count < this->m_tracks_count && "More tracks than the table was created for");
+
+		unsigned int track = this->m_added_count++;
+
+		for (unsigned int k = 0; k < this->m_keyframes_count; ++k)
+		{
+			Quaternion rotation = a_keyframes[k].m_rotation;
+
+			// Keep neighbouring keys in the same hemisphere so interpolation doesn't have to check
+			if (k > 0 && quaternion_dot(this->m_rotations[(k - 1) * this->m_tracks_count + track], rotation) < 0.0f)
+				rotation = Quaternion{-rotation.x, -rotation.y, -rotation.z, -rotation.w};
+
+			this->m_rotations[k * this->m_tracks_count + track]    = rotation;
+			this->m_translations[k * this->m_tracks_count + track] = a_keyframes[k].m_translation;
+			this->m_scales[k * this->m_tracks_count + track]       = a_keyframes[k].m_scale;
+		}
+
+		this->m_node_tracks[a_node] = static_cast<int16_t>(track);
+	}
+
+	// Returns -1 for nodes without animation
+	int track(unsigned int a_node) const
+	{
+		return this->m_node_tracks[a_node];
+	}
+
+	unsigned int tracks_count() const
+	{
+		return this->m_tracks_count;
+	}
+
+	unsigned int keyframes_count() const
+	{
+		return this->m_keyframes_count;
+	}
+
+	Transform keyframe(int a_track, unsigned int a_keyframe) const
+	{
+		unsigned int index = a_keyframe * this->m_tracks_count + static_cast<unsigned int>(a_track);
+		return Transform{this->m_rotations[index], this->m_translations[index], this->m_scales[index]};
+	}
+
+	// Raw key major arrays for batched sampling, index is keyframe * tracks_count() + track
+	const Quaternion *rotations() const
+	{
+		return this->m_rotations.data();
+	}
+
+	const ror::Vector3f *translations() const
+	{
+		return this->m_translations.data();
+	}
+
+	const ror::Vector3f *scales() const
+	{
+		return this->m_scales.data();
+	}
+
+	// Interpolates between keyframe a_keyframe_prev and the next one, a_t in [0, 1]
+	Transform sample(int a_track, unsigned int a_keyframe_prev, float a_t) const
+	{
+		return this->sample(a_track, KeyframeSpan{a_keyframe_prev, a_keyframe_prev + 1, a_t});
+	}
+
+	Transform sample(int a_track, const KeyframeSpan &a_span) const
+	{
+		assert(a_span.m_from < this->m_keyframes_count && a_span.m_to < this->m_keyframes_count);
+
+		unsigned int from = a_span.m_from * this->m_tracks_count + static_cast<unsigned int>(a_track);
+		unsigned int to   = a_span.m_to * this->m_tracks_count + static_cast<unsigned int>(a_track);
+
+		// nlerp checks the hemisphere, keys are only pre-aligned with their neighbours not across a wrap around
+		return Transform{quaternion_nlerp(this->m_rotations[from], this->m_rotations[to], a_span.m_t),
+						 vector3_lerp(this->m_translations[from], this->m_translations[to], a_span.m_t),
+						 vector3_lerp(this->m_scales[from], this->m_scales[to], a_span.m_t)};
+	}
+
+  private:
+	std::vector<int16_t>       m_node_tracks;        // Per node track index or -1
+	std::vector<Quaternion>    m_rotations;          // m_keyframes_count * m_tracks_count, key major
+	std::vector<ror::Vector3f> m_translations;
+	std::vector<ror::Vector3f> m_scales;
+	unsigned int               m_tracks_count    = 0;
+	unsigned int               m_keyframes_count = 0;
+	unsigned int               m_added_count     = 0;
+};
+
+// Per instance state of a KeyframeSampler, remembers the last keyframe so forward playback doesn't have to search
+typedef struct
+{
+	unsigned int m_keyframe = 0;
+} KeyframeCursor;
+
+// Finds the bracketing keyframes for a time
+// Evenly spaced keyframes are found in O(1), otherwise the cursor is advanced for forward playback and binary search is used for seeks
+class KeyframeSampler
+{
+  public:
+	KeyframeSampler(){};
+
+	KeyframeSampler(const std::vector<float> &a_times) :
+		m_times(a_times)
+	{
+		assert(this->m_times.size() >= 2 && "Need at least two keyframes to sample");
+
+		float duration = this->m_times.back() - this->m_times.front();
+		float step     = duration / static_cast<float>(this->m_times.size() - 1);
+
+		this->m_uniform = step > 0.0f;
+		for (size_t i = 1; i < this->m_times.size() && this->m_uniform; ++i)
+			if (std::abs((this->m_times[i] - this->m_times[i - 1]) - step) > step * 1e-3f)
+				this->m_uniform = false;
+
+		this->m_inverse_step = this->m_uniform ? 1.0f / step : 0.0f;
+	}
+
+	bool uniform() const
+	{
+		return this->m_uniform;
+	}
+
+	// Writes out the previous keyframe and the fraction between it and the next one, a_time is clamped to the keyframe range
+	void find(float a_time, KeyframeCursor &a_cursor, unsigned int &a_keyframe_prev, float &a_t) const
+	{
+		unsigned int last = static_cast<unsigned int>(this->m_times.size()) - 2;        // Last valid previous keyframe
+		unsigned int index;
+
+		if (a_time <= this->m_times.front())
+		{
+			index  = 0;
+			a_time = this->m_times.front();
+		}
+		else if (a_time >= this->m_times.back())
+		{
+			index  = last;
+			a_time = this->m_times.back();
+		}
+		else if (this->m_uniform)
+		{
+			index = std::min(static_cast<unsigned int>((a_time - this->m_times.front()) * this->m_inverse_step), last);
+
+			// Keyframe times are only approximately uniform, fix up the rounding at the edges
+			if (index > 0 && a_time < this->m_times[index])
+				--index;
+			else if (index < last && a_time >= this->m_times[index + 1])
+				++index;
+		}
+		else
+		{
+			index = std::min(a_cursor.m_keyframe, last);
+
+			if (a_time >= this->m_times[index])
+			{
+				// Forward playback, usually the same or the next keyframe
+				unsigned int steps = 0;
+				while (index < last && a_time >= this->m_times[index + 1] && steps++ < 4)
+					++index;
+			}
+
+			if (a_time < this->m_times[index] || (index < last && a_time >= this->m_times[index + 1]))
+			{
+				// Random seek
+				auto upper = std::upper_bound(this->m_times.begin(), this->m_times.end(), a_time);
+				index      = std::min(static_cast<unsigned int>(upper - this->m_times.begin()) - 1, last);
+			}
+		}
+
+		a_cursor.m_keyframe = index;
+		a_keyframe_prev     = index;
+		a_t                 = (a_time - this->m_times[index]) / (this->m_times[index + 1] - this->m_times[index]);
+	}
+
+  private:
+	std::vector<float> m_times;
+	float              m_inverse_step = 0.0f;
+	bool               m_uniform      = false;
+};
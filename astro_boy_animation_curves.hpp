@@ -0,0 +1,47 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+// astro_boy_animation_keyframe_matrices reduced to cubic Hermite curves within 0.01 world space joint position error, generated with ./geom 0.01
+
+const unsigned int astro_boy_curve_tracks_count = 24;
+
+// Node index, then first key and keys count of rotation, translation and scale of each track
+const unsigned int astro_boy_curve_tracks[astro_boy_curve_tracks_count * 7] = {1,0,13,0,28,0,1,2,13,24,28,1,1,1,3,37,25,29,1,2,1,4,62,11,30,1,3,1,5,73,18,31,1,4,1,7,91,23,32,1,5,1,8,114,34,33,1,6,1,10,148,23,34,1,7,1,12,171,9,35,1,8,1,29,180,21,36,1,9,1,30,201,34,37,1,10,1,32,235,23,38,1,11,1,34,258,17,39,1,12,1,51,275,20,40,1,13,1,52,295,34,41,1,14,1,53,329,32,42,1,15,1,54,361,32,43,1,16,1,55,393,29,44,1,17,1,58,422,34,45,1,18,1,59,456,33,46,1,19,1,60,489,33,47,1,20,1,61,522,36,48,1,21,1,62,558,18,49,1,22,1,56,576,17,50,1,23,1};
+
+const unsigned int astro_boy_curve_rotation_keys_count = 593;
+
+const float astro_boy_curve_rotation_times[astro_boy_curve_rotation_keys_count] = {0.000000,0.066666,0.133333,0.166667,0.233333,0.300000,0.466667,0.533333,0.566667,0.666667,0.866667,1.033330,1.166670,0.000000,0.033333,0.066666,0.133333,0.200000,0.233333,0.266667,0.333333,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.666667,0.700000,0.733333,0.800000,0.966667,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.166667,0.200000,0.233333,0.300000,0.366667,0.400000,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.833333,0.900000,0.966667,1.033330,1.066670,1.166670,0.000000,0.066666,0.300000,0.400000,0.533333,0.633333,0.733333,0.866667,1.033330,1.066670,1.166670,0.000000,0.033333,0.066666,0.133333,0.200000,0.233333,0.266667,0.366667,0.433333,0.533333,0.633333,0.700000,0.766667,0.833333,0.933333,1.000000,1.066670,1.166670,0.000000,0.033333,0.066666,0.100000,0.166667,0.200000,0.233333,0.266667,0.300000,0.333333,0.400000,0.466667,0.566667,0.666667,0.700000,0.733333,0.800000,0.866667,0.900000,0.966667,1.033330,1.066670,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.033330,1.066670,1.100000,1.133330,1.166670,0.000000,0.033333,0.066666,0.100000,0.166667,0.200000,0.233333,0.333333,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.700000,0.733333,0.800000,0.900000,1.033330,1.066670,1.100000,1.166670,0.000000,0.066666,0.300000,0.400000,0.533333,0.700000,0.866667,1.033330,1.166670,0.000000,0.033333,0.066666,0.166667,0.266667,0.366667,0.533333,0.600000,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.133333,0.200000,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.133330,1.166670,0.000000,0.033333,0.066666,0.133333,0.166667,0.200000,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.466667,0.533333,0.566667,0.633333,0.700000,0.766667,0.833333,0.866667,0.966667,1.066670,1.166670,0.000000,0.066666,0.133333,0.233333,0.300000,0.400000,0.433333,0.500000,0.566667,0.633333,0.700000,0.766667,0.800000,0.966667,1.033330,1.100000,1.166670,0.000000,0.033333,0.066666,0.133333,0.200000,0.266667,0.366667,0.533333,0.600000,0.633333,0.666667,0.733333,0.800000,0.833333,0.900000,0.966667,1.000000,1.033330,1.066670,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.800000,0.833333,0.866667,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.800000,0.833333,0.866667,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.800000,0.866667,0.966667,1.033330,1.066670,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.033330,1.066670,1.100000,1.133330,1.166670,0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.233333,0.266667,0.300000,0.333333,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.733333,0.766667,0.800000,0.833333,0.866667,0.900000,0.933333,0.966667,1.000000,1.033330,1.066670,1.100000,1.133330,1.166670,0.000000,0.200000,0.300000,0.366667,0.400000,0.433333,0.466667,0.500000,0.533333,0.566667,0.600000,0.633333,0.700000,0.733333,0.800000,0.866667,0.933333,1.166670,0.000000,0.033333,0.066666,0.100000,0.266667,0.366667,0.466667,0.566667,0.700000,0.766667,0.833333,0.900000,1.000000,1.033330,1.066670,1.100000,1.166670};
+const float astro_boy_curve_rotation_values[astro_boy_curve_rotation_keys_count * 4] = {0.034063,-0.031450,0.677639,0.733932,0.034022,-0.031495,0.678602,0.733042,0.033814,-0.031717,0.683397,0.728573,0.033622,-0.031921,0.687784,0.724434,0.033151,-0.032410,0.698319,0.714283,0.032645,-0.032920,0.709301,0.703380,0.031594,-0.033930,0.731062,0.680734,0.031451,-0.034063,0.733935,0.677636,0.031516,-0.034003,0.732630,0.679046,0.032104,-0.033448,0.720670,0.691726,0.033466,-0.032085,0.691316,0.721063,0.034024,-0.031492,0.678546,0.733093,0.034063,-0.031450,0.677639,0.733932,0.190843,0.014590,0.978656,0.074820,0.190843,0.014590,0.978656,0.074820,0.187720,0.014989,0.979123,0.076516,0.177155,0.015418,0.980971,0.077932,0.166625,0.013169,0.983752,0.065542,0.166359,0.011220,0.984514,0.054136,0.168047,0.008803,0.984936,0.039795,0.174313,0.002558,0.984676,0.004679,0.181523,-0.004563,0.982864,-0.031716,0.184875,-0.007982,0.981564,-0.047844,0.187839,-0.010902,0.980254,-0.060819,0.190237,-0.012965,0.979211,-0.069200,0.190849,-0.014480,0.978683,-0.074478,0.188429,-0.014767,0.979129,-0.074725,0.183080,-0.014838,0.980285,-0.072826,0.171586,-0.013458,0.983091,-0.062524,0.166754,-0.012354,0.984394,-0.054858,0.166343,-0.010728,0.984979,-0.045074,0.170184,-0.006402,0.985168,-0.020963,0.185339,0.007565,0.981553,0.046328,0.189668,0.012423,0.979511,0.066557,0.190714,0.014218,0.978789,0.073468,0.190843,0.014590,0.978656,0.074820,0.190843,0.014590,0.978656,0.074820,0.043864,0.048579,-0.031465,0.997360,0.043864,0.048579,-0.031465,0.997360,0.035140,0.047652,-0.032886,0.997704,0.020073,0.046315,-0.035075,0.998109,-0.005323,0.044265,-0.036121,0.998352,-0.016284,0.045269,-0.034641,0.998241,-0.024269,0.051358,-0.030979,0.997905,-0.034342,0.068269,-0.018910,0.996896,-0.040200,0.071171,-0.003469,0.996648,-0.041874,0.068233,0.004469,0.996780,-0.044471,0.051004,0.025347,0.997386,-0.044242,0.048664,0.030427,0.997371,-0.042030,0.052982,0.033571,0.997146,-0.038029,0.062470,0.035160,0.996702,-0.031966,0.071256,0.035485,0.996314,-0.023426,0.076656,0.035034,0.996167,-0.013923,0.080672,0.033301,0.996087,-0.004680,0.081166,0.029996,0.996238,0.004155,0.080653,0.025516,0.996407,0.019352,0.076717,0.013785,0.996770,0.030648,0.070291,0.000172,0.997056,0.038530,0.061163,-0.013378,0.997294,0.042965,0.051696,-0.024938,0.997427,0.043788,0.048984,-0.030210,0.997382,0.043864,0.048579,-0.031465,0.997360,-0.064598,0.166406,-0.010905,0.983879,-0.058578,0.166235,-0.009892,0.984295,0.018678,0.165530,0.003158,0.986023,0.046694,0.165949,0.007890,0.984997,0.064506,0.166403,0.010889,0.983885,0.057917,0.166218,0.009780,0.984338,0.038098,0.165782,0.006439,0.985405,-0.000369,0.165449,-0.000063,0.986218,-0.051512,0.166057,-0.008702,0.984731,-0.061933,0.166328,-0.010457,0.984068,-0.064598,0.166406,-0.010905,0.983879,-0.093136,0.010441,0.039413,0.994818,-0.093136,0.010441,0.039413,0.994818,-0.089638,-0.002021,0.037716,0.995258,-0.074059,-0.044027,0.031544,0.995782,-0.047006,-0.085544,0.023724,0.994942,-0.031812,-0.085603,0.020022,0.995620,-0.015672,-0.078336,0.015682,0.996680,0.039055,-0.036726,-0.002144,0.998560,0.071239,-0.007067,-0.016366,0.997300,0.095364,0.019997,-0.032884,0.994698,0.075065,-0.010766,-0.025890,0.996784,0.045263,-0.048320,-0.013797,0.997710,0.018176,-0.058809,-0.005099,0.998091,-0.011453,-0.050268,0.004437,0.998660,-0.057118,-0.019761,0.022054,0.997928,-0.079874,-0.001351,0.032592,0.996271,-0.092594,0.009925,0.039118,0.994886,-0.093136,0.010441,0.039413,0.994818,-0.703588,0.064694,0.071163,0.704070,-0.703588,0.064694,0.071163,0.704070,-0.709384,0.057177,0.080869,0.697829,-0.719098,0.043788,0.097281,0.686672,-0.735395,0.018662,0.125261,0.665699,-0.741718,0.007850,0.136295,0.656671,-0.744770,0.002368,0.141665,0.652107,-0.745021,0.001878,0.142100,0.651727,-0.743621,0.004217,0.139587,0.653854,-0.740279,0.009754,0.133631,0.658813,-0.730066,0.025987,0.115721,0.673006,-0.717386,0.044811,0.094005,0.688848,-0.698718,0.072366,0.063539,0.708886,-0.678335,0.104555,0.032853,0.726533,-0.672447,0.113561,0.024301,0.730977,-0.669446,0.118031,0.019966,0.733152,-0.670130,0.117217,0.021036,0.732628,-0.676066,0.108780,0.029793,0.728158,-0.680113,0.102833,0.035800,0.724976,-0.689151,0.088933,0.049305,0.717447,-0.697971,0.074447,0.062613,0.709488,-0.702470,0.066671,0.069454,0.705172,-0.703588,0.064694,0.071163,0.704070,-0.388684,0.252319,0.019947,0.885924,-0.388684,0.252319,0.019947,0.885925,-0.391211,0.247096,0.019668,0.886290,-0.395436,0.235743,0.019039,0.887521,-0.399471,0.219519,0.017964,0.889894,-0.403136,0.193140,0.015764,0.894388,-0.407880,0.125726,0.013642,0.904235,-0.408301,0.085343,0.015392,0.908719,-0.409134,0.033848,0.021405,0.911595,-0.408774,-0.032822,0.033513,0.911429,-0.410083,-0.105350,0.047791,0.904682,-0.415012,-0.185804,0.063203,0.888396,-0.421049,-0.263678,0.078055,0.864349,-0.426199,-0.326871,0.090602,0.838630,-0.429065,-0.366697,0.101128,0.819274,-0.422934,-0.391692,0.112309,0.809377,-0.405375,-0.394554,0.116787,0.816308,-0.372271,-0.385353,0.125920,0.834902,-0.338899,-0.370833,0.126166,0.855402,-0.309621,-0.358755,0.120160,0.872348,-0.283377,-0.342194,0.108306,0.889309,-0.264601,-0.319098,0.089365,0.905636,-0.253184,-0.288470,0.065988,0.921048,-0.256558,-0.247840,0.040013,0.933355,-0.271139,-0.193653,0.017443,0.942697,-0.293998,-0.132972,-0.000693,0.946511,-0.316293,-0.071133,-0.013563,0.945894,-0.337129,-0.008527,-0.020649,0.941193,-0.354751,0.053718,-0.021428,0.933170,-0.375451,0.171848,-0.007633,0.910740,-0.386069,0.235977,0.013048,0.891681,-0.388684,0.252319,0.019947,0.885924,-0.388684,0.252319,0.019947,0.885924,-0.388684,0.252319,0.019947,0.885924,0.000007,0.683288,0.000007,0.730149,0.000007,0.683288,0.000007,0.730149,0.000007,0.703864,0.000007,0.710334,0.000007,0.737825,0.000007,0.674993,0.000008,0.788715,0.000008,0.614759,0.000008,0.808273,0.000008,0.588808,0.000009,0.821598,0.000008,0.570068,0.000009,0.845516,0.000009,0.533949,0.000010,0.854977,0.000009,0.518666,0.000010,0.857266,0.000009,0.514874,0.000010,0.858311,0.000009,0.513131,0.000010,0.858980,0.000009,0.512010,0.000010,0.855288,0.000009,0.518153,0.000009,0.839919,0.000009,0.542712,0.000009,0.816588,0.000008,0.577221,0.000007,0.729914,0.000007,0.683539,0.000007,0.713926,0.000007,0.700221,0.000007,0.701928,0.000007,0.712248,0.000007,0.692351,0.000007,0.721561,0.000007,0.687443,0.000007,0.726238,0.000007,0.684302,0.000007,0.729199,0.000007,0.683288,0.000007,0.730149,0.000007,0.683288,0.000007,0.730149,0.000000,0.124903,0.000000,0.992169,0.000000,0.119021,0.000000,0.992892,0.000000,0.044350,0.000000,0.999016,0.000000,0.017254,0.000000,0.999851,0.000000,0.000079,0.000000,1.000000,0.000000,0.021185,0.000000,0.999776,0.000000,0.071388,0.000000,0.997449,0.000000,0.123501,0.000000,0.992345,0.000000,0.124903,0.000000,0.992169,0.071160,0.704070,0.703588,-0.064691,0.071160,0.704070,0.703588,-0.064691,0.068273,0.708909,0.698649,-0.068385,0.052867,0.732755,0.672902,-0.086477,0.041714,0.748306,0.654723,-0.098163,0.044310,0.743407,0.660669,-0.094333,0.069152,0.706569,0.701101,-0.066604,0.088146,0.685230,0.721183,-0.050844,0.111457,0.659084,0.743108,-0.031255,0.122502,0.646010,0.753136,-0.021256,0.130639,0.635963,0.760462,-0.013485,0.136048,0.629145,0.765246,-0.008172,0.137802,0.626966,0.766735,-0.006470,0.135721,0.629856,0.764712,-0.008742,0.130919,0.636218,0.760197,-0.013716,0.124076,0.645052,0.753717,-0.020577,0.095852,0.678393,0.726971,-0.045911,0.085329,0.689693,0.717006,-0.054263,0.074042,0.701220,0.706318,-0.062640,0.071160,0.704070,0.703588,-0.064691,0.071160,0.704070,0.703588,-0.064691,-0.427307,-0.386371,0.366306,0.730716,-0.427307,-0.386371,0.366306,0.730716,-0.417943,-0.375795,0.370358,0.739552,-0.377294,-0.325495,0.383026,0.777813,-0.309813,-0.228570,0.388181,0.837310,-0.273271,-0.174543,0.382815,0.865049,-0.239472,-0.117977,0.369279,0.890150,-0.215512,-0.057839,0.343723,0.912175,-0.209716,0.006539,0.304238,0.929202,-0.216491,0.074571,0.259949,0.938082,-0.228510,0.152869,0.211096,0.938005,-0.250601,0.230547,0.163516,0.925910,-0.277461,0.296667,0.123795,0.905361,-0.306690,0.341733,0.094409,0.883316,-0.332714,0.372102,0.074151,0.863333,-0.351160,0.378819,0.064502,0.853828,-0.357313,0.371855,0.062817,0.854462,-0.365435,0.354221,0.069319,0.858009,-0.368229,0.330855,0.080938,0.865096,-0.369187,0.298992,0.097576,0.874519,-0.368885,0.261016,0.115858,0.884517,-0.367368,0.215632,0.137349,0.894247,-0.364225,0.160988,0.164755,0.902374,-0.359740,0.095996,0.200220,0.906247,-0.357563,0.025397,0.237983,0.902700,-0.355899,-0.048935,0.277104,0.891153,-0.360364,-0.124312,0.314300,0.869425,-0.368868,-0.195424,0.344843,0.840731,-0.382284,-0.258685,0.364845,0.808597,-0.399183,-0.316305,0.378392,0.772932,-0.421252,-0.372807,0.371052,0.738838,-0.427307,-0.386371,0.366306,0.730716,-0.427307,-0.386371,0.366306,0.730716,-0.427307,-0.386371,0.366306,0.730716,0.000006,0.847859,0.000008,0.530222,0.000006,0.847859,0.000008,0.530222,0.000006,0.839543,0.000008,0.543294,0.000005,0.799070,0.000008,0.601238,0.000005,0.761070,0.000007,0.648670,-0.000104,0.717250,-0.000102,0.696816,0.000120,0.673568,0.000122,0.739125,0.000004,0.633325,0.000006,0.773886,0.000003,0.602606,0.000006,0.798039,0.000003,0.589203,0.000006,0.807985,0.000003,0.586290,0.000006,0.810102,0.000003,0.589305,0.000006,0.807911,0.000003,0.615904,0.000006,0.787821,0.000005,0.661542,0.000007,0.749908,-0.000031,0.692698,-0.000028,0.721228,0.000004,0.760831,0.000007,0.648950,0.000005,0.824181,0.000008,0.566327,0.000006,0.856661,0.000008,0.515880,0.000006,0.862862,0.000008,0.505439,0.000005,0.860046,0.000008,0.510217,0.000006,0.852961,0.000009,0.521975,0.000006,0.847998,0.000008,0.529999,0.000006,0.847859,0.000008,0.530222,0.000000,0.000000,0.000000,1.000000,-0.002069,-0.004972,-0.000010,0.999986,-0.011026,-0.020997,-0.000232,0.999719,-0.031585,-0.042976,-0.001359,0.998576,-0.034613,-0.064804,-0.002249,0.997295,-0.005899,-0.106344,-0.000631,0.994312,0.004241,-0.115661,0.000494,0.993280,0.008247,-0.125268,0.001041,0.992088,-0.008754,-0.122294,-0.001079,0.992455,-0.042552,-0.107495,-0.004605,0.993284,-0.085807,-0.085402,-0.007383,0.992617,-0.107456,-0.062906,-0.006813,0.992194,-0.107124,-0.053518,-0.005775,0.992787,-0.012492,-0.020363,-0.000254,0.999715,0.000793,0.000561,-0.000000,1.000000,0.000000,0.000000,0.000000,1.000000,0.000000,0.000000,0.000000,1.000000,0.000000,0.000000,-0.670692,0.741736,0.000000,0.000000,-0.670692,0.741736,0.001312,0.001130,-0.671181,0.741292,0.005702,0.004960,-0.674688,0.738065,0.009817,0.008758,-0.683904,0.729453,0.012099,0.011132,-0.695373,0.718461,0.010495,0.010275,-0.714035,0.699956,0.000625,0.000703,-0.740872,0.671646,-0.004476,-0.005271,-0.744041,0.668098,-0.007398,-0.008726,-0.743441,0.668704,-0.010688,-0.012555,-0.739922,0.672491,-0.017340,-0.019823,-0.729293,0.683695,-0.022892,-0.025305,-0.715559,0.697718,-0.024953,-0.027029,-0.708085,0.705168,-0.025131,-0.026154,-0.693538,0.719506,-0.018637,-0.018772,-0.681131,0.731683,-0.013498,-0.013393,-0.676673,0.736038,-0.007717,-0.007579,-0.672902,0.739653,-0.001558,-0.001517,-0.670939,0.741509,0.000000,0.000000,-0.670692,0.741736,-0.698649,0.712269,0.048538,0.046971,-0.698649,0.712269,0.048538,0.046971,-0.715801,0.697759,-0.006238,0.026899,-0.742411,0.662539,-0.099161,-0.005857,-0.759430,0.623899,-0.182085,-0.029338,-0.768075,0.578667,-0.271404,-0.039311,-0.773460,0.527508,-0.348517,-0.045068,-0.779938,0.486148,-0.391426,-0.046291,-0.785218,0.454989,-0.416685,-0.052836,-0.780478,0.428184,-0.449420,-0.074395,-0.759210,0.393634,-0.504042,-0.120804,-0.737135,0.359018,-0.545946,-0.172283,-0.740486,0.329188,-0.536084,-0.236495,-0.741762,0.319226,-0.506933,-0.301502,-0.761503,0.332603,-0.446936,-0.331265,-0.767871,0.441627,-0.344086,-0.311358,-0.777929,0.522230,-0.216302,-0.274436,-0.749887,0.567670,-0.196317,-0.277272,-0.721720,0.599990,-0.202508,-0.279504,-0.701087,0.625123,-0.208283,-0.272612,-0.716486,0.647433,-0.140462,-0.218514,-0.732395,0.657302,-0.071272,-0.162703,-0.735985,0.662574,-0.033976,-0.134789,-0.731759,0.672595,0.002881,-0.110164,-0.728218,0.678640,0.026719,-0.091832,-0.723907,0.684459,0.048141,-0.071817,-0.718961,0.690085,0.069229,-0.045665,-0.713335,0.695347,0.085904,-0.016311,-0.708092,0.700639,0.087756,0.003154,-0.705182,0.704833,0.075692,0.014113,-0.702633,0.709235,0.053116,0.021699,-0.702438,0.709577,0.050902,0.022165,-0.702436,0.709579,0.050885,0.022170,-0.702436,0.709579,0.050885,0.022170,-0.203750,0.000000,0.979023,-0.000000,-0.203750,0.000000,0.979023,-0.000000,-0.273600,0.000000,0.961844,-0.000000,-0.385326,0.000000,0.922780,-0.000000,-0.461511,0.000000,0.887135,-0.000000,-0.502767,0.000000,0.864422,-0.000000,-0.526791,0.000000,0.849995,-0.000000,-0.526398,0.000000,0.850238,-0.000000,-0.517082,0.000000,0.855936,-0.000000,-0.541800,0.000000,0.840507,-0.000000,-0.555704,0.000000,0.831380,-0.000000,-0.542826,0.000000,0.839845,-0.000000,-0.499457,0.000000,0.866339,-0.000000,-0.416062,0.000000,0.909336,-0.000000,-0.270736,0.000000,0.962654,-0.000000,-0.124295,0.000000,0.992245,-0.000000,-0.127623,0.000000,0.991823,-0.000000,-0.175013,0.000000,0.984566,-0.000000,-0.204893,0.000000,0.978784,-0.000000,-0.157450,0.000000,0.987527,-0.000000,-0.100396,0.000000,0.994948,-0.000000,-0.085800,0.000000,0.996312,-0.000000,-0.092463,0.000000,0.995716,-0.000000,-0.092491,0.000000,0.995714,-0.000000,-0.092522,0.000000,0.995711,-0.000000,-0.087312,0.000000,0.996181,-0.000000,-0.096914,0.000000,0.995293,-0.000000,-0.130944,0.000000,0.991390,-0.000000,-0.177146,0.000000,0.984185,-0.000000,-0.181316,0.000000,0.983425,-0.000000,-0.181350,0.000000,0.983419,-0.000000,-0.181350,0.000000,0.983419,-0.000000,0.000000,0.087671,0.000000,0.996150,0.000000,0.087671,0.000000,0.996150,0.000000,0.147222,0.000000,0.989104,0.000000,0.243992,0.000000,0.969777,0.000000,0.311352,0.000000,0.950294,0.000000,0.348415,0.000000,0.937340,0.000000,0.370214,0.000000,0.928946,0.000000,0.369857,0.000000,0.929089,0.000000,0.361384,0.000000,0.932417,0.000000,0.383924,0.000000,0.923365,0.000000,0.396688,0.000000,0.917953,0.000000,0.384863,0.000000,0.922974,0.000000,0.345424,0.000000,0.938447,0.000000,0.271015,0.000000,0.962575,0.000000,0.144767,0.000000,0.989466,0.000000,0.020618,0.000000,0.999787,0.000000,0.023413,0.000000,0.999726,0.000000,0.063342,0.000000,0.997992,0.000000,0.088639,0.000000,0.996064,0.000000,0.048518,0.000000,0.998822,0.000000,0.000570,0.000000,1.000000,0.000000,-0.011650,0.000000,0.999932,0.000000,-0.006074,0.000000,0.999982,0.000000,-0.006050,0.000000,0.999982,0.000000,-0.006024,0.000000,0.999982,0.000000,-0.010379,0.000000,0.999946,0.000000,-0.002201,0.000000,0.999998,0.000000,0.027735,0.000000,0.999615,0.000000,0.061452,0.000000,0.998110,0.000000,0.083784,0.000000,0.996484,0.000000,0.087671,0.000000,0.996150,0.000000,0.087671,0.000000,0.996150,-0.587470,0.001829,0.809244,-0.000697,-0.587470,0.001829,0.809244,-0.000697,-0.609704,-0.015782,0.792254,-0.018597,-0.631384,-0.048631,0.771450,-0.062080,-0.627952,-0.057609,0.770394,-0.094077,-0.550316,-0.042159,0.821775,-0.141636,-0.456066,-0.029230,0.869769,-0.186146,-0.359368,-0.008128,0.908883,-0.211472,-0.282812,0.012747,0.931993,-0.226370,-0.260906,0.022441,0.937501,-0.229164,-0.337659,0.009080,0.917634,-0.209408,-0.443280,-0.009887,0.877472,-0.182888,-0.558469,-0.022203,0.817140,-0.141075,-0.663297,-0.011374,0.743378,-0.085427,-0.695683,-0.024072,0.715955,-0.053420,-0.652924,-0.007119,0.757009,-0.024022,-0.584027,0.020173,0.811375,-0.013264,-0.542232,0.035430,0.839397,-0.011875,-0.519696,0.046968,0.852983,-0.011394,-0.504982,0.051154,0.861488,-0.014700,-0.496954,0.049811,0.866165,-0.017710,-0.498706,0.045633,0.865321,-0.020725,-0.513966,0.043030,0.856428,-0.022765,-0.559641,0.040980,0.827387,-0.023517,-0.578088,0.039920,0.814639,-0.024153,-0.553367,0.029193,0.832269,-0.016177,-0.578337,0.013846,0.815659,-0.006020,-0.586346,0.004354,0.810047,-0.001684,-0.587470,0.001829,0.809244,-0.000697,-0.270347,0.208205,0.547550,0.764036,-0.270347,0.208205,0.547551,0.764036,-0.274748,0.216337,0.567743,0.745238,-0.273633,0.218997,0.602207,0.717295,-0.259738,0.206297,0.630076,0.702127,-0.206279,0.143006,0.655940,0.711857,-0.150953,0.075584,0.671024,0.721960,-0.121632,0.038393,0.679297,0.722695,-0.090012,0.002202,0.690923,0.717300,-0.065761,-0.018149,0.696549,0.714259,-0.041001,-0.036232,0.701233,0.710830,-0.013067,-0.053817,0.704124,0.707914,0.014754,-0.068395,0.705869,0.704879,0.033232,-0.072798,0.708918,0.700736,0.040851,-0.067390,0.714515,0.695167,0.044301,-0.053233,0.716378,0.694267,0.056335,-0.042207,0.710205,0.700467,0.071566,-0.026054,0.694641,0.715314,0.075502,0.017414,0.673673,0.734956,0.064857,0.098368,0.639451,0.759750,0.043326,0.180693,0.594232,0.782535,0.010031,0.241146,0.554839,0.796179,-0.028898,0.293804,0.520453,0.801232,-0.079904,0.347898,0.494507,0.792493,-0.140017,0.411833,0.473563,0.765850,-0.195711,0.466113,0.454525,0.733378,-0.238975,0.497599,0.432867,0.712680,-0.272472,0.499105,0.424728,0.704456,-0.299415,0.479691,0.431346,0.702985,-0.305212,0.411214,0.463009,0.723444,-0.306285,0.316068,0.491529,0.751458,-0.306224,0.307257,0.493421,0.753893,-0.306225,0.307187,0.493435,0.753913,-0.306225,0.307187,0.493435,0.753913,-0.122947,0.000000,0.992413,0.000000,-0.122947,0.000000,0.992413,0.000000,-0.154231,0.000000,0.988035,0.000000,-0.199350,0.000000,0.979928,0.000000,-0.211368,0.000000,0.977407,0.000000,-0.167543,0.000000,0.985865,0.000000,-0.114674,0.000000,0.993403,0.000000,-0.101173,0.000000,0.994869,0.000000,-0.107266,0.000000,0.994230,0.000000,-0.106869,0.000000,0.994273,0.000000,-0.107313,0.000000,0.994225,0.000000,-0.105971,0.000000,0.994369,0.000000,-0.106215,0.000000,0.994343,0.000000,-0.120829,0.000000,0.992673,0.000000,-0.155100,0.000000,0.987899,0.000000,-0.242594,0.000000,0.970128,0.000000,-0.288996,0.000000,0.957330,0.000000,-0.340886,0.000000,0.940104,0.000000,-0.401020,0.000000,0.916069,0.000000,-0.454963,0.000000,0.890510,0.000000,-0.481362,0.000000,0.876522,0.000000,-0.494054,0.000000,0.869431,0.000000,-0.511038,0.000000,0.859558,0.000000,-0.545010,0.000000,0.838430,0.000000,-0.573351,0.000000,0.819310,0.000000,-0.575291,0.000000,0.817949,0.000000,-0.568736,0.000000,0.822520,0.000000,-0.523390,0.000000,0.852093,0.000000,-0.437509,0.000000,0.899214,0.000000,-0.313596,0.000000,0.949556,0.000000,-0.302138,0.000000,0.953264,0.000000,-0.302046,0.000000,0.953294,0.000000,-0.302046,0.000000,0.953294,0.000000,0.000000,0.006059,0.000000,0.999982,0.000000,0.006059,0.000000,0.999982,0.000000,0.032418,0.000000,0.999474,0.000000,0.070655,0.000000,0.997501,0.000000,0.080916,0.000000,0.996721,0.000000,0.043929,0.000000,0.999035,0.000000,-0.000454,0.000000,1.000000,0.000000,-0.011741,0.000000,0.999931,0.000000,-0.006648,0.000000,0.999978,0.000000,-0.006955,0.000000,0.999976,0.000000,-0.006607,0.000000,0.999978,0.000000,-0.007890,0.000000,0.999969,0.000000,-0.007839,0.000000,0.999969,0.000000,0.004258,0.000000,0.999991,0.000000,0.033142,0.000000,0.999451,0.000000,0.107563,0.000000,0.994198,0.000000,0.147437,0.000000,0.989071,0.000000,0.192438,0.000000,0.981309,0.000000,0.245215,0.000000,0.969469,0.000000,0.293231,0.000000,0.956042,0.000000,0.316993,0.000000,0.948428,0.000000,0.328487,0.000000,0.944509,0.000000,0.343939,0.000000,0.938992,0.000000,0.375118,0.000000,0.926977,0.000000,0.401431,0.000000,0.915889,0.000000,0.403243,0.000000,0.915093,0.000000,0.396958,0.000000,0.917837,0.000000,0.355792,0.000000,0.934565,0.000000,0.187310,0.000000,0.982301,0.000000,0.046730,0.000000,0.998908,0.000000,0.006059,0.000000,0.999982,0.000000,0.006059,0.000000,0.999982,0.000000,0.006059,0.000000,0.999982,-0.568079,0.030262,0.822257,-0.016250,-0.568079,0.030262,0.822257,-0.016250,-0.549608,0.020124,0.835091,-0.012216,-0.520250,0.002386,0.854005,-0.003215,-0.502430,-0.004345,0.864607,0.000627,-0.499318,-0.002633,0.866414,0.000863,-0.505648,0.003315,0.862732,-0.001566,-0.526934,0.008730,0.849847,-0.004846,-0.553304,0.013858,0.832825,-0.008032,-0.571718,0.018297,0.820179,-0.010522,-0.574443,0.021324,0.818180,-0.011944,-0.568810,0.022791,0.822065,-0.012061,-0.545651,0.023557,0.837597,-0.011911,-0.518686,0.022231,0.854625,-0.009325,-0.508771,0.019770,0.860656,-0.005638,-0.536032,0.016221,0.844042,-0.000428,-0.572142,0.009737,0.820095,0.001734,-0.611598,-0.010966,0.791079,-0.004735,-0.644277,-0.016866,0.764535,-0.010444,-0.654198,-0.037697,0.754168,-0.042820,-0.630506,-0.018243,0.772152,-0.076875,-0.586629,0.001533,0.802144,-0.111488,-0.514008,0.050990,0.847866,-0.119666,-0.435714,0.103373,0.886027,-0.120101,-0.404095,0.128095,0.897288,-0.123183,-0.450797,0.101066,0.877094,-0.131434,-0.524939,0.057099,0.838665,-0.133490,-0.618820,-0.007011,0.775980,-0.121933,-0.700383,-0.086072,0.703110,-0.087699,-0.749780,-0.100339,0.650120,-0.071455,-0.755105,-0.081777,0.648384,-0.052223,-0.734405,-0.022266,0.677967,-0.022682,-0.612747,0.007206,0.790161,-0.011579,-0.568079,0.030262,0.822257,-0.016250,-0.568079,0.030262,0.822257,-0.016250,-0.568079,0.030262,0.822257,-0.016250,0.000000,0.252841,0.000000,0.967508,-0.000000,0.252868,-0.000000,0.967501,-0.000025,0.256271,-0.000006,0.966605,-0.000560,0.318734,-0.000104,0.947844,-0.001249,0.371152,-0.000163,0.928571,-0.002119,0.428765,-0.000148,0.903413,-0.003030,0.479963,-0.000035,0.877284,-0.003911,0.516722,0.000124,0.856144,-0.004514,0.538143,0.000258,0.842842,-0.004268,0.530123,0.000206,0.847910,-0.003529,0.501198,0.000041,0.865325,-0.002595,0.457646,-0.000094,0.889131,-0.000878,0.343891,-0.000143,0.939009,-0.000375,0.300184,-0.000077,0.953881,0.000020,0.250567,0.000005,0.968099,0.000004,0.252295,0.000001,0.967650,0.000001,0.252839,0.000000,0.967508,0.000000,0.252841,0.000000,0.967508,0.000000,0.543402,0.000000,0.839472,0.000000,0.543402,0.000000,0.839472,0.000000,0.518582,0.000000,0.855028,0.000000,0.473957,0.000000,0.880548,0.000000,0.272917,0.000000,0.962038,0.000000,0.237515,0.000000,0.971384,0.000000,0.253263,0.000000,0.967398,0.000000,0.252845,0.000000,0.967507,0.000000,0.252856,0.000000,0.967504,0.000000,0.250336,0.000000,0.968159,0.000000,0.267802,0.000000,0.963474,0.000000,0.320334,0.000000,0.947305,0.000000,0.446110,0.000000,0.894978,0.000000,0.488940,0.000000,0.872318,0.000000,0.532616,0.000000,0.846357,0.000000,0.543402,0.000000,0.839472,0.000000,0.543402,0.000000,0.839472};
+
+const unsigned int astro_boy_curve_translation_keys_count = 51;
+
+const float astro_boy_curve_translation_times[astro_boy_curve_translation_keys_count] = {0.000000,0.033333,0.066666,0.100000,0.133333,0.166667,0.200000,0.266667,0.300000,0.333333,0.366667,0.433333,0.500000,0.533333,0.566667,0.600000,0.633333,0.666667,0.700000,0.766667,0.800000,0.833333,0.866667,0.933333,1.033330,1.066670,1.100000,1.166670,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000};
+const float astro_boy_curve_translation_values[astro_boy_curve_translation_keys_count * 3] = {0.000000,0.057089,2.694200,0.000000,0.057089,2.694200,-0.019166,0.002650,2.683550,-0.054047,-0.078123,2.671730,-0.086592,-0.106590,2.678490,-0.119053,-0.100414,2.791330,-0.150276,-0.076964,2.907720,-0.205671,-0.007456,3.116030,-0.219109,0.013555,3.162690,-0.218214,0.014289,3.154390,-0.195101,0.018737,3.106850,-0.124861,0.032806,2.955240,-0.043661,0.049121,2.779860,-0.008539,0.057066,2.707950,0.021531,0.003596,2.673590,0.048744,-0.077015,2.659200,0.074534,-0.105168,2.663560,0.099097,-0.099434,2.780940,0.122563,-0.076374,2.901300,0.166433,-0.007398,3.115190,0.185903,0.013590,3.162690,0.199259,0.014372,3.153490,0.203953,0.018684,3.107360,0.176941,0.029846,2.987060,0.058444,0.048836,2.782920,0.011850,0.055436,2.711970,0.000000,0.057089,2.694200,0.000000,0.057089,2.694200,0.000000,0.000000,0.460646,0.000000,0.000000,0.483701,0.000000,0.000000,0.893339,0.000000,0.000000,0.296047,-0.029433,0.309156,0.602835,0.000000,0.000000,0.089840,0.000000,0.000000,0.493535,0.000000,-0.000009,0.431169,-0.029437,-0.309156,0.602815,0.000000,0.000017,-0.089840,0.000000,0.000000,-0.493535,0.000000,-0.000008,-0.431169,0.082237,0.000000,-0.128229,0.342428,-0.113329,-0.065132,0.000000,0.000000,1.002520,0.000000,0.000000,0.196466,0.000000,0.000000,1.149180,-0.342428,-0.113329,-0.065132,0.000000,0.000000,-1.002520,0.000000,0.000000,-0.196467,0.000000,0.000000,-1.149180,0.000000,0.000000,-0.627705,0.000000,0.000000,0.627705};
+
+const unsigned int astro_boy_curve_scale_keys_count = 24;
+
+const float astro_boy_curve_scale_times[astro_boy_curve_scale_keys_count] = {0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000,0.000000};
+const float astro_boy_curve_scale_values[astro_boy_curve_scale_keys_count * 3] = {1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,0.999999,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000001,1.000000,1.000001,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,0.999999,1.000001,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000,1.000000};
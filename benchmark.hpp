@@ -0,0 +1,1450 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_texture.hpp"
+#include "cpu_skinning.hpp"
+#include "crowd_animation.hpp"
+#include "headless.hpp"
+#include "math/rormatrix4.hpp"
+#include "math/rormatrix4_functions.hpp"
+#include "palette_cache.hpp"
+#include "pose_batch.hpp"
+#include "pose_blend.hpp"
+#include "quantized_track.hpp"
+#include "simd_kernels.hpp"
+#include "static_hierarchy.hpp"
+#include "skeletal_animation.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Micro benchmarks, run with ./simple_skeletal_animation --benchmark
+// Results are written to benchmark_sink so the compiler can't throw the work away
+
+volatile float benchmark_sink = 0.0f;
+
+unsigned int benchmark_failures_count = 0;        // Checks that failed, --benchmark exits with 1 if there are any
+
+// "ok" or "FAILED" for the result of a check, counting the failures
+const char *benchmark_check(bool a_passed)
+{
+	if (!a_passed)
+		++benchmark_failures_count;
+
+	return a_passed ? "ok" : "FAILED";
+}
+
+// Runs a_function a_iterations times and prints the average time per iteration
+template <typename _function>
+double benchmark(const char *a_name, unsigned int a_iterations, _function &&a_function)
+{
+	a_function();        // Warm up
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (unsigned int i = 0; i < a_iterations; ++i)
+		a_function();
+
+	auto   end        = std::chrono::high_resolution_clock::now();
+	double nano_count = std::chrono::duration<double, std::nano>(end - start).count() / a_iterations;
+
+	std::printf("%-56s %12.1f ns\n", a_name, nano_count);
+
+	return nano_count;
+}
+
+Transform benchmark_random_transform(std::mt19937 &a_generator)
+{
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	Quaternion rotation = quaternion_normalize(Quaternion{distribution(a_generator), distribution(a_generator), distribution(a_generator), distribution(a_generator)});
+
+	return Transform{rotation,
+					 ror::Vector3f(distribution(a_generator), distribution(a_generator), distribution(a_generator)),
+					 ror::Vector3f(1.0f, 1.0f, 1.0f)};
+}
+
+void benchmark_simd_kernels()
+{
+	const unsigned int count      = astro_boy_joints_count;        // Palette sized batches
+	const unsigned int iterations = 100000;
+
+	std::mt19937 generator(1234);
+
+	std::vector<ror::Matrix4f> left(count), right(count), out(count);
+	std::vector<Quaternion>    from(count), to(count), quaternions_out(count);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		left[i]  = transform_to_matrix(benchmark_random_transform(generator));
+		right[i] = transform_to_matrix(benchmark_random_transform(generator));
+		from[i]  = benchmark_random_transform(generator).m_rotation;
+		to[i]    = benchmark_random_transform(generator).m_rotation;
+	}
+
+	std::printf("\nSIMD kernels, %u matrices/quaternions per iteration, selected: %s\n", count, simd_kernels().m_name);
+
+	benchmark("ror::Matrix4f operator*", iterations, [&]() {
+		for (unsigned int i = 0; i < count; ++i)
+			out[i] = left[i] * right[i];
+		benchmark_sink = out[count - 1].m_values[0];
+	});
+
+	benchmark("ror::matrix4_interpolate", iterations, [&]() {
+		for (unsigned int i = 0; i < count; ++i)
+			out[i] = ror::matrix4_interpolate(left[i], right[i], 0.3f);
+		benchmark_sink = out[count - 1].m_values[0];
+	});
+
+	benchmark("quaternion_nlerp", iterations, [&]() {
+		for (unsigned int i = 0; i < count; ++i)
+			quaternions_out[i] = quaternion_nlerp(from[i], to[i], 0.3f);
+		benchmark_sink = quaternions_out[count - 1].x;
+	});
+
+	for (auto level : {SimdLevel::scalar, SimdLevel::sse4, SimdLevel::avx2, SimdLevel::neon})
+	{
+		if (!simd_level_supported(level))
+			continue;
+
+		auto kernels = get_simd_kernels(level);
+		char name[128];
+
+		std::snprintf(name, sizeof(name), "%s matrix4_multiply_batch", kernels.m_name);
+		benchmark(name, iterations, [&]() {
+			kernels.m_matrix4_multiply_batch(left.data()->m_values, right.data()->m_values, out.data()->m_values, count);
+			benchmark_sink = out[count - 1].m_values[0];
+		});
+
+		std::snprintf(name, sizeof(name), "%s matrix4_multiply_affine", kernels.m_name);
+		benchmark(name, iterations, [&]() {
+			for (unsigned int i = 0; i < count; ++i)
+				kernels.m_matrix4_multiply_affine(left[i].m_values, right[i].m_values, out[i].m_values);
+			benchmark_sink = out[count - 1].m_values[0];
+		});
+
+		std::snprintf(name, sizeof(name), "%s matrix4_interpolate", kernels.m_name);
+		benchmark(name, iterations, [&]() {
+			for (unsigned int i = 0; i < count; ++i)
+				kernels.m_matrix4_interpolate(left[i].m_values, right[i].m_values, 0.3f, out[i].m_values);
+			benchmark_sink = out[count - 1].m_values[0];
+		});
+
+		std::snprintf(name, sizeof(name), "%s quaternion_nlerp_batch", kernels.m_name);
+		benchmark(name, iterations, [&]() {
+			kernels.m_quaternion_nlerp_batch(from.data(), to.data(), 0.3f, quaternions_out.data(), count);
+			benchmark_sink = quaternions_out[count - 1].x;
+		});
+	}
+}
+
+// Palettes for a crowd of astro boys at different times, one at a time against PoseBatch
+void benchmark_pose_batch()
+{
+	const unsigned int instances_count = 1024;
+	const unsigned int iterations      = 100;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	std::mt19937                          generator(1234);
+	std::uniform_real_distribution<float> distribution(0.0f, clip.loop_duration());
+
+	std::vector<AnimationPlayer> instances(instances_count);
+	for (auto &instance : instances)
+		instance = AnimationPlayer(&clip, distribution(generator));
+
+	std::vector<Transform>     world_transforms;
+	std::vector<ror::Matrix4f> joint_matrices;
+	std::vector<ror::Matrix4f> palettes(instances_count * skeleton.joints_count());
+
+	std::printf("\nPose evaluation, %u instances of %u joints per iteration\n", instances_count, skeleton.joints_count());
+
+	benchmark("evaluate_world_transforms + get_joint_matrices", iterations, [&]() {
+		for (auto &instance : instances)
+		{
+			evaluate_world_transforms(skeleton, instance, world_transforms);
+			get_joint_matrices(skeleton, world_transforms, joint_matrices);
+		}
+		benchmark_sink = joint_matrices[0].m_values[0];
+	});
+
+	PoseBatch<4> batch4(skeleton);
+	PoseBatch<8> batch8(skeleton);
+
+	// Largest difference of any palette value against the scalar path
+	auto parity = [&](const char *a_name) {
+		float error = 0.0f;
+
+		for (unsigned int i = 0; i < instances_count; ++i)
+		{
+			evaluate_world_transforms(skeleton, instances[i], world_transforms);
+			get_joint_matrices(skeleton, world_transforms, joint_matrices);
+
+			for (unsigned int j = 0; j < skeleton.joints_count(); ++j)
+				for (unsigned int v = 0; v < 16; ++v)
+					error = std::max(error, std::abs(joint_matrices[j].m_values[v] - palettes[i * skeleton.joints_count() + j].m_values[v]));
+		}
+
+		std::printf("%s largest palette difference from the scalar path %f %s\n", a_name, error, benchmark_check(error < 1e-4f));
+	};
+
+	benchmark("PoseBatch<4>", iterations, [&]() {
+		batch4.evaluate(instances.data(), instances_count, palettes.data());
+		benchmark_sink = palettes[0].m_values[0];
+	});
+
+	parity("PoseBatch<4>");
+
+	benchmark("PoseBatch<8>", iterations, [&]() {
+		batch8.evaluate(instances.data(), instances_count, palettes.data());
+		benchmark_sink = palettes[0].m_values[0];
+	});
+
+	parity("PoseBatch<8>");
+
+	std::printf("PoseBatch lanes for this build %u\n", pose_batch_lanes);
+}
+
+// Blends a crossfade and a masked additive upper body layer, against evaluating the whole pose once per clip
+void benchmark_pose_blend()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	// Only one clip available, so the same clip at different times stands in for walk, idle and an overlay
+	AnimationPlayer walk(&clip, 0.2f), idle(&clip, 0.7f), overlay(&clip, 0.4f), reference_player(&clip, 0.0f);
+
+	PoseBlender<>  blender(skeleton, 3);
+	LocalPose      reference(skeleton), pose(skeleton);
+	JointMask      upper_body(skeleton);
+
+	blender.sample(reference_player, reference);
+	upper_body.set_subtree(skeleton, static_cast<unsigned int>(skeleton.find("spine02")), 1.0f);
+
+	BlendLayer layers[] = {{&walk, 1.0f, BlendMode::override, nullptr, nullptr},
+						   {&idle, 0.3f, BlendMode::override, nullptr, nullptr},
+						   {&overlay, 0.8f, BlendMode::additive, &upper_body, &reference}};
+
+	std::vector<Transform> world_transforms, expected;
+
+	// A single full weight layer must match plain evaluation
+	blender.blend(layers, 1, pose);
+	evaluate_world_transforms(skeleton, pose, world_transforms);
+	evaluate_world_transforms(skeleton, walk, expected);
+
+	float error = 0.0f;
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		const Transform &a = world_transforms[i], &b = expected[i];
+		error = std::max({error, std::abs(a.m_rotation.x - b.m_rotation.x), std::abs(a.m_rotation.y - b.m_rotation.y), std::abs(a.m_rotation.z - b.m_rotation.z),
+						  std::abs(a.m_rotation.w - b.m_rotation.w), std::abs(a.m_translation.x - b.m_translation.x),
+						  std::abs(a.m_translation.y - b.m_translation.y), std::abs(a.m_translation.z - b.m_translation.z)});
+	}
+
+	std::printf("\nPose blending, %u nodes, PoseBlender single layer max error against evaluate_world_transforms %g %s\n", skeleton.size(), error,
+				benchmark_check(error < 1e-4f));
+
+	// The crossfade and the masked additive layer against the same blend one node at a time with the scalar transform functions
+	blender.blend(layers, 3, pose);
+
+	float blend_error = 0.0f;
+	for (unsigned int i = 0; i < skeleton.size(); ++i)
+	{
+		Transform blended = skeleton.local_bind(i);
+
+		for (BlendLayer &layer : layers)
+		{
+			const TrackTable &tracks = layer.m_player->clip()->tracks();
+			int               track  = tracks.track(i);
+			Transform         sample = track != -1 ? tracks.sample(track, layer.m_player->sample()) : skeleton.local_bind(i);
+			float             weight = layer.m_weight * (layer.m_mask ? layer.m_mask->weight(i) : 1.0f);
+
+			if (layer.m_mode == BlendMode::override)
+			{
+				blended = weight == 1.0f ? sample : transform_interpolate(blended, sample, weight);
+				continue;
+			}
+
+			const Transform  reference = layer.m_reference->get(i);
+			const Quaternion inverse{-reference.m_rotation.x, -reference.m_rotation.y, -reference.m_rotation.z, reference.m_rotation.w};
+			const Quaternion delta = quaternion_nlerp(quaternion_identity(), quaternion_multiply(inverse, sample.m_rotation), weight);
+
+			blended.m_rotation    = quaternion_multiply(blended.m_rotation, delta);
+			blended.m_translation = ror::Vector3f(blended.m_translation.x + (sample.m_translation.x - reference.m_translation.x) * weight,
+												  blended.m_translation.y + (sample.m_translation.y - reference.m_translation.y) * weight,
+												  blended.m_translation.z + (sample.m_translation.z - reference.m_translation.z) * weight);
+			blended.m_scale       = ror::Vector3f(blended.m_scale.x * (1.0f + (sample.m_scale.x / reference.m_scale.x - 1.0f) * weight),
+												  blended.m_scale.y * (1.0f + (sample.m_scale.y / reference.m_scale.y - 1.0f) * weight),
+												  blended.m_scale.z * (1.0f + (sample.m_scale.z / reference.m_scale.z - 1.0f) * weight));
+		}
+
+		const Transform a = pose.get(i);
+		blend_error       = std::max({blend_error, std::abs(a.m_rotation.x - blended.m_rotation.x), std::abs(a.m_rotation.y - blended.m_rotation.y),
+									  std::abs(a.m_rotation.z - blended.m_rotation.z), std::abs(a.m_rotation.w - blended.m_rotation.w),
+									  std::abs(a.m_translation.x - blended.m_translation.x), std::abs(a.m_translation.y - blended.m_translation.y),
+									  std::abs(a.m_translation.z - blended.m_translation.z), std::abs(a.m_scale.x - blended.m_scale.x),
+									  std::abs(a.m_scale.y - blended.m_scale.y), std::abs(a.m_scale.z - blended.m_scale.z)});
+	}
+
+	std::printf("PoseBlender 3 layer crossfade and masked additive max error against the scalar transform functions %g %s\n", blend_error,
+				benchmark_check(blend_error < 1e-5f));
+
+	benchmark("evaluate_world_transforms x1", iterations, [&]() {
+		evaluate_world_transforms(skeleton, walk, world_transforms);
+		benchmark_sink = world_transforms[1].m_rotation.x;
+	});
+
+	benchmark("evaluate_world_transforms x3", iterations, [&]() {
+		evaluate_world_transforms(skeleton, walk, world_transforms);
+		evaluate_world_transforms(skeleton, idle, world_transforms);
+		evaluate_world_transforms(skeleton, overlay, world_transforms);
+		benchmark_sink = world_transforms[1].m_rotation.x;
+	});
+
+	benchmark("PoseBlender 3 layers", iterations, [&]() {
+		blender.blend(layers, 3, pose);
+		benchmark_sink = pose.component(LocalPose::qx)[1];
+	});
+
+	benchmark("PoseBlender 3 layers + hierarchy", iterations, [&]() {
+		blender.blend(layers, 3, pose);
+		evaluate_world_transforms(skeleton, pose, world_transforms);
+		benchmark_sink = world_transforms[1].m_rotation.x;
+	});
+}
+
+// Pose and palette cost of each animation lod, amortised over its update interval
+void benchmark_animation_lod()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton        skeleton = create_astro_boy_skeleton();
+	AnimationClip   clip     = create_astro_boy_clip(skeleton);
+	AnimationPlayer player(&clip, 0.55f);
+	AnimationLod    lod(skeleton, get_astro_boy_lod_levels());
+
+	std::vector<Transform> world_transforms;
+	std::vector<Matrix3x4> palette;
+
+	std::printf("\nAnimation lod, %u nodes %u joints at full detail\n", skeleton.size(), skeleton.joints_count());
+
+	for (unsigned int level = 0; level < lod.levels_count(); ++level)
+	{
+		unsigned int tracks_count = 0;
+		for (auto node : lod.nodes(level))
+			tracks_count += clip.tracks().track(node) != -1;
+
+		char name[128];
+		std::snprintf(name, sizeof(name), "level %u, %zu nodes %u tracks %u joints, every %u frames", level, lod.nodes(level).size(), tracks_count,
+					  lod.joints_count(level), lod.update_interval(level));
+
+		double nano_count = benchmark(name, iterations, [&]() {
+			evaluate_world_transforms(skeleton, player, lod, level, world_transforms);
+			get_joint_matrices(skeleton, world_transforms, lod, level, palette);
+			benchmark_sink = palette[0].m_values[0];
+		});
+
+		std::printf("%-56s %12.1f ns per frame, %zu bytes uploaded\n", "", nano_count / lod.update_interval(level), palette.size() * sizeof(Matrix3x4));
+	}
+}
+
+// World space joint position error of the keyframe reduced curves against the dense track table at every original keyframe, plus sizes and sampling cost
+void benchmark_curve_tracks()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton        skeleton = create_astro_boy_skeleton();
+	AnimationClip   clip     = create_astro_boy_clip(skeleton);
+	AnimationPlayer player(&clip, 0.55f);
+	CurveTrackTable curves = create_astro_boy_curve_track_table(skeleton);
+
+	std::vector<Transform> world_transforms, expected;
+
+	float error = 0.0f;
+	for (unsigned int k = 0; k < astro_boy_animation_keyframes_count; ++k)
+	{
+		evaluate_world_transforms(skeleton, clip.tracks(), KeyframeSpan{k, k, 0.0f}, expected);
+		evaluate_world_transforms(skeleton, curves, astro_boy_animation_keyframe_times[k], world_transforms);
+
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			ror::Vector3f delta = world_transforms[i].m_translation - expected[i].m_translation;
+			error               = std::max(error, std::sqrt(delta.x * delta.x + delta.y * delta.y + delta.z * delta.z));
+		}
+	}
+
+	size_t dense_size = clip.tracks().tracks_count() * clip.tracks().keyframes_count() * (sizeof(Quaternion) + sizeof(ror::Vector3f) * 2);
+
+	// Within the tolerance the generator reduced the keys to, see astro_boy_animation_curves.hpp
+	std::printf("\nCurve tracks, %u keys instead of %u, %zu bytes instead of %zu, max world space joint error %g %s\n", curves.keys_count(),
+				clip.tracks().tracks_count() * clip.tracks().keyframes_count() * 3, curves.size_in_bytes(), dense_size, error, benchmark_check(error < 0.01f));
+
+	benchmark("evaluate_world_transforms TrackTable", iterations, [&]() {
+		evaluate_world_transforms(skeleton, player, world_transforms);
+		benchmark_sink = world_transforms[1].m_rotation.x;
+	});
+
+	benchmark("evaluate_world_transforms CurveTrackTable", iterations, [&]() {
+		evaluate_world_transforms(skeleton, curves, 0.55f, world_transforms);
+		benchmark_sink = world_transforms[1].m_rotation.x;
+	});
+}
+
+// Sizes of the quantized tracks against the collada matrices and the float track table, world space error and decode cost
+void benchmark_quantized_tracks()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton            skeleton = create_astro_boy_skeleton();
+	TrackTable          tracks   = create_astro_boy_track_table(skeleton);
+	QuantizedTrackTable quantized(tracks, skeleton.size());
+	LocalPose           pose(skeleton);
+
+	std::vector<Transform> world_transforms, expected;
+
+	// Every keyframe and the middle of every keyframe interval, through the SIMD decode and the scalar one
+	float error = 0.0f, scalar_error = 0.0f;
+	for (unsigned int k = 0; k + 1 < tracks.keyframes_count(); ++k)
+	{
+		for (float t : {0.0f, 0.5f})
+		{
+			KeyframeSpan span{k, k + 1, t};
+
+			evaluate_world_transforms(skeleton, tracks, span, expected);
+
+			quantized.sample<8>(span, pose);
+			evaluate_world_transforms(skeleton, pose, world_transforms);
+
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				ror::Vector3f delta = world_transforms[i].m_translation - expected[i].m_translation;
+				error               = std::max(error, std::sqrt(delta.x * delta.x + delta.y * delta.y + delta.z * delta.z));
+			}
+
+			for (unsigned int i = 0; i < skeleton.size(); ++i)
+			{
+				if (quantized.track(i) == -1)
+					continue;
+
+				Transform a = quantized.sample(quantized.track(i), span), b = pose.get(i);
+				scalar_error = std::max({scalar_error, std::abs(a.m_rotation.x - b.m_rotation.x), std::abs(a.m_rotation.y - b.m_rotation.y),
+										 std::abs(a.m_rotation.z - b.m_rotation.z), std::abs(a.m_rotation.w - b.m_rotation.w),
+										 std::abs(a.m_translation.x - b.m_translation.x), std::abs(a.m_translation.y - b.m_translation.y),
+										 std::abs(a.m_translation.z - b.m_translation.z)});
+			}
+		}
+	}
+
+	size_t matrices_size = tracks.tracks_count() * tracks.keyframes_count() * sizeof(ror::Matrix4f);
+	size_t tracks_size   = tracks.tracks_count() * tracks.keyframes_count() * (sizeof(Quaternion) + sizeof(ror::Vector3f) * 2);
+
+	std::printf("\nQuantized tracks, %zu bytes, %.1fx smaller than %zu bytes of matrices, %.1fx smaller than %zu bytes of TrackTable\n", quantized.size_in_bytes(),
+				static_cast<double>(matrices_size) / quantized.size_in_bytes(), matrices_size, static_cast<double>(tracks_size) / quantized.size_in_bytes(),
+				tracks_size);
+	std::printf("Max world space joint error %g, SIMD decode against scalar decode %g %s\n", error, scalar_error, benchmark_check(scalar_error < 1e-5f));
+
+	KeyframeSpan span{16, 17, 0.3f};
+
+	benchmark("TrackTable sample all tracks into LocalPose", iterations, [&]() {
+		for (unsigned int i = 0; i < skeleton.size(); ++i)
+			if (tracks.track(i) != -1)
+				pose.set(i, tracks.sample(tracks.track(i), span));
+		benchmark_sink = pose.component(LocalPose::qx)[1];
+	});
+
+	benchmark("QuantizedTrackTable scalar decode into LocalPose", iterations, [&]() {
+		for (unsigned int i = 0; i < skeleton.size(); ++i)
+			if (quantized.track(i) != -1)
+				pose.set(i, quantized.sample(quantized.track(i), span));
+		benchmark_sink = pose.component(LocalPose::qx)[1];
+	});
+
+	benchmark("QuantizedTrackTable decode<4> into LocalPose", iterations, [&]() {
+		quantized.sample<4>(span, pose);
+		benchmark_sink = pose.component(LocalPose::qx)[1];
+	});
+
+	benchmark("QuantizedTrackTable decode<8> into LocalPose", iterations, [&]() {
+		quantized.sample<8>(span, pose);
+		benchmark_sink = pose.component(LocalPose::qx)[1];
+	});
+}
+
+// Baked palettes against full evaluation, accuracy between the baked frames and LRU behaviour with more clips than the budget holds
+void benchmark_palette_cache()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	std::vector<Transform> world_transforms;
+	std::vector<Matrix3x4> expected, palette(skeleton.joints_count());
+
+	std::printf("\nPalette cache, %u joints, clip of %.3f seconds\n", skeleton.joints_count(), clip.loop_duration());
+
+	for (float rate : {30.0f, 60.0f})
+	{
+		BakedClip baked(skeleton, clip, rate);
+
+		// Halfway between baked frames is where the lerp is furthest from the real pose
+		float error = 0.0f;
+		for (unsigned int f = 0; f < baked.frames_count(); ++f)
+		{
+			AnimationPlayer player(&clip, (static_cast<float>(f) + 0.5f) * clip.loop_duration() / static_cast<float>(baked.frames_count()));
+
+			evaluate_world_transforms(skeleton, player, world_transforms);
+			get_joint_matrices(skeleton, world_transforms, expected);
+			baked.sample(player.time(), palette.data());
+
+			for (size_t j = 0; j < expected.size(); ++j)
+				for (unsigned int v = 0; v < 12; ++v)
+					error = std::max(error, std::abs(expected[j].m_values[v] - palette[j].m_values[v]));
+		}
+
+		std::printf("Baked at %.0f fps, %u frames, %zu bytes, max palette error %g\n", static_cast<double>(rate), baked.frames_count(), baked.size_in_bytes(),
+					static_cast<double>(error));
+	}
+
+	AnimationPlayer player(&clip, 0.55f);
+	PaletteCache    cache(skeleton, 1024 * 1024);
+
+	benchmark("evaluate_world_transforms + get_joint_matrices", iterations, [&]() {
+		evaluate_world_transforms(skeleton, player, world_transforms);
+		get_joint_matrices(skeleton, world_transforms, expected);
+		benchmark_sink = expected[0].m_values[0];
+	});
+
+	benchmark("PaletteCache::sample", iterations, [&]() {
+		cache.sample(player, palette.data());
+		benchmark_sink = palette[0].m_values[0];
+	});
+
+	// Copies of the clip stand in for a library of clips, the budget holds 3 of them
+	// Every frame two crowds play the two hot clips and one character plays the next of 6 cold clips
+	std::vector<AnimationClip> clips(8, clip);
+	PaletteCache               small_cache(skeleton, cache.size_in_bytes() * 3);
+
+	const unsigned int frames_count = 60;
+	for (unsigned int frame = 0; frame < frames_count; ++frame)
+		for (unsigned int c : {0u, 1u, 2u + frame % 6})
+		{
+			AnimationPlayer clip_player(&clips[c], 0.02f * frame);
+			small_cache.sample(clip_player, palette.data());
+		}
+
+	std::printf("LRU over %u frames of 2 hot and 6 cold clips with room for 3, %u bakes, %u evictions, %zu of %zu bytes used\n", frames_count,
+				small_cache.bakes_count(), small_cache.evictions_count(), small_cache.size_in_bytes(), small_cache.budget());
+}
+
+// Palettes interpolated between fixed rate animation ticks against evaluating every rendered frame
+void benchmark_tick_interpolation()
+{
+	const unsigned int iterations  = 10000;
+	const float        render_rate = 240.0f;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	std::vector<Transform>      world_transforms;
+	std::vector<Matrix3x4>      from, to, expected, palette;
+	std::vector<DualQuaternion> dq_from, dq_to, dq_expected, dq_palette;
+
+	std::printf("\nTick interpolation, %u joints rendered at %.0f fps\n", skeleton.joints_count(), static_cast<double>(render_rate));
+
+	auto evaluate = [&](float a_time, std::vector<Matrix3x4> &a_palette, std::vector<DualQuaternion> &a_dq_palette) {
+		AnimationPlayer player(&clip, a_time);
+		evaluate_world_transforms(skeleton, player, world_transforms);
+		get_joint_matrices(skeleton, world_transforms, a_palette);
+		get_joint_matrices(skeleton, world_transforms, a_dq_palette);
+	};
+
+	for (float tick_rate : {30.0f, 60.0f})
+	{
+		float tick  = 1.0f / tick_rate;
+		float error = 0.0f, dq_error = 0.0f;
+
+		// Every rendered frame between every pair of ticks of the whole loop
+		for (float time = 0.0f; time + tick <= clip.loop_duration(); time += tick)
+		{
+			evaluate(time, from, dq_from);
+			evaluate(time + tick, to, dq_to);
+
+			for (float t = 0.0f; t < 1.0f; t += tick_rate / render_rate)
+			{
+				evaluate(time + t * tick, expected, dq_expected);
+				interpolate_joint_matrices(from, to, t, palette);
+				interpolate_joint_matrices(dq_from, dq_to, t, dq_palette);
+
+				for (size_t j = 0; j < expected.size(); ++j)
+				{
+					for (unsigned int v = 0; v < 12; ++v)
+						error = std::max(error, std::abs(expected[j].m_values[v] - palette[j].m_values[v]));
+
+					float sign = quaternion_dot(dq_expected[j].m_real, dq_palette[j].m_real) < 0.0f ? -1.0f : 1.0f;
+					for (unsigned int v = 0; v < 8; ++v)
+						dq_error = std::max(dq_error, std::abs((&dq_expected[j].m_real.x)[v] - sign * (&dq_palette[j].m_real.x)[v]));
+				}
+			}
+		}
+
+		std::printf("Ticks at %.0f Hz, %.0f hierarchy evaluations per second instead of %.0f, max palette error %g, dual quaternion %g\n", static_cast<double>(tick_rate),
+					static_cast<double>(tick_rate), static_cast<double>(render_rate), static_cast<double>(error), static_cast<double>(dq_error));
+	}
+
+	AnimationPlayer player(&clip, 0.55f);
+
+	benchmark("evaluate_world_transforms + get_joint_matrices", iterations, [&]() {
+		evaluate_world_transforms(skeleton, player, world_transforms);
+		get_joint_matrices(skeleton, world_transforms, expected);
+		benchmark_sink = expected[0].m_values[0];
+	});
+
+	benchmark("interpolate_joint_matrices", iterations, [&]() {
+		interpolate_joint_matrices(from, to, 0.3f, palette);
+		benchmark_sink = palette[0].m_values[0];
+	});
+
+	benchmark("interpolate_joint_matrices dual quaternion", iterations, [&]() {
+		interpolate_joint_matrices(dq_from, dq_to, 0.3f, dq_palette);
+		benchmark_sink = dq_palette[0].m_real.x;
+	});
+}
+
+// Spine of a_depth joints with every other one animated, each with a hand like branch of a static orient node, 3 static joints and an end node
+void benchmark_synthetic_rig(unsigned int a_depth, Skeleton &a_skeleton, TrackTable &a_tracks)
+{
+	std::mt19937 generator(a_depth);
+
+	auto add = [&](const char *a_name, int a_parent, bool a_joint) {
+		Transform local = benchmark_random_transform(generator);
+		a_skeleton.add_node(a_name, a_parent, a_joint, local, transform_to_matrix(local), ror::Matrix4f());
+		return static_cast<int>(a_skeleton.size()) - 1;
+	};
+
+	std::vector<unsigned int> animated;
+
+	a_skeleton = Skeleton();
+	add("root", -1, false);
+
+	for (int i = 0, spine = 0; i < static_cast<int>(a_depth); ++i)
+	{
+		spine = add("spine", spine, true);
+		if (i % 2 == 0)
+			animated.push_back(static_cast<unsigned int>(spine));
+
+		int branch = add("orient", spine, false);
+		for (int j = 0; j < 3; ++j)
+			branch = add("finger", branch, true);
+		add("end", branch, false);
+	}
+
+	a_tracks = TrackTable(a_skeleton.size(), 4, static_cast<unsigned int>(animated.size()));
+	for (auto node : animated)
+		a_tracks.add_track(node, {benchmark_random_transform(generator), benchmark_random_transform(generator), benchmark_random_transform(generator),
+								  benchmark_random_transform(generator)});
+}
+
+// Multiplies and time of the static hierarchy against the full hierarchy pass, playing and paused
+void benchmark_static_hierarchy()
+{
+	const unsigned int iterations = 10000;
+
+	Skeleton   skeleton = create_astro_boy_skeleton();
+	TrackTable tracks   = create_astro_boy_track_table(skeleton);
+
+	std::printf("\nStatic hierarchy\n");
+
+	auto report = [&](const char *a_name, const Skeleton &a_skeleton, const TrackTable &a_tracks) {
+		StaticHierarchy        hierarchy(a_skeleton, a_tracks);
+		HierarchyState         state;
+		std::vector<Transform> world_transforms, expected;
+
+		// Joints must match the full pass on every frame
+		float        error   = 0.0f;
+		unsigned int playing = 0;
+		for (unsigned int k = 0; k + 1 < a_tracks.keyframes_count(); ++k)
+		{
+			KeyframeSpan span{k, k + 1, 0.25f};
+
+			hierarchy.evaluate(a_tracks, span, state, world_transforms);
+			evaluate_world_transforms(a_skeleton, a_tracks, span, expected);
+
+			if (k > 0)
+				playing = std::max(playing, state.m_multiplies_count);
+
+			for (unsigned int i = 0; i < a_skeleton.size(); ++i)
+				if (a_skeleton.is_joint(i))
+					error = std::max({error, std::abs(world_transforms[i].m_translation.x - expected[i].m_translation.x),
+									  std::abs(world_transforms[i].m_translation.y - expected[i].m_translation.y),
+									  std::abs(world_transforms[i].m_translation.z - expected[i].m_translation.z)});
+		}
+
+		hierarchy.evaluate(a_tracks, state.m_span, state, world_transforms);
+
+		std::printf("%s, %u nodes, %u constant %u folded %u evaluated, multiplies per frame %u full, %u playing, %u paused, joint error %g %s\n", a_name,
+					a_skeleton.size(), hierarchy.constant_count(), hierarchy.folded_count(), hierarchy.evaluated_count(), hierarchy.full_multiplies_count(),
+					playing, state.m_multiplies_count, static_cast<double>(error), benchmark_check(error < 1e-3f));
+
+		KeyframeSpan spans[2] = {{0, 1, 0.25f}, {0, 1, 0.75f}};
+		unsigned int frame    = 0;
+
+		char name[128];
+		std::snprintf(name, sizeof(name), "%s evaluate_world_transforms", a_name);
+		benchmark(name, iterations, [&]() {
+			evaluate_world_transforms(a_skeleton, a_tracks, spans[++frame & 1], expected);
+			benchmark_sink = expected.back().m_translation.x;
+		});
+
+		std::snprintf(name, sizeof(name), "%s StaticHierarchy", a_name);
+		benchmark(name, iterations, [&]() {
+			hierarchy.evaluate(a_tracks, spans[++frame & 1], state, world_transforms);
+			benchmark_sink = world_transforms.back().m_translation.x;
+		});
+	};
+
+	report("astro boy", skeleton, tracks);
+
+	for (unsigned int depth : {16u, 64u})
+	{
+		Skeleton   rig;
+		TrackTable rig_tracks;
+		char       name[64];
+
+		benchmark_synthetic_rig(depth, rig, rig_tracks);
+		std::snprintf(name, sizeof(name), "synthetic depth %u", depth);
+		report(name, rig, rig_tracks);
+	}
+}
+
+// Checks every skinning kernel against skin_vertices_reference, then measures vertices per second per core
+void benchmark_cpu_skinning()
+{
+	const unsigned int iterations = 200;
+
+	Skeleton        skeleton = create_astro_boy_skeleton();
+	AnimationClip   clip     = create_astro_boy_clip(skeleton);
+	AnimationPlayer player(&clip, 0.55f);
+
+	std::vector<Transform>     world_transforms;
+	std::vector<ror::Matrix4f> palette;
+	std::vector<Matrix3x4>     palette_rows;
+
+	evaluate_world_transforms(skeleton, player, world_transforms);
+	get_joint_matrices(skeleton, world_transforms, palette);
+	get_joint_matrices(skeleton, world_transforms, palette_rows);
+
+	SkinnedMesh mesh{astro_boy_positions, astro_boy_normals, astro_boy_weights, astro_boy_joints, astro_boy_vertex_count};
+
+	std::vector<float> reference_positions, reference_normals;
+	std::vector<float> positions(mesh.m_vertex_count * 3), normals(mesh.m_vertex_count * 3);
+
+	skin_vertices_reference(mesh, palette, reference_positions, reference_normals);
+
+	auto max_error = [&]() {
+		float error = 0.0f;
+		for (size_t i = 0; i < positions.size(); ++i)
+			error = std::max(error, std::max(std::abs(positions[i] - reference_positions[i]), std::abs(normals[i] - reference_normals[i])));
+		return error;
+	};
+
+	std::printf("\nCPU skinning, %u vertices per iteration\n", mesh.m_vertex_count);
+
+	for (auto level : {SimdLevel::scalar, SimdLevel::sse4, SimdLevel::avx2, SimdLevel::neon})
+	{
+		if (!simd_level_supported(level))
+			continue;
+
+		auto kernels = get_simd_kernels(level);
+		char name[128];
+
+		kernels.m_skin_vertices(mesh.m_positions, mesh.m_normals, mesh.m_weights, mesh.m_joints, palette_rows.data()->m_values, mesh.m_vertex_count,
+								positions.data(), normals.data());
+
+		float error = max_error();
+		std::printf("%s skin_vertices max error against reference %g %s\n", kernels.m_name, error, benchmark_check(error < 1e-4f));
+
+		std::snprintf(name, sizeof(name), "%s skin_vertices", kernels.m_name);
+		double nano_count = benchmark(name, iterations, [&]() {
+			kernels.m_skin_vertices(mesh.m_positions, mesh.m_normals, mesh.m_weights, mesh.m_joints, palette_rows.data()->m_values, mesh.m_vertex_count,
+									positions.data(), normals.data());
+			benchmark_sink = positions[0];
+		});
+
+		std::printf("%-56s %12.1f M vertices/s\n", "", mesh.m_vertex_count / nano_count * 1e3);
+	}
+
+	JobSystem   jobs;
+	CpuSkinning skinning(jobs);
+	skinning.skin(mesh, palette_rows.data(), positions.data(), normals.data());
+
+	float error = max_error();
+	std::printf("CpuSkinning %u threads max error against reference %g %s\n", skinning.threads_count(), error, benchmark_check(error < 1e-4f));
+
+	double nano_count = benchmark("CpuSkinning::skin", iterations, [&]() {
+		skinning.skin(mesh, palette_rows.data(), positions.data(), normals.data());
+		benchmark_sink = positions[0];
+	});
+
+	std::printf("%-56s %12.1f M vertices/s per core\n", "", mesh.m_vertex_count / nano_count * 1e3 / skinning.threads_count());
+}
+
+// Crowd update throughput with growing thread counts, palettes must match a single threaded PoseBatch
+void benchmark_crowd_animation()
+{
+	const unsigned int instances_count = 4096;
+	const unsigned int iterations      = 20;
+	const float        delta_time      = 1.0f / 60.0f;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	std::mt19937                          generator(1234);
+	std::uniform_real_distribution<float> distribution(0.0f, clip.loop_duration());
+	std::uniform_real_distribution<float> speeds(0.5f, 1.5f);
+
+	std::vector<AnimationPlayer> instances(instances_count);
+	for (auto &instance : instances)
+		instance = AnimationPlayer(&clip, distribution(generator), speeds(generator));
+
+	unsigned int joints_count = skeleton.joints_count();
+
+	std::vector<Matrix3x4> expected(instances_count * joints_count), palettes(instances_count * joints_count);
+	{
+		std::vector<AnimationPlayer> reference(instances);
+		for (auto &instance : reference)
+			instance.advance(delta_time);
+
+		PoseBatch<pose_batch_lanes> batch(skeleton);
+		batch.evaluate(reference.data(), instances_count, expected.data());
+	}
+
+	unsigned int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+	double       single_thread    = 0.0;
+
+	std::printf("\nCrowd animation update, %u instances of %u joints per iteration, %u hardware threads\n", instances_count, joints_count, hardware_threads);
+
+	for (unsigned int threads = 1;; threads = std::min(threads * 2, hardware_threads))
+	{
+		JobSystem                    jobs(threads);
+		CrowdAnimation<>             crowd(skeleton, jobs);
+		std::vector<AnimationPlayer> players(instances);
+
+		crowd.update(players.data(), instances_count, delta_time, palettes.data());
+
+		float error = 0.0f;
+		for (size_t i = 0; i < palettes.size(); ++i)
+			for (unsigned int e = 0; e < 12; ++e)
+				error = std::max(error, std::abs(palettes[i].m_values[e] - expected[i].m_values[e]));
+
+		std::printf("JobSystem %u threads max error against PoseBatch %g %s\n", threads, error, benchmark_check(error < 1e-5f));
+
+		char name[128];
+		std::snprintf(name, sizeof(name), "CrowdAnimation::update %u threads", threads);
+
+		double nano_count = benchmark(name, iterations, [&]() {
+			crowd.update(players.data(), instances_count, delta_time, palettes.data());
+			benchmark_sink = palettes[0].m_values[0];
+		});
+
+		if (threads == 1)
+			single_thread = nano_count;
+
+		std::printf("%-56s %12.1f instances/ms, %.2fx, %u steals\n", "", instances_count / nano_count * 1e6, single_thread / nano_count, jobs.steals_count());
+
+		if (threads == hardware_threads)
+			break;
+	}
+}
+
+// Palette uploads of a crowd through glBufferSubData into one uniform buffer against writing into a persistently mapped PaletteRing
+// Every character is a one point draw reading its palette, so the cost is the upload and binding rather than rasterisation
+// Needs a headless context, see headless.hpp
+void benchmark_palette_upload()
+{
+	const unsigned int iterations = 100;
+
+	HeadlessContext context;
+
+	std::printf("\nPalette upload\n");
+
+	if (!context.create(16, 16, 0))
+		return;
+
+	if (!buffer_storage_supported())
+	{
+		std::printf("No GL 4.4 for persistent mapping, skipped\n");
+		return;
+	}
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	unsigned int joints_count = skeleton.joints_count();
+	size_t       palette_size = joints_count * sizeof(Matrix3x4);
+
+	char vertex_shader_src[512];
+	std::snprintf(vertex_shader_src, sizeof(vertex_shader_src),
+				  "#version 330 core\n"
+				  "layout(std140) uniform joint_matrices\n"
+				  "{\n"
+				  "    vec4 joint_rows[%u];\n"
+				  "};\n"
+				  "void main()\n"
+				  "{\n"
+				  "    gl_Position = vec4(joint_rows[%u].xyz * 0.001, 1.0);\n"
+				  "}\n",
+				  joints_count * 3, joints_count * 3 - 1);
+
+	const char *fragment_shader_src =
+		"#version 330 core\n"
+		"out vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    color = vec4(1.0);\n"
+		"}\n";
+
+	GLuint program = compile_shaders(vertex_shader_src, fragment_shader_src);
+	GLuint vertex_array, uniform_buffer;
+
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "joint_matrices"), 0);
+	glGenVertexArrays(1, &vertex_array);
+	glGenBuffers(1, &uniform_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(palette_size), nullptr, GL_STATIC_DRAW);
+	glUseProgram(program);
+	glBindVertexArray(vertex_array);
+
+	for (unsigned int instances_count : {1u, 1000u})
+	{
+		std::vector<AnimationPlayer> instances(instances_count, AnimationPlayer(&clip));
+		std::vector<Matrix3x4>       palettes(instances_count * joints_count);
+
+		for (unsigned int i = 0; i < instances_count; ++i)
+			instances[i].seek(clip.loop_duration() * static_cast<float>(i) / static_cast<float>(instances_count));
+
+		PoseBatch<pose_batch_lanes> batch(skeleton);
+		batch.evaluate(instances.data(), instances_count, palettes.data());
+
+		PaletteRing ring(instances_count * palette_size);
+
+		// Submission on the CPU, then the whole frame until the GPU is done like a swap
+		auto frames = [&](const char *a_name, auto &&a_submit) {
+			double submit = 0.0, frame = 0.0;
+
+			for (unsigned int i = 0; i <= iterations; ++i)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				a_submit();
+				auto submitted = std::chrono::high_resolution_clock::now();
+				glFinish();
+				auto finished = std::chrono::high_resolution_clock::now();
+
+				// First frame is the warm up
+				if (i > 0)
+				{
+					submit += std::chrono::duration<double, std::nano>(submitted - start).count();
+					frame += std::chrono::duration<double, std::nano>(finished - start).count();
+				}
+			}
+
+			char name[128];
+			std::snprintf(name, sizeof(name), "%u character%s %s submit", instances_count, instances_count > 1 ? "s" : "", a_name);
+			std::printf("%-56s %12.1f ns\n", name, submit / iterations);
+			std::snprintf(name, sizeof(name), "%u character%s %s frame", instances_count, instances_count > 1 ? "s" : "", a_name);
+			std::printf("%-56s %12.1f ns\n", name, frame / iterations);
+		};
+
+		frames("glBufferSubData", [&]() {
+			for (unsigned int i = 0; i < instances_count; ++i)
+			{
+				glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer);
+				glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(palette_size), palettes.data() + i * joints_count);
+				glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniform_buffer, 0, static_cast<GLsizeiptr>(palette_size));
+				glDrawArrays(GL_POINTS, 0, 1);
+			}
+		});
+
+		frames("PaletteRing", [&]() {
+			ring.begin_frame();
+
+			for (unsigned int i = 0; i < instances_count; ++i)
+			{
+				GLintptr offset  = 0;
+				void *   palette = ring.allocate(palette_size, offset);
+
+				std::memcpy(palette, palettes.data() + i * joints_count, palette_size);
+				ring.bind(0, offset, palette_size);
+				glDrawArrays(GL_POINTS, 0, 1);
+			}
+
+			ring.end_frame();
+		});
+
+		std::printf("PaletteRing waited for the GPU %u times\n", ring.waits_count());
+	}
+
+	check_gl_error(__FILE__, __LINE__);
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glDeleteBuffers(1, &uniform_buffer);
+	glDeleteVertexArrays(1, &vertex_array);
+	glDeleteProgram(program);
+}
+
+// Quantisation error of PackedSkinnedVertex against the generator's floats, then drawing the astro boy from either format
+// Rasterisation is discarded so the draws cost vertex fetch and skinning only. Needs a headless context, see headless.hpp
+void benchmark_vertex_formats()
+{
+	const unsigned int iterations = 20;
+	const unsigned int draws      = 50;
+
+	unsigned int influences = astro_boy_weights_array_count / astro_boy_vertex_count;
+
+	auto vertices = pack_skinned_vertices(astro_boy_positions, astro_boy_normals, astro_boy_uvs, astro_boy_weights, astro_boy_joints, influences, astro_boy_vertex_count);
+
+	std::printf("\nVertex formats\n");
+
+	float normal_error = 0.0f, uv_error = 0.0f, weight_error = 0.0f;
+
+	for (unsigned int i = 0; i < astro_boy_vertex_count; ++i)
+	{
+		const PackedSkinnedVertex &vertex = vertices[i];
+
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			int   value  = static_cast<int>(vertex.m_normal << (22 - c * 10)) >> 22;        // Sign extends the 10 bits
+			float normal = std::max(static_cast<float>(value) / 511.0f, -1.0f);
+
+			normal_error = std::max(normal_error, std::abs(normal - astro_boy_normals[i * 3 + c]));
+		}
+
+		for (unsigned int c = 0; c < 2; ++c)
+		{
+			// Normal halfs only, the packing doesn't make denormals
+			uint32_t half = vertex.m_uv[c];
+			uint32_t bits = ((half & 0x8000u) << 16) | (half & 0x7fffu ? (((half >> 10) & 0x1fu) + 112) << 23 | (half & 0x3ffu) << 13 : 0);
+			float    uv;
+
+			std::memcpy(&uv, &bits, sizeof(uv));
+			uv_error = std::max(uv_error, std::abs(uv - astro_boy_uvs[i * 2 + c]));
+		}
+
+		for (unsigned int j = 0; j < influences; ++j)
+			weight_error = std::max(weight_error, std::abs(static_cast<float>(vertex.m_weights[j]) / 255.0f - astro_boy_weights[i * influences + j]));
+	}
+
+	size_t separate_size = astro_boy_vertex_count * ((3 + 3 + 2 + influences) * sizeof(float) + influences * sizeof(int));
+
+	std::printf("%-56s %12zu bytes\n", "Separate vertex buffers", separate_size);
+	std::printf("%-56s %12zu bytes\n", "Packed vertex buffer", vertices.size() * sizeof(PackedSkinnedVertex));
+	std::printf("Largest error of normal %f, uv %f and weight %f\n", normal_error, uv_error, weight_error);
+
+	HeadlessContext context;
+
+	if (!context.create(16, 16, 0))
+		return;
+
+	Skeleton skeleton = create_astro_boy_skeleton();
+
+	std::vector<Matrix3x4> palette;
+	get_joint_matrices(skeleton, palette);
+
+	// Reads every attribute so none of the fetches are optimised away
+	const char *vertex_shader_src =
+		"#version 330 core\n"
+		"layout (location = 0) in vec4 position;\n"
+		"layout (location = 1) in vec3 normal;\n"
+		"layout (location = 2) in vec2 uv;\n"
+		"layout (location = 3) in vec4 weights;\n"
+		"layout (location = 4) in uvec4 joints;\n"
+		"out vec3 normal_out;\n"
+		"out vec2 uv_out;\n"
+		"layout (std140) uniform joint_matrices\n"
+		"{\n"
+		"    vec4 joints_rows[256 * 3];\n"
+		"};\n"
+		"vec4 joint_row(uint row)\n"
+		"{\n"
+		"	 return joints_rows[joints.x * 3u + row] * weights.x +\n"
+		"		joints_rows[joints.y * 3u + row] * weights.y +\n"
+		"		joints_rows[joints.z * 3u + row] * weights.z +\n"
+		"		joints_rows[joints.w * 3u + row] * (1.0 - weights.x - weights.y - weights.z);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = vec4(dot(joint_row(0u), position), dot(joint_row(1u), position), dot(joint_row(2u), position), 1.0);\n"
+		"    normal_out = normal;\n"
+		"    uv_out = uv;\n"
+		"}\n";
+
+	const char *fragment_shader_src =
+		"#version 330 core\n"
+		"in vec3 normal_out;\n"
+		"in vec2 uv_out;\n"
+		"out vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    color = vec4(normal_out, uv_out.x);\n"
+		"}\n";
+
+	AnimatedGeometry separate(vertex_shader_src, fragment_shader_src, nullptr,
+							  sizeof(float) * astro_boy_positions_array_count, astro_boy_positions,
+							  sizeof(float) * astro_boy_normals_array_count, astro_boy_normals,
+							  sizeof(float) * astro_boy_uvs_array_count, astro_boy_uvs,
+							  sizeof(float) * astro_boy_weights_array_count, astro_boy_weights,
+							  sizeof(int) * astro_boy_joints_array_count, astro_boy_joints,
+							  sizeof(float) * astro_boy_indices_array_count, astro_boy_indices,
+							  astro_boy_indices_array_count, skeleton.joints_count(), PaletteMode::affine3x4);
+
+	AnimatedGeometry packed(vertex_shader_src, fragment_shader_src, nullptr, vertices,
+							sizeof(float) * astro_boy_indices_array_count, astro_boy_indices,
+							astro_boy_indices_array_count, skeleton.joints_count(), PaletteMode::affine3x4);
+
+	ror::Matrix4f identity;
+
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	for (AnimatedGeometry *geometry : {&separate, &packed})
+	{
+		geometry->update_matrices(palette);
+
+		char name[128];
+		std::snprintf(name, sizeof(name), "%u draws from %s vertices", draws, geometry == &packed ? "packed" : "separate");
+
+		benchmark(name, iterations, [&]() {
+			for (unsigned int i = 0; i < draws; ++i)
+				geometry->draw(identity.m_values, identity.m_values, identity.m_values, GL_TRIANGLES);
+
+			glFinish();
+		});
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	check_gl_error(__FILE__, __LINE__);
+}
+
+// Submission of a crowd as a palette upload and draw per character against all palettes in one texture buffer and one instanced draw
+// Every character is a one point draw, llvmpipe shades vertices inside the draw call so whole meshes would hide the submission cost
+// Needs a headless context, see headless.hpp
+void benchmark_instanced_crowd()
+{
+	const unsigned int iterations = 100;
+
+	HeadlessContext context;
+
+	std::printf("\nInstanced crowd\n");
+
+	if (!context.create(16, 16, 0))
+		return;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	unsigned int joints_count  = skeleton.joints_count();
+	unsigned int max_instances = 1000;
+	unsigned int influences    = astro_boy_weights_array_count / astro_boy_vertex_count;
+	unsigned int index         = 0;
+
+	auto vertices = pack_skinned_vertices(astro_boy_positions, astro_boy_normals, astro_boy_uvs, astro_boy_weights, astro_boy_joints, influences, 1);
+
+	const char *vertex_shader_src =
+		"#version 330 core\n"
+		"layout (location = 0) in vec4 position;\n"
+		"layout (location = 3) in vec4 weights;\n"
+		"layout (location = 4) in uvec4 joints;\n"
+		"uniform mat4 model;\n"
+		"layout (std140) uniform joint_matrices\n"
+		"{\n"
+		"    vec4 joints_rows[256 * 3];\n"
+		"};\n"
+		"vec4 joint_row(uint row)\n"
+		"{\n"
+		"	 return joints_rows[joints.x * 3u + row] * weights.x + joints_rows[joints.y * 3u + row] * weights.y +\n"
+		"		joints_rows[joints.z * 3u + row] * weights.z + joints_rows[joints.w * 3u + row] * (1.0 - weights.x - weights.y - weights.z);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = model * vec4(dot(joint_row(0u), position), dot(joint_row(1u), position), dot(joint_row(2u), position), 1.0);\n"
+		"}\n";
+
+	const char *vertex_shader_instanced_src =
+		"#version 330 core\n"
+		"layout (location = 0) in vec4 position;\n"
+		"layout (location = 3) in vec4 weights;\n"
+		"layout (location = 4) in uvec4 joints;\n"
+		"layout (location = 5) in mat4 model;\n"
+		"layout (location = 9) in uint palette_offset;\n"
+		"uniform samplerBuffer joint_palettes;\n"
+		"vec4 palette_row(uint joint, uint row)\n"
+		"{\n"
+		"	 return texelFetch(joint_palettes, int((palette_offset + joint) * 3u + row));\n"
+		"}\n"
+		"vec4 joint_row(uint row)\n"
+		"{\n"
+		"	 return palette_row(joints.x, row) * weights.x + palette_row(joints.y, row) * weights.y +\n"
+		"		palette_row(joints.z, row) * weights.z + palette_row(joints.w, row) * (1.0 - weights.x - weights.y - weights.z);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = model * vec4(dot(joint_row(0u), position), dot(joint_row(1u), position), dot(joint_row(2u), position), 1.0);\n"
+		"}\n";
+
+	const char *fragment_shader_src =
+		"#version 330 core\n"
+		"out vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    color = vec4(1.0);\n"
+		"}\n";
+
+	AnimatedGeometry geometry(vertex_shader_src, fragment_shader_src, nullptr, vertices, sizeof(index), &index, 1, joints_count, PaletteMode::affine3x4);
+
+	max_instances = geometry.enable_instancing(vertex_shader_instanced_src, fragment_shader_src, max_instances, joints_count);
+
+	ror::Matrix4f identity;
+
+	std::vector<AnimationPlayer> instances(max_instances, AnimationPlayer(&clip));
+	std::vector<Matrix3x4>       palettes(max_instances * joints_count);
+	std::vector<SkinnedInstance> skinned_instances(max_instances);
+
+	for (unsigned int i = 0; i < max_instances; ++i)
+	{
+		instances[i].seek(clip.loop_duration() * static_cast<float>(i) / static_cast<float>(max_instances));
+
+		std::memcpy(skinned_instances[i].m_model, identity.m_values, sizeof(skinned_instances[i].m_model));
+		skinned_instances[i].m_palette_offset = i * joints_count;
+	}
+
+	PoseBatch<pose_batch_lanes> batch(skeleton);
+	batch.evaluate(instances.data(), max_instances, palettes.data());
+
+	for (unsigned int instances_count : {1u, 10u, 100u, 1000u})
+	{
+		// Submission on the CPU, then the whole frame until the GPU is done like a swap
+		auto frames = [&](const char *a_name, auto &&a_submit) {
+			double submit = 0.0, frame = 0.0;
+
+			for (unsigned int i = 0; i <= iterations; ++i)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				a_submit();
+				auto submitted = std::chrono::high_resolution_clock::now();
+				glFinish();
+				auto finished = std::chrono::high_resolution_clock::now();
+
+				// First frame is the warm up
+				if (i > 0)
+				{
+					submit += std::chrono::duration<double, std::nano>(submitted - start).count();
+					frame += std::chrono::duration<double, std::nano>(finished - start).count();
+				}
+			}
+
+			char name[128];
+			std::snprintf(name, sizeof(name), "%u character%s %s submit", instances_count, instances_count > 1 ? "s" : "", a_name);
+			std::printf("%-56s %12.1f ns\n", name, submit / iterations);
+			std::snprintf(name, sizeof(name), "%u character%s %s frame", instances_count, instances_count > 1 ? "s" : "", a_name);
+			std::printf("%-56s %12.1f ns\n", name, frame / iterations);
+		};
+
+		frames("draw each", [&]() {
+			std::vector<Matrix3x4> palette(joints_count);
+
+			for (unsigned int i = 0; i < instances_count; ++i)
+			{
+				std::copy(palettes.begin() + i * joints_count, palettes.begin() + (i + 1) * joints_count, palette.begin());
+				geometry.update_matrices(palette);
+				geometry.draw(identity.m_values, identity.m_values, identity.m_values, GL_POINTS);
+			}
+		});
+
+		frames("instanced", [&]() {
+			geometry.update_instances(palettes.data(), instances_count * joints_count, skinned_instances.data(), instances_count);
+			geometry.draw_instanced(identity.m_values, identity.m_values, instances_count, GL_POINTS);
+		});
+	}
+
+	check_gl_error(__FILE__, __LINE__);
+}
+
+// CPU cost of a frame of an instanced crowd animated on the CPU against one sampling baked palettes from an AnimationTexture
+// One point characters like benchmark_instanced_crowd. Needs a headless context, see headless.hpp
+void benchmark_animation_texture()
+{
+	const unsigned int iterations      = 20;
+	unsigned int       instances_count = 1000;
+
+	HeadlessContext context;
+
+	std::printf("\nAnimation texture\n");
+
+	if (!context.create(16, 16, 0))
+		return;
+
+	Skeleton      skeleton = create_astro_boy_skeleton();
+	AnimationClip clip     = create_astro_boy_clip(skeleton);
+
+	unsigned int joints_count = skeleton.joints_count();
+	unsigned int influences   = astro_boy_weights_array_count / astro_boy_vertex_count;
+	unsigned int index        = 0;
+
+	auto vertices = pack_skinned_vertices(astro_boy_positions, astro_boy_normals, astro_boy_uvs, astro_boy_weights, astro_boy_joints, influences, 1);
+
+	const char *vertex_shader_src =
+		"#version 330 core\n"
+		"layout (location = 0) in vec4 position;\n"
+		"layout (location = 3) in vec4 weights;\n"
+		"layout (location = 4) in uvec4 joints;\n"
+		"layout (location = 5) in mat4 model;\n"
+		"layout (location = 9) in uint palette_offset;\n"
+		"uniform samplerBuffer joint_palettes;\n"
+		"void main()\n"
+		"{\n"
+		"    vec4 row = texelFetch(joint_palettes, int((palette_offset + joints.x) * 3u)) * weights.x;\n"
+		"    gl_Position = model * vec4(dot(row, position), 0.0, 0.0, 1.0);\n"
+		"}\n";
+
+	const char *vertex_shader_baked_src =
+		"#version 330 core\n"
+		"layout (location = 0) in vec4 position;\n"
+		"layout (location = 3) in vec4 weights;\n"
+		"layout (location = 4) in uvec4 joints;\n"
+		"layout (location = 5) in mat4 model;\n"
+		"layout (location = 10) in float instance_time;\n"
+		"uniform sampler2D animation_palettes;\n"
+		"uniform float animation_time;\n"
+		"uniform float animation_duration;\n"
+		"uniform int animation_frames;\n"
+		"void main()\n"
+		"{\n"
+		"    float position_in_clip = mod(animation_time + instance_time, animation_duration) / animation_duration * float(animation_frames);\n"
+		"    int frame = min(int(position_in_clip), animation_frames - 1);\n"
+		"    vec4 row = texelFetch(animation_palettes, ivec2(int(joints.x * 3u), frame), 0) * weights.x;\n"
+		"    gl_Position = model * vec4(dot(row, position), 0.0, 0.0, 1.0);\n"
+		"}\n";
+
+	const char *fragment_shader_src =
+		"#version 330 core\n"
+		"out vec4 color;\n"
+		"void main()\n"
+		"{\n"
+		"    color = vec4(1.0);\n"
+		"}\n";
+
+	AnimatedGeometry animated(vertex_shader_src, fragment_shader_src, nullptr, vertices, sizeof(index), &index, 1, joints_count, PaletteMode::affine3x4);
+	AnimatedGeometry baked(vertex_shader_src, fragment_shader_src, nullptr, vertices, sizeof(index), &index, 1, joints_count, PaletteMode::affine3x4);
+
+	instances_count = animated.enable_instancing(vertex_shader_src, fragment_shader_src, instances_count, joints_count);
+	baked.enable_instancing(vertex_shader_baked_src, fragment_shader_src, instances_count, 0);
+
+	std::unique_ptr<AnimationTexture> texture;
+
+	benchmark("Bake and upload the clip at 30Hz", 1, [&]() {
+		texture.reset(new AnimationTexture(BakedClip(skeleton, clip, 30.0f)));
+		glFinish();
+	});
+
+	// Already reported why, nothing to compare against
+	if (!texture->valid())
+		return;
+
+	std::printf("%-56s %12zu bytes\n", "Animation texture", texture->size_in_bytes());
+
+	texture->attach(baked);
+
+	ror::Matrix4f                identity;
+	std::vector<AnimationPlayer> instances(instances_count, AnimationPlayer(&clip));
+	std::vector<Matrix3x4>       palettes(instances_count * joints_count);
+	std::vector<SkinnedInstance> skinned_instances(instances_count);
+
+	for (unsigned int i = 0; i < instances_count; ++i)
+	{
+		std::memcpy(skinned_instances[i].m_model, identity.m_values, sizeof(skinned_instances[i].m_model));
+		skinned_instances[i].m_palette_offset = i * joints_count;
+		skinned_instances[i].m_animation_time = clip.loop_duration() * static_cast<float>(i) / static_cast<float>(instances_count);
+
+		instances[i].seek(skinned_instances[i].m_animation_time);
+	}
+
+	baked.update_instances(nullptr, 0, skinned_instances.data(), instances_count);
+
+	PoseBatch<pose_batch_lanes> batch(skeleton);
+	float        time = 0.0f;
+
+	benchmark("1000 characters animated frame", iterations, [&]() {
+		for (auto &instance : instances)
+			instance.advance(1.0f / 60.0f);
+
+		batch.evaluate(instances.data(), instances_count, palettes.data());
+		animated.update_instances(palettes.data(), instances_count * joints_count, skinned_instances.data(), instances_count);
+		animated.draw_instanced(identity.m_values, identity.m_values, instances_count, GL_POINTS);
+		glFinish();
+	});
+
+	benchmark("1000 characters baked frame", iterations, [&]() {
+		time += 1.0f / 60.0f;
+
+		baked.set_animation_time(time);
+		baked.draw_instanced(identity.m_values, identity.m_values, instances_count, GL_POINTS);
+		glFinish();
+	});
+
+	texture.reset();
+	check_gl_error(__FILE__, __LINE__);
+}
+
+// Returns false if any of the checks failed
+bool run_benchmarks()
+{
+	benchmark_simd_kernels();
+	benchmark_pose_batch();
+	benchmark_pose_blend();
+	benchmark_animation_lod();
+	benchmark_curve_tracks();
+	benchmark_quantized_tracks();
+	benchmark_palette_cache();
+	benchmark_tick_interpolation();
+	benchmark_static_hierarchy();
+	benchmark_crowd_animation();
+	benchmark_cpu_skinning();
+	benchmark_palette_upload();
+	benchmark_vertex_formats();
+	benchmark_instanced_crowd();
+	benchmark_animation_texture();
+
+	if (benchmark_failures_count > 0)
+		std::printf("\n%u checks FAILED\n", benchmark_failures_count);
+
+	return benchmark_failures_count == 0;
+}
@@ -0,0 +1,116 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "job_system.hpp"
+#include "math/rormatrix4.hpp"
+#include "simd_kernels.hpp"
+#include "transform.hpp"
+#include <cmath>
+#include <vector>
+
+// Headless skinning on the CPU, for machines without a GPU like render farm nodes or server side hit detection
+// Doesn't need a GL context, works on the same arrays that are uploaded to the vertex buffers
+
+// Skinned mesh in the same layout as the AnimatedGeometry vertex buffers, 3 influences per vertex
+typedef struct
+{
+	const float *m_positions;        // 3 floats per vertex
+	const float *m_normals;          // 3 floats per vertex
+	const float *m_weights;          // 3 floats per vertex
+	const int *  m_joints;           // 3 joint indices per vertex
+	unsigned int m_vertex_count;
+} SkinnedMesh;
+
+// Positions are skinned like vertex_shader_lit_src, blending whole 4x4 palette matrices by the weights and transforming the vertex
+// with the result. Unlike the shader, which only applies the model normal matrix, normals go through the blended matrix too and
+// are normalised, since CPU users like hit detection want the deformed normal. Slow, only meant to verify the optimised paths against
+void skin_vertices_reference(const SkinnedMesh &a_mesh, const std::vector<ror::Matrix4f> &a_palette, std::vector<float> &a_out_positions, std::vector<float> &a_out_normals)
+{
+	a_out_positions.resize(a_mesh.m_vertex_count * 3);
+	a_out_normals.resize(a_mesh.m_vertex_count * 3);
+
+	for (unsigned int i = 0; i < a_mesh.m_vertex_count; ++i)
+	{
+		float keyframe_transform[16] = {};
+
+		for (unsigned int influence = 0; influence < 3; ++influence)
+		{
+			const float *joint_matrix = a_palette[a_mesh.m_joints[i * 3 + influence]].m_values;
+			float        weight       = a_mesh.m_weights[i * 3 + influence];
+
+			for (unsigned int e = 0; e < 16; ++e)
+				keyframe_transform[e] += joint_matrix[e] * weight;
+		}
+
+		const float *position = a_mesh.m_positions + i * 3;
+		const float *normal   = a_mesh.m_normals + i * 3;
+		const float *m        = keyframe_transform;
+
+		float skinned_normal[3];
+
+		for (unsigned int r = 0; r < 3; ++r)
+		{
+			a_out_positions[i * 3 + r] = m[r] * position[0] + m[4 + r] * position[1] + m[8 + r] * position[2] + m[12 + r];
+			skinned_normal[r]          = m[r] * normal[0] + m[4 + r] * normal[1] + m[8 + r] * normal[2];
+		}
+
+		float length = std::sqrt(skinned_normal[0] * skinned_normal[0] + skinned_normal[1] * skinned_normal[1] + skinned_normal[2] * skinned_normal[2]);
+
+		for (unsigned int r = 0; r < 3; ++r)
+			a_out_normals[i * 3 + r] = skinned_normal[r] / length;
+	}
+}
+
+// Multithreaded linear blend skinning, vertex ranges are spread over the threads of a JobSystem
+// Each range is skinned with the best SIMD kernel for the CPU
+class CpuSkinning
+{
+  public:
+	CpuSkinning(JobSystem &a_jobs) :
+		m_jobs(&a_jobs)
+	{}
+
+	unsigned int threads_count() const
+	{
+		return this->m_jobs->threads_count();
+	}
+
+	// Writes 3 floats per vertex into a_out_positions and a_out_normals, a_palette is the Matrix3x4 palette from get_joint_matrices
+	// Blocks until all vertices are skinned
+	void skin(const SkinnedMesh &a_mesh, const Matrix3x4 *a_palette, float *a_out_positions, float *a_out_normals)
+	{
+		// Ranges in multiples of 8 vertices so the wide kernels don't fall back to the scalar tail in the middle of the mesh
+		this->m_jobs->parallel_for(
+			a_mesh.m_vertex_count, [&](unsigned int a_first, unsigned int a_last, unsigned int) {
+				simd_kernels().m_skin_vertices(a_mesh.m_positions + a_first * 3, a_mesh.m_normals + a_first * 3, a_mesh.m_weights + a_first * 3, a_mesh.m_joints + a_first * 3,
+											   a_palette->m_values, a_last - a_first, a_out_positions + a_first * 3, a_out_normals + a_first * 3);
+			},
+			8);
+	}
+
+  private:
+	JobSystem *m_jobs = nullptr;
+};
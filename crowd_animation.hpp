@@ -0,0 +1,71 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_clip.hpp"
+#include "job_system.hpp"
+#include "pose_batch.hpp"
+#include "skeleton.hpp"
+#include <vector>
+
+// Animation update of a crowd of characters sharing a skeleton, spread over the threads of a JobSystem
+// Every job advances, samples, evaluates the hierarchy and builds palettes for a chunk of instances with a PoseBatch of its
+// thread. Chunks are whole PoseBatch groups so no lanes are wasted except in the very last group
+template <unsigned int _lanes = pose_batch_lanes>
+class CrowdAnimation
+{
+  public:
+	CrowdAnimation(const Skeleton &a_skeleton, JobSystem &a_jobs) :
+		m_skeleton(&a_skeleton), m_jobs(&a_jobs)
+	{
+		this->m_batches.reserve(a_jobs.threads_count());
+
+		for (unsigned int i = 0; i < a_jobs.threads_count(); ++i)
+			this->m_batches.emplace_back(a_skeleton);
+	}
+
+	// Advances all a_instances by a_delta_time and writes joints_count() palette matrices for each one after the other in a_palettes
+	// a_palettes must hold a_instances_count palettes and can be ror::Matrix4f or Matrix3x4, nothing is allocated
+	template <typename _palette>
+	void update(AnimationPlayer *a_instances, unsigned int a_instances_count, float a_delta_time, _palette *a_palettes)
+	{
+		unsigned int joints_count = this->m_skeleton->joints_count();
+
+		this->m_jobs->parallel_for(
+			a_instances_count,
+			[&](unsigned int a_first, unsigned int a_last, unsigned int a_thread) {
+				for (unsigned int i = a_first; i < a_last; ++i)
+					a_instances[i].advance(a_delta_time);
+
+				this->m_batches[a_thread].evaluate(a_instances + a_first, a_last - a_first, a_palettes + a_first * joints_count);
+			},
+			_lanes);
+	}
+
+  private:
+	const Skeleton *               m_skeleton = nullptr;
+	JobSystem *                    m_jobs     = nullptr;
+	std::vector<PoseBatch<_lanes>> m_batches;        // Scratch of each thread
+};
@@ -0,0 +1,199 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Keyframe reduced tracks from the generator, see astro_boy_animation_curves.hpp
+// Rotation, translation and scale of every track are separate curves with their own key times, constant ones have a single key
+// Keys are interpolated with cubic Hermite curves whose tangents are the finite differences of the neighbouring keys,
+// so only the key values need to be stored. Keys of a curve are next to each other since curves no longer share keyframes
+class CurveTrackTable
+{
+  public:
+	CurveTrackTable(){};
+
+	// a_tracks has node, then first key and keys count of rotation, translation and scale for each of a_tracks_count tracks
+	CurveTrackTable(unsigned int a_nodes_count, const unsigned int *a_tracks, unsigned int a_tracks_count,
+					const float *a_rotation_times, const float *a_rotations, unsigned int a_rotation_keys_count,
+					const float *a_translation_times, const float *a_translations, unsigned int a_translation_keys_count,
+					const float *a_scale_times, const float *a_scales, unsigned int a_scale_keys_count) :
+		m_node_tracks(a_nodes_count, -1),
+		m_rotations(a_rotation_times, a_rotations, a_rotation_keys_count),
+		m_translations(a_translation_times, a_translations, a_translation_keys_count),
+		m_scales(a_scale_times, a_scales, a_scale_keys_count)
+	{
+		this->m_tracks.reserve(a_tracks_count);
+
+		for (unsigned int t = 0; t < a_tracks_count; ++t)
+		{
+			const unsigned int *track = a_tracks + t * 7;
+
+			assert(track[0] < a_nodes_count);
+			assert(this->m_node_tracks[track[0]] == -1 && "Node already has a track");
+			assert(track[2] > 0 && track[1] + track[2] <= a_rotation_keys_count);
+			assert(track[4] > 0 && track[3] + track[4] <= a_translation_keys_count);
+			assert(track[6] > 0 && track[5] + track[6] <= a_scale_keys_count);
+
+			this->m_node_tracks[track[0]] = static_cast<int16_t>(t);
+			this->m_tracks.push_back(Track{{track[1], track[2]}, {track[3], track[4]}, {track[5], track[6]}});
+		}
+	}
+
+	// Returns -1 for nodes without animation
+	int track(unsigned int a_node) const
+	{
+		return this->m_node_tracks[a_node];
+	}
+
+	unsigned int tracks_count() const
+	{
+		return static_cast<unsigned int>(this->m_tracks.size());
+	}
+
+	// Keys of all the curves
+	unsigned int keys_count() const
+	{
+		return this->m_rotations.keys_count() + this->m_translations.keys_count() + this->m_scales.keys_count();
+	}
+
+	// Memory used by the keys and track descriptions
+	size_t size_in_bytes() const
+	{
+		return this->m_rotations.size_in_bytes() + this->m_translations.size_in_bytes() + this->m_scales.size_in_bytes() + this->m_tracks.size() * sizeof(Track);
+	}
+
+	// a_time is clamped to the keys of each curve, looping is left to the caller
+	Transform sample(int a_track, float a_time) const
+	{
+		const Track &track = this->m_tracks[static_cast<unsigned int>(a_track)];
+
+		Quaternion    rotation;
+		ror::Vector3f translation, scale;
+
+		this->m_rotations.sample(track.m_rotation, a_time, &rotation.x);
+		this->m_translations.sample(track.m_translation, a_time, &translation.x);
+		this->m_scales.sample(track.m_scale, a_time, &scale.x);
+
+		return Transform{quaternion_normalize(rotation), translation, scale};
+	}
+
+  private:
+	typedef struct
+	{
+		unsigned int m_first;
+		unsigned int m_count;
+	} Range;
+
+	typedef struct
+	{
+		Range m_rotation;
+		Range m_translation;
+		Range m_scale;
+	} Track;
+
+	// Keys of one kind of curve for all tracks, _components floats per key
+	template <unsigned int _components>
+	class Curves
+	{
+	  public:
+		Curves(){};
+
+		Curves(const float *a_times, const float *a_values, unsigned int a_keys_count) :
+			m_times(a_times, a_times + a_keys_count), m_values(a_values, a_values + a_keys_count * _components)
+		{}
+
+		unsigned int keys_count() const
+		{
+			return static_cast<unsigned int>(this->m_times.size());
+		}
+
+		size_t size_in_bytes() const
+		{
+			return (this->m_times.size() + this->m_values.size()) * sizeof(float);
+		}
+
+		// Writes _components floats of curve a_range at a_time into a_out
+		void sample(const Range &a_range, float a_time, float *a_out) const
+		{
+			const float *times  = this->m_times.data() + a_range.m_first;
+			const float *values = this->m_values.data() + a_range.m_first * _components;
+
+			unsigned int last = a_range.m_count - 1;
+			unsigned int key;
+
+			if (last == 0 || a_time <= times[0])
+				key = 0;
+			else if (a_time >= times[last])
+				key = last;
+			else
+			{
+				// Curves have a few dozen keys at most, binary search is cheap enough not to need a cursor per curve
+				unsigned int k1 = static_cast<unsigned int>(std::upper_bound(times, times + a_range.m_count, a_time) - times);
+				unsigned int k0 = k1 - 1;
+
+				unsigned int before = k0 > 0 ? k0 - 1 : k0;
+				unsigned int after  = k1 < last ? k1 + 1 : k1;
+
+				float dt = times[k1] - times[k0];
+				float t  = (a_time - times[k0]) / dt;
+
+				// Hermite basis with the finite difference tangents scaled into the segment
+				float t2 = t * t, t3 = t2 * t;
+
+				float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+				float h01 = -2.0f * t3 + 3.0f * t2;
+				float h10 = (t3 - 2.0f * t2 + t) * dt / (times[k1] - times[before]);
+				float h11 = (t3 - t2) * dt / (times[after] - times[k0]);
+
+				const float *p0 = values + k0 * _components, *p1 = values + k1 * _components;
+				const float *pb = values + before * _components, *pa = values + after * _components;
+
+				for (unsigned int c = 0; c < _components; ++c)
+					a_out[c] = h00 * p0[c] + h01 * p1[c] + h10 * (p1[c] - pb[c]) + h11 * (pa[c] - p0[c]);
+
+				return;
+			}
+
+			for (unsigned int c = 0; c < _components; ++c)
+				a_out[c] = values[key * _components + c];
+		}
+
+	  private:
+		std::vector<float> m_times;         // Per key
+		std::vector<float> m_values;        // _components per key
+	};
+
+	std::vector<int16_t> m_node_tracks;        // Per node track index or -1
+	std::vector<Track>   m_tracks;
+	Curves<4>            m_rotations;
+	Curves<3>            m_translations;
+	Curves<3>            m_scales;
+};
@@ -0,0 +1,216 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Produces frames on an animation thread while the render thread draws, like the joint palettes of the next frame
+// Frames go through a ring of a_slots_count buffers, 3 for triple buffering where the producer never waits, or 2 for double
+// buffering where it waits for the render thread to let go of the other buffer. Every buffer is fenced by its state,
+// so a buffer is never written while it's being read and the latest completed frame is never overwritten before it's replaced
+// The render thread always gets the latest completed frame, frames it didn't get to in time are dropped
+// Frames that only make sense on top of the ones before them, like a palette skipped by the lod, can carry a dropped frame on through a_supersede
+template <typename _request, typename _frame>
+class FramePipeline
+{
+  public:
+	// a_produce(request, frame) fills frame for request and runs on the animation thread
+	// a_supersede(frame, dropped) is optional and runs on the animation thread when frame replaces dropped before the render thread got it
+	FramePipeline(std::function<void(const _request &, _frame &)> a_produce, unsigned int a_slots_count = 3,
+				  std::function<void(_frame &, const _frame &)> a_supersede = nullptr) :
+		m_produce(std::move(a_produce)), m_supersede(std::move(a_supersede)), m_frames(a_slots_count), m_states(a_slots_count, SlotState::free)
+	{
+		assert(a_slots_count >= 2 && "Pipelining needs at least two buffers");
+
+		this->m_thread = std::thread(&FramePipeline::produce, this);
+	}
+
+	~FramePipeline()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			this->m_exit = true;
+		}
+
+		this->m_condition.notify_all();
+		this->m_thread.join();
+	}
+
+	FramePipeline(const FramePipeline &) = delete;
+	FramePipeline &operator=(const FramePipeline &) = delete;
+
+	// Asks for the next frame, returns straight away. A request the animation thread hasn't started yet is replaced
+	void submit(const _request &a_request)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			this->m_request     = a_request;
+			this->m_has_request = true;
+		}
+
+		this->m_condition.notify_all();
+	}
+
+	// Latest completed frame not acquired before, nullptr if there is none unless a_wait blocks until there is
+	// The frame stays valid until release(), only one frame can be acquired at a time
+	const _frame *acquire(bool a_wait = false)
+	{
+		std::unique_lock<std::mutex> lock(this->m_mutex);
+
+		assert(this->m_reading == -1 && "Previous frame not released");
+
+		if (a_wait)
+			this->m_condition.wait(lock, [this]() { return this->m_ready != -1; });
+
+		if (this->m_ready == -1)
+			return nullptr;
+
+		this->m_reading = this->m_ready;
+		this->m_ready   = -1;
+
+		this->m_states[static_cast<unsigned int>(this->m_reading)] = SlotState::reading;
+
+		return &this->m_frames[static_cast<unsigned int>(this->m_reading)];
+	}
+
+	// Hands the acquired frame's buffer back to the animation thread
+	void release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+
+			assert(this->m_reading != -1 && "No frame acquired");
+
+			this->m_states[static_cast<unsigned int>(this->m_reading)] = SlotState::free;
+			this->m_reading                                            = -1;
+		}
+
+		this->m_condition.notify_all();
+	}
+
+	unsigned int slots_count() const
+	{
+		return static_cast<unsigned int>(this->m_frames.size());
+	}
+
+	// Frames completed and frames replaced by a newer one before the render thread acquired them
+	unsigned int produced_count() const
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		return this->m_produced_count;
+	}
+
+	unsigned int dropped_count() const
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		return this->m_dropped_count;
+	}
+
+  private:
+	enum class SlotState
+	{
+		free,
+		writing,
+		ready,
+		reading
+	};
+
+	int free_slot() const
+	{
+		for (unsigned int i = 0; i < this->m_states.size(); ++i)
+			if (this->m_states[i] == SlotState::free)
+				return static_cast<int>(i);
+
+		return -1;
+	}
+
+	void produce()
+	{
+		while (true)
+		{
+			_request request;
+			int      slot;
+
+			{
+				std::unique_lock<std::mutex> lock(this->m_mutex);
+				this->m_condition.wait(lock, [this]() { return this->m_exit || (this->m_has_request && this->free_slot() != -1); });
+
+				if (this->m_exit)
+					return;
+
+				request             = this->m_request;
+				slot                = this->free_slot();
+				this->m_has_request = false;
+
+				this->m_states[static_cast<unsigned int>(slot)] = SlotState::writing;
+			}
+
+			this->m_produce(request, this->m_frames[static_cast<unsigned int>(slot)]);
+
+			{
+				std::lock_guard<std::mutex> lock(this->m_mutex);
+
+				// The render thread never got to the previous frame, it's superseded
+				if (this->m_ready != -1)
+				{
+					if (this->m_supersede)
+						this->m_supersede(this->m_frames[static_cast<unsigned int>(slot)], this->m_frames[static_cast<unsigned int>(this->m_ready)]);
+
+					this->m_states[static_cast<unsigned int>(this->m_ready)] = SlotState::free;
+					++this->m_dropped_count;
+				}
+
+				this->m_states[static_cast<unsigned int>(slot)] = SlotState::ready;
+				this->m_ready                                   = slot;
+				++this->m_produced_count;
+			}
+
+			this->m_condition.notify_all();
+		}
+	}
+
+	std::function<void(const _request &, _frame &)> m_produce;
+	std::function<void(_frame &, const _frame &)>   m_supersede;
+	std::vector<_frame>                             m_frames;
+	std::vector<SlotState>                          m_states;
+	int                                             m_ready   = -1;        // Latest completed frame not acquired yet
+	int                                             m_reading = -1;        // Frame acquired by the render thread
+
+	_request     m_request{};
+	bool         m_has_request    = false;
+	bool         m_exit           = false;
+	unsigned int m_produced_count = 0;
+	unsigned int m_dropped_count  = 0;
+
+	mutable std::mutex      m_mutex;
+	std::condition_variable m_condition;
+	std::thread             m_thread;
+};
@@ -27,11 +27,18 @@
 
 // To regenerate the headers again use the following command
 // clang++ -fsanitize=undefined geometry_generator.cpp -o geom && ./geom
+// An optional argument sets the maximum world space joint position error of the keyframe reduction in astro_boy_animation_curves.hpp
+// The checked in curves are generated with the default, ./geom 0.01
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <map>
 #include <unordered_map>
@@ -39,13 +46,39 @@
 
 #include "astro_boy_geometry_from_collada.hpp"
 
-typedef unsigned long long uint64_t;
-
 uint64_t hash(unsigned int a, unsigned int b, unsigned int c, unsigned int n)
 {
 	return a * (n + 1) * (n + 1) + b * (n + 1) + c;
 }
 
+// Same license header as the rest of the sources, written at the top of every generated header
+void write_license(std::ofstream &header_file)
+{
+	header_file << "// Wasim Abbas\n"
+				   "// http://www.waZim.com\n"
+				   "// Copyright (c) 2019\n"
+				   "//\n"
+				   "// Permission is hereby granted, free of charge, to any person obtaining\n"
+				   "// a copy of this software and associated documentation files (the 'Software'),\n"
+				   "// to deal in the Software without restriction, including without limitation\n"
+				   "// the rights to use, copy, modify, merge, publish, distribute, sublicense,\n"
+				   "// and/or sell copies of the Software, and to permit persons to whom the Software\n"
+				   "// is furnished to do so, subject to the following conditions:\n"
+				   "//\n"
+				   "// The above copyright notice and this permission notice shall be included in\n"
+				   "// all copies or substantial portions of the Software.\n"
+				   "//\n"
+				   "// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,\n"
+				   "// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES\n"
+				   "// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.\n"
+				   "// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY\n"
+				   "// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,\n"
+				   "// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE\n"
+				   "// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.\n"
+				   "//\n"
+				   "// Version: 1.0.0\n\n";
+}
+
 template <typename T>
 void write_vertex_array(std::ofstream &header_file, std::vector<T> data, unsigned int components, std::string name, std::string type)
 {
@@ -86,6 +119,240 @@ union KeyframeInt
 	unsigned int m_int;
 };
 
+// Keyframe reduction and curve fitting
+// Matrices are decomposed into the same rotation xyzw, translation xyz, scale xyz layout the runtime uses
+typedef std::array<float, 10> Qvv;
+
+ColladaMatrix matrix_multiply(const ColladaMatrix &a, const ColladaMatrix &b)
+{
+	ColladaMatrix m;
+
+	for (unsigned int r = 0; r < 4; ++r)
+		for (unsigned int c = 0; c < 4; ++c)
+			m.v[r * 4 + c] = a.v[r * 4] * b.v[c] + a.v[r * 4 + 1] * b.v[4 + c] + a.v[r * 4 + 2] * b.v[8 + c] + a.v[r * 4 + 3] * b.v[12 + c];
+
+	return m;
+}
+
+// Same decomposition as transform_from_matrix, collada matrices are row-major
+Qvv decompose(const ColladaMatrix &m)
+{
+	const float *v = m.v;
+
+	float sx = std::sqrt(v[0] * v[0] + v[4] * v[4] + v[8] * v[8]);
+	float sy = std::sqrt(v[1] * v[1] + v[5] * v[5] + v[9] * v[9]);
+	float sz = std::sqrt(v[2] * v[2] + v[6] * v[6] + v[10] * v[10]);
+
+	float determinant = v[0] * (v[5] * v[10] - v[9] * v[6]) - v[1] * (v[4] * v[10] - v[8] * v[6]) + v[2] * (v[4] * v[9] - v[8] * v[5]);
+	if (determinant < 0.0f)
+		sx = -sx;
+
+	float r00 = v[0] / sx, r10 = v[4] / sx, r20 = v[8] / sx;
+	float r01 = v[1] / sy, r11 = v[5] / sy, r21 = v[9] / sy;
+	float r02 = v[2] / sz, r12 = v[6] / sz, r22 = v[10] / sz;
+
+	float trace = r00 + r11 + r22;
+	float x, y, z, w;
+
+	if (trace > 0.0f)
+	{
+		float s = std::sqrt(trace + 1.0f) * 2.0f;
+		x = (r21 - r12) / s, y = (r02 - r20) / s, z = (r10 - r01) / s, w = 0.25f * s;
+	}
+	else if (r00 > r11 && r00 > r22)
+	{
+		float s = std::sqrt(1.0f + r00 - r11 - r22) * 2.0f;
+		x = 0.25f * s, y = (r01 + r10) / s, z = (r02 + r20) / s, w = (r21 - r12) / s;
+	}
+	else if (r11 > r22)
+	{
+		float s = std::sqrt(1.0f + r11 - r00 - r22) * 2.0f;
+		x = (r01 + r10) / s, y = 0.25f * s, z = (r12 + r21) / s, w = (r02 - r20) / s;
+	}
+	else
+	{
+		float s = std::sqrt(1.0f + r22 - r00 - r11) * 2.0f;
+		x = (r02 + r20) / s, y = (r12 + r21) / s, z = 0.25f * s, w = (r10 - r01) / s;
+	}
+
+	float length = std::sqrt(x * x + y * y + z * z + w * w);
+
+	return Qvv{x / length, y / length, z / length, w / length, v[3], v[7], v[11], sx, sy, sz};
+}
+
+// Inverse of decompose, rotation times scale with the translation in the last column
+ColladaMatrix compose(const Qvv &a)
+{
+	float x = a[0], y = a[1], z = a[2], w = a[3];
+
+	ColladaMatrix m = {{(1.0f - 2.0f * (y * y + z * z)) * a[7], 2.0f * (x * y - z * w) * a[8], 2.0f * (x * z + y * w) * a[9], a[4],
+						2.0f * (x * y + z * w) * a[7], (1.0f - 2.0f * (x * x + z * z)) * a[8], 2.0f * (y * z - x * w) * a[9], a[5],
+						2.0f * (x * z - y * w) * a[7], 2.0f * (y * z + x * w) * a[8], (1.0f - 2.0f * (x * x + y * y)) * a[9], a[6],
+						0.0f, 0.0f, 0.0f, 1.0f}};
+
+	return m;
+}
+
+void transform_point(const Qvv &a, const float *p, float *out)
+{
+	float x = a[0], y = a[1], z = a[2], w = a[3];
+	float vx = p[0] * a[7], vy = p[1] * a[8], vz = p[2] * a[9];
+
+	// v + 2w(q x v) + 2q x (q x v)
+	float cx = 2.0f * (y * vz - z * vy), cy = 2.0f * (z * vx - x * vz), cz = 2.0f * (x * vy - y * vx);
+
+	out[0] = vx + w * cx + (y * cz - z * cy) + a[4];
+	out[1] = vy + w * cy + (z * cx - x * cz) + a[5];
+	out[2] = vz + w * cz + (x * cy - y * cx) + a[6];
+}
+
+// Position error of points around the joint at its shell distance, the furthest any descendant is from it
+// Rotation error moves children proportionally to how far they are, so this catches what the chain below would see
+float qvv_error(const Qvv &a, const Qvv &b, float shell_distance)
+{
+	const float points[4][3] = {{0.0f, 0.0f, 0.0f}, {shell_distance, 0.0f, 0.0f}, {0.0f, shell_distance, 0.0f}, {0.0f, 0.0f, shell_distance}};
+
+	float error = 0.0f;
+
+	for (auto &point : points)
+	{
+		float pa[3], pb[3];
+		transform_point(a, point, pa);
+		transform_point(b, point, pb);
+
+		error = std::max(error, std::sqrt((pa[0] - pb[0]) * (pa[0] - pb[0]) + (pa[1] - pb[1]) * (pa[1] - pb[1]) + (pa[2] - pb[2]) * (pa[2] - pb[2])));
+	}
+
+	return error;
+}
+
+// Rotation, translation and scale are reduced separately, each is a range of the Qvv components
+typedef struct
+{
+	unsigned int m_begin;
+	unsigned int m_end;
+} Channel;
+
+const Channel channels[3] = {{0, 4}, {4, 7}, {7, 10}};
+
+// Replaces a_channel of a_frame with its cubic Hermite reconstruction between frames a_f0 and a_f1 of a_frames
+// Tangents are per second, finite differences of the neighbouring kept frames a_fb and a_fa, they aren't stored the runtime derives them
+// the same way from the keys it already has. Rotation is normalised after
+void hermite(const std::vector<Qvv> &a_frames, const std::vector<float> &a_times, unsigned int a_fb, unsigned int a_f0, unsigned int a_f1, unsigned int a_fa,
+			 float a_time, const Channel &a_channel, Qvv &a_frame)
+{
+	float dt = a_times[a_f1] - a_times[a_f0];
+	float t  = (a_time - a_times[a_f0]) / dt;
+
+	float t2 = t * t, t3 = t2 * t;
+
+	float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+	float h01 = -2.0f * t3 + 3.0f * t2;
+	float h10 = (t3 - 2.0f * t2 + t) * dt / (a_times[a_f1] - a_times[a_fb]);
+	float h11 = (t3 - t2) * dt / (a_times[a_fa] - a_times[a_f0]);
+
+	for (unsigned int c = a_channel.m_begin; c < a_channel.m_end; ++c)
+		a_frame[c] = h00 * a_frames[a_f0][c] + h01 * a_frames[a_f1][c] + h10 * (a_frames[a_f1][c] - a_frames[a_fb][c]) + h11 * (a_frames[a_fa][c] - a_frames[a_f0][c]);
+
+	if (a_channel.m_begin == 0)
+	{
+		float length = std::sqrt(a_frame[0] * a_frame[0] + a_frame[1] * a_frame[1] + a_frame[2] * a_frame[2] + a_frame[3] * a_frame[3]);
+		for (unsigned int c = 0; c < 4; ++c)
+			a_frame[c] /= length;
+	}
+}
+
+// Replaces a_channel of a_frame with its reconstruction from the kept a_keys at a_time
+void reconstruct(const std::vector<Qvv> &a_frames, const std::vector<float> &a_times, const std::vector<unsigned int> &a_keys, float a_time, const Channel &a_channel,
+				 Qvv &a_frame)
+{
+	unsigned int last = static_cast<unsigned int>(a_keys.size()) - 1;
+	unsigned int key  = 0;
+
+	if (last == 0 || a_time <= a_times[a_keys[0]])
+		key = a_keys[0];
+	else if (a_time >= a_times[a_keys[last]])
+		key = a_keys[last];
+	else
+	{
+		unsigned int k1 = 1;
+		while (a_times[a_keys[k1]] <= a_time)
+			++k1;
+
+		unsigned int k0 = k1 - 1;
+		hermite(a_frames, a_times, a_keys[k0 > 0 ? k0 - 1 : k0], a_keys[k0], a_keys[k1], a_keys[k1 < last ? k1 + 1 : k1], a_time, a_channel, a_frame);
+
+		return;
+	}
+
+	for (unsigned int c = a_channel.m_begin; c < a_channel.m_end; ++c)
+		a_frame[c] = a_frames[key][c];
+}
+
+// Greedy refinement of one channel, starts with a constant, then the end keys, and keeps adding the worst reconstructed frame as a key until
+// every frame is within a_max_error while the other channels are exact. Returns the kept frame indices
+std::vector<unsigned int> reduce_channel(const std::vector<Qvv> &a_frames, const std::vector<float> &a_times, const Channel &a_channel, float a_shell_distance,
+										 float a_max_error)
+{
+	std::vector<unsigned int> keys{0};
+
+	while (true)
+	{
+		unsigned int worst_frame = 0;
+		float        worst_error = 0.0f;
+
+		for (unsigned int f = 0; f < a_frames.size(); ++f)
+		{
+			Qvv frame = a_frames[f];
+			reconstruct(a_frames, a_times, keys, a_times[f], a_channel, frame);
+
+			float error = qvv_error(a_frames[f], frame, a_shell_distance);
+			if (error > worst_error)
+			{
+				worst_error = error;
+				worst_frame = f;
+			}
+		}
+
+		if (worst_error <= a_max_error)
+			return keys;
+
+		if (keys.size() == 1)
+			keys.push_back(static_cast<unsigned int>(a_frames.size() - 1));
+		else
+			keys.insert(std::upper_bound(keys.begin(), keys.end(), worst_frame), worst_frame);
+	}
+}
+
+// Matrix of keyframe a_frame exactly as its written into astro_boy_animation.hpp
+ColladaMatrix get_keyframe_matrix(const AstroBoyAnimationCollada &a_animation, size_t a_frame)
+{
+	ColladaMatrix matrix;
+
+	for (size_t l = 0; l < a_animation.keyframes.size(); l += 2)
+	{
+		size_t matrix_index = a_animation.keyframes[l + 1].size() != 2 ? a_frame : 0;
+		matrix.v[l / 2]     = l + 1 == 31 ? 1.0f : a_animation.keyframes[l + 1][matrix_index];        // Collada bug workaround
+	}
+
+	return matrix;
+}
+
+template <typename T>
+void write_array(std::ofstream &header_file, const std::vector<T> &data, std::string size, std::string name, std::string type)
+{
+	header_file << "const " << type << " " << name << "[" << size << "] = {";
+
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		header_file << data[i];
+		if (i != data.size() - 1)
+			header_file << ",";
+	}
+
+	header_file << "};\n";
+}
+
 int main(int argc, char *argv[])
 {
 	// Max index I will have in the triangle list
@@ -233,6 +500,7 @@ int main(int argc, char *argv[])
 
 	{
 		std::ofstream header_file("astro_boy_geometry.hpp");
+		write_license(header_file);
 
 		header_file << "const unsigned int astro_boy_vertex_count = " << positions.size() / 3 << ";\n";
 
@@ -285,6 +553,7 @@ int main(int argc, char *argv[])
 
 		// Read and write out animation data
 		std::ofstream header_file("astro_boy_animation.hpp");
+		write_license(header_file);
 
 		header_file << std::fixed << std::setprecision(6) << "#include <astro_boy_skeleton.hpp> \n\nunsigned int astro_boy_animation_keyframes_count = " << known_keyframes.size() << ";";
 		header_file << "\nstd::vector<float> astro_boy_animation_keyframe_times = {";
@@ -345,6 +614,236 @@ int main(int argc, char *argv[])
 		}
 
 		header_file << "\n};";
+
+		// Reduced version of the same tracks, the default is about half a pixel at the closest the app's camera gets to the 5.75 units tall
+		// character, 11.7 units away with a 60 degree field of view over 768 pixels. Tighter than that keeps nearly every key
+		float max_error = argc > 1 ? static_cast<float>(std::atof(argv[1])) : 0.01f;
+
+		std::vector<float> times;
+		for (auto &key : known_keyframes)
+			times.push_back(key.second);
+
+		// Shell distance of each node, rest pose world positions from the tree
+		const unsigned int         nodes_count = sizeof(astro_boy_tree_collada) / sizeof(astro_boy_tree_collada[0]);
+		std::vector<ColladaMatrix> rest_world(nodes_count);
+		std::vector<float>         shell_distances(nodes_count, 0.0f);
+
+		for (unsigned int n = 0; n < nodes_count; ++n)
+		{
+			int parent    = astro_boy_tree_collada[n].m_parent_id;
+			rest_world[n] = parent == -1 ? astro_boy_tree_collada[n].m_transform : matrix_multiply(rest_world[parent], astro_boy_tree_collada[n].m_transform);
+
+			for (int ancestor = parent; ancestor != -1; ancestor = astro_boy_tree_collada[ancestor].m_parent_id)
+			{
+				float dx = rest_world[n].v[3] - rest_world[ancestor].v[3];
+				float dy = rest_world[n].v[7] - rest_world[ancestor].v[7];
+				float dz = rest_world[n].v[11] - rest_world[ancestor].v[11];
+
+				shell_distances[ancestor] = std::max(shell_distances[ancestor], std::sqrt(dx * dx + dy * dy + dz * dz));
+			}
+		}
+
+		// Decomposed keyframes of every track
+		std::vector<int>              node_tracks(nodes_count, -1);
+		std::vector<unsigned int>     track_nodes;
+		std::vector<std::vector<Qvv>> track_frames;
+
+		for (size_t i = 0; i < astro_boy_animations_count; ++i)
+		{
+			auto itr = std::find(std::begin(astro_boy_tree_collada), std::end(astro_boy_tree_collada), astro_boy_animations[i]);
+			assert(itr != std::end(astro_boy_tree_collada));
+
+			std::vector<Qvv> frames(times.size());
+
+			for (size_t f = 0; f < times.size(); ++f)
+			{
+				frames[f] = decompose(get_keyframe_matrix(astro_boy_animations[i], f));
+
+				// Keep rotations in one hemisphere so the curves don't take the long way round
+				if (f > 0 && frames[f][0] * frames[f - 1][0] + frames[f][1] * frames[f - 1][1] + frames[f][2] * frames[f - 1][2] + frames[f][3] * frames[f - 1][3] < 0.0f)
+					for (unsigned int c = 0; c < 4; ++c)
+						frames[f][c] = -frames[f][c];
+			}
+
+			node_tracks[itr->m_index] = static_cast<int>(track_nodes.size());
+			track_nodes.push_back(static_cast<unsigned int>(itr->m_index));
+			track_frames.push_back(std::move(frames));
+		}
+
+		// The errors of all the animated joints above a node add up in its world position, so each track only gets a share of max_error
+		// The share is one over the animated joints on the longest chain through the track, ancestors, itself and the deepest descendants
+		std::vector<unsigned int> animated_above(nodes_count, 0), animated_below(nodes_count, 0);
+
+		for (unsigned int n = 0; n < nodes_count; ++n)
+		{
+			int parent        = astro_boy_tree_collada[n].m_parent_id;
+			animated_above[n] = (parent == -1 ? 0 : animated_above[parent]) + (node_tracks[n] != -1 ? 1 : 0);
+		}
+
+		for (unsigned int n = nodes_count; n-- > 0;)
+		{
+			int parent = astro_boy_tree_collada[n].m_parent_id;
+			if (parent != -1)
+				animated_below[parent] = std::max(animated_below[parent], animated_below[n] + (node_tracks[n] != -1 ? 1 : 0));
+		}
+
+		// Rotation, translation and scale keys of each track, reduced with the chain shares scaled by a_budget_scale
+		auto reduce_tracks = [&](float a_budget_scale) {
+			std::vector<std::array<std::vector<unsigned int>, 3>> keys(track_nodes.size());
+
+			for (size_t t = 0; t < track_nodes.size(); ++t)
+			{
+				unsigned int node           = track_nodes[t];
+				float        shell_distance = std::max(shell_distances[node], 0.1f);        // Leaf joints still move the skin around them
+				float        track_error    = max_error * a_budget_scale / static_cast<float>(animated_above[node] + animated_below[node]);
+
+				// Errors of the channels add up, so each gets a third
+				for (unsigned int c = 0; c < 3; ++c)
+					keys[t][c] = reduce_channel(track_frames[t], times, channels[c], shell_distance, track_error / 3.0f);
+			}
+
+			return keys;
+		};
+
+		// World space position error of every node at every keyframe, what the runtime benchmark measures
+		auto world_error = [&](const std::vector<std::array<std::vector<unsigned int>, 3>> &a_keys) {
+			float                      error = 0.0f;
+			std::vector<ColladaMatrix> dense(nodes_count), reduced(nodes_count);
+
+			for (size_t f = 0; f < times.size(); ++f)
+			{
+				for (unsigned int n = 0; n < nodes_count; ++n)
+				{
+					int           parent        = astro_boy_tree_collada[n].m_parent_id;
+					int           track         = node_tracks[n];
+					ColladaMatrix dense_local   = astro_boy_tree_collada[n].m_transform;
+					ColladaMatrix reduced_local = dense_local;
+
+					if (track != -1)
+					{
+						Qvv frame = track_frames[track][f];
+						for (unsigned int c = 0; c < 3; ++c)
+							reconstruct(track_frames[track], times, a_keys[track][c], times[f], channels[c], frame);
+
+						dense_local   = compose(track_frames[track][f]);
+						reduced_local = compose(frame);
+					}
+
+					dense[n]   = parent == -1 ? dense_local : matrix_multiply(dense[parent], dense_local);
+					reduced[n] = parent == -1 ? reduced_local : matrix_multiply(reduced[parent], reduced_local);
+
+					float dx = dense[n].v[3] - reduced[n].v[3];
+					float dy = dense[n].v[7] - reduced[n].v[7];
+					float dz = dense[n].v[11] - reduced[n].v[11];
+
+					error = std::max(error, std::sqrt(dx * dx + dy * dy + dz * dz));
+				}
+			}
+
+			return error;
+		};
+
+		std::cout << "Reducing " << astro_boy_animations_count << " tracks, max world space error " << max_error << "\n";
+
+		// The chain shares are a conservative estimate, errors of a chain rarely line up, so the shares are scaled up while the measured
+		// world error stays within max_error, or down until it is
+		float budget_scale = 1.0f;
+		auto  keys         = reduce_tracks(budget_scale);
+		float error        = world_error(keys);
+
+		while (error > max_error)
+		{
+			budget_scale *= 0.8f;
+			keys  = reduce_tracks(budget_scale);
+			error = world_error(keys);
+		}
+
+		while (budget_scale < 64.0f)
+		{
+			auto  looser_keys  = reduce_tracks(budget_scale * 1.25f);
+			float looser_error = world_error(looser_keys);
+
+			if (looser_error > max_error)
+				break;
+
+			budget_scale *= 1.25f;
+			keys  = std::move(looser_keys);
+			error = looser_error;
+		}
+
+		std::cout << "World space error " << error << " with " << budget_scale << " of the chain shares\n";
+
+		std::vector<unsigned int> curve_tracks;
+		std::vector<float>        curve_times[3];
+		std::vector<float>        curve_values[3];
+		size_t                    bytes_before = 0, bytes_after = 0;
+
+		for (size_t t = 0; t < track_nodes.size(); ++t)
+		{
+			const std::vector<Qvv> &frames = track_frames[t];
+
+			curve_tracks.push_back(track_nodes[t]);
+
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				curve_tracks.push_back(static_cast<unsigned int>(curve_times[c].size()));
+				curve_tracks.push_back(static_cast<unsigned int>(keys[t][c].size()));
+
+				for (auto key : keys[t][c])
+				{
+					curve_times[c].push_back(times[key]);
+					curve_values[c].insert(curve_values[c].end(), frames[key].begin() + channels[c].m_begin, frames[key].begin() + channels[c].m_end);
+				}
+			}
+
+			size_t before = times.size() * sizeof(ColladaMatrix);
+			size_t after  = (keys[t][0].size() * 5 + keys[t][1].size() * 4 + keys[t][2].size() * 4) * sizeof(float);
+
+			// Largest error of all three channels reconstructed together, at the track's shell distance like reduce_channel measures
+			float track_error    = 0.0f;
+			float shell_distance = std::max(shell_distances[track_nodes[t]], 0.1f);
+
+			for (size_t f = 0; f < times.size(); ++f)
+			{
+				Qvv frame = frames[f];
+				for (unsigned int c = 0; c < 3; ++c)
+					reconstruct(frames, times, keys[t][c], times[f], channels[c], frame);
+
+				track_error = std::max(track_error, qvv_error(frames[f], frame, shell_distance));
+			}
+
+			bytes_before += before;
+			bytes_after += after;
+
+			std::cout << std::setw(12) << astro_boy_tree_collada[track_nodes[t]].m_name << " keys " << times.size() << " -> rotation " << std::setw(2) << keys[t][0].size()
+					  << " translation " << std::setw(2) << keys[t][1].size() << " scale " << std::setw(2) << keys[t][2].size() << " chain "
+					  << animated_above[track_nodes[t]] + animated_below[track_nodes[t]] << " bytes " << before << " -> " << after << " error " << track_error << "\n";
+		}
+
+		std::cout << "Total bytes " << bytes_before << " -> " << bytes_after << "\n";
+
+		std::cout << "Writing out astro_boy_animation_curves.hpp\n";
+
+		std::ofstream curves_file("astro_boy_animation_curves.hpp");
+		write_license(curves_file);
+
+		curves_file << "#pragma once\n\n// astro_boy_animation_keyframe_matrices reduced to cubic Hermite curves within " << max_error
+					<< " world space joint position error, generated with ./geom " << max_error << "\n\n";
+		curves_file << std::fixed << std::setprecision(6) << "const unsigned int astro_boy_curve_tracks_count = " << curve_tracks.size() / 7 << ";\n";
+		curves_file << "\n// Node index, then first key and keys count of rotation, translation and scale of each track\n";
+		write_array(curves_file, curve_tracks, "astro_boy_curve_tracks_count * 7", "astro_boy_curve_tracks", "unsigned int");
+
+		const char *channel_names[3] = {"rotation", "translation", "scale"};
+		const char *channel_sizes[3] = {" * 4", " * 3", " * 3"};
+
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			std::string count = std::string("astro_boy_curve_") + channel_names[c] + "_keys_count";
+
+			curves_file << "\nconst unsigned int " << count << " = " << curve_times[c].size() << ";\n\n";
+			write_array(curves_file, curve_times[c], count, std::string("astro_boy_curve_") + channel_names[c] + "_times", "float");
+			write_array(curves_file, curve_values[c], count + channel_sizes[c], std::string("astro_boy_curve_") + channel_names[c] + "_values", "float");
+		}
 	}
 
 	return 0;
@@ -27,13 +27,20 @@
 #include "CImg.h"
 #include "gl_common.hpp"
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <utility>
 #include <vector>
 
 #include "math/rormatrix4.hpp"
 #include "math/rormatrix4_functions.hpp"
+#include "transform.hpp"
 
 void check_gl_error(const char *file, int line)
 {
@@ -250,7 +257,7 @@ class Geometry
 		glUniformMatrix4fv(m_mvp_location, 1, GL_FALSE, mvp);
 		check_gl_error(__FILE__, __LINE__);
 
-		if (this->m_texture != -1)
+		if (this->m_texture != -1u)
 		{
 			std::printf("Texture is = %d\n", this->m_texture);
 			glBindTexture(GL_TEXTURE_2D, this->m_texture);
@@ -381,6 +388,283 @@ Geometry *create_cube(float a_size, ror::Vector3f a_origin, const char *a_vertex
 						sizeof(unsigned int) * indices.size(), indices.data(), indices.size());
 }
 
+// Layout of the joint palette in the joint_matrices uniform block
+enum class PaletteMode
+{
+	matrix4,               // One mat4 per joint
+	affine3x4,             // Three vec4 rows per joint, the constant last row isn't stored
+	dual_quaternion        // Two vec4 per joint, real then dual part
+};
+
+unsigned int palette_joint_size(PaletteMode a_palette_mode)
+{
+	switch (a_palette_mode)
+	{
+		case PaletteMode::matrix4:
+			return sizeof(ror::Matrix4f);
+		case PaletteMode::affine3x4:
+			return sizeof(Matrix3x4);
+		case PaletteMode::dual_quaternion:
+			return sizeof(DualQuaternion);
+	}
+
+	return sizeof(ror::Matrix4f);
+}
+
+// Vertex layouts AnimatedGeometry can draw from
+enum class VertexFormat
+{
+	separate,        // A float buffer each for positions, normals, uvs and weights and an int buffer of joints
+	packed           // Interleaved PackedSkinnedVertex
+};
+
+// Interleaved skinned vertex of 28 bytes instead of 56 bytes in five streams of floats and ints
+// Normal is signed normalised 10_10_10_2, uv half floats, 4 influences of unsigned normalised weights and byte joint indices
+typedef struct
+{
+	float    m_position[3];
+	uint32_t m_normal;        // GL_INT_2_10_10_10_REV, x in the lowest bits
+	uint16_t m_uv[2];         // GL_HALF_FLOAT
+	uint8_t  m_weights[4];        // Sum to 255 so the implied 4th weight of the shaders stays exact
+	uint8_t  m_joints[4];
+} PackedSkinnedVertex;
+
+static_assert(sizeof(PackedSkinnedVertex) == 28, "Packed vertex must be tightly packed");
+
+// Round to nearest half float, values past the half range become infinity, no denormals are produced
+uint16_t float_to_half(float a_value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &a_value, sizeof(bits));
+
+	uint32_t sign     = (bits >> 16) & 0x8000u;
+	int      exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffffu;
+
+	if (exponent <= 0)
+		return static_cast<uint16_t>(sign);
+
+	if (exponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00u);
+
+	// Rounding can carry into the exponent, which is still the right result
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	half += (mantissa >> 12) & 1u;
+
+	return static_cast<uint16_t>(sign | std::min(half, 0x7c00u));
+}
+
+// Signed normalised 10 bits for each of x, y and z, w is left 0
+uint32_t pack_normal_10_10_10_2(const float *a_normal)
+{
+	uint32_t packed = 0;
+
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		int value = static_cast<int>(std::round(std::min(std::max(a_normal[i], -1.0f), 1.0f) * 511.0f));
+		packed |= (static_cast<uint32_t>(value) & 0x3ffu) << (i * 10);
+	}
+
+	return packed;
+}
+
+// Packs the separate arrays of the generator into PackedSkinnedVertex, a_influences weights and joints per vertex up to 4
+std::vector<PackedSkinnedVertex> pack_skinned_vertices(const float *a_positions, const float *a_normals, const float *a_uvs, const float *a_weights,
+														 const int *a_joints, unsigned int a_influences, unsigned int a_vertex_count)
+{
+	assert(a_influences <= 4 && "Packed vertices have room for 4 influences");
+
+	std::vector<PackedSkinnedVertex> vertices(a_vertex_count);
+
+	for (unsigned int i = 0; i < a_vertex_count; ++i)
+	{
+		PackedSkinnedVertex &vertex = vertices[i];
+
+		std::memcpy(vertex.m_position, a_positions + i * 3, sizeof(vertex.m_position));
+
+		vertex.m_normal = pack_normal_10_10_10_2(a_normals + i * 3);
+		vertex.m_uv[0]  = float_to_half(a_uvs[i * 2 + 0]);
+		vertex.m_uv[1]  = float_to_half(a_uvs[i * 2 + 1]);
+
+		float        total   = 0.0f;
+		int          sum     = 0;
+		unsigned int largest = 0;
+
+		for (unsigned int j = 0; j < a_influences; ++j)
+			total += a_weights[i * a_influences + j];
+
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			float weight = j < a_influences && total > 0.0f ? a_weights[i * a_influences + j] / total : 0.0f;
+
+			vertex.m_weights[j] = static_cast<uint8_t>(std::round(weight * 255.0f));
+			vertex.m_joints[j]  = static_cast<uint8_t>(j < a_influences ? a_joints[i * a_influences + j] : 0);
+			sum += vertex.m_weights[j];
+
+			assert((j >= a_influences || a_joints[i * a_influences + j] < 256) && "Packed vertices have byte joint indices");
+
+			if (vertex.m_weights[j] > vertex.m_weights[largest])
+				largest = j;
+		}
+
+		// Rounding error goes to the biggest influence
+		vertex.m_weights[largest] = static_cast<uint8_t>(vertex.m_weights[largest] + 255 - sum);
+	}
+
+	return vertices;
+}
+
+// Whether the context can create persistently mapped buffers with glBufferStorage
+bool buffer_storage_supported()
+{
+	GLint major = 0, minor = 0;
+
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	return major > 4 || (major == 4 && minor >= 4);
+}
+
+// Uniform buffer persistently mapped for the whole run, split into a slot per frame in flight so palettes are written
+// straight into buffer memory without any glBufferSubData. Every slot is fenced after the frame's draws and the next
+// frame writing into it waits on that fence first, so memory the GPU might still read is never overwritten
+// Needs GL 4.4, see buffer_storage_supported, contexts without it keep uploading with glBufferSubData
+class PaletteRing
+{
+  public:
+	// a_frame_size bytes of palettes per frame for each of a_frames_count frames in flight
+	PaletteRing(size_t a_frame_size, unsigned int a_frames_count = 3) :
+		m_fences(a_frames_count, nullptr)
+	{
+		assert(buffer_storage_supported() && "Persistent mapping needs GL 4.4");
+
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+		this->m_alignment  = static_cast<size_t>(std::max(alignment, 1));
+		this->m_frame_size = this->align(a_frame_size);
+
+		GLsizeiptr size  = static_cast<GLsizeiptr>(this->m_frame_size * a_frames_count);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glGenBuffers(1, &this->m_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->m_buffer);
+		glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+		this->m_memory = static_cast<unsigned char *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+		assert(this->m_memory && "Failed to map the palette ring");
+	}
+
+	~PaletteRing()
+	{
+		for (auto fence : this->m_fences)
+			if (fence)
+				glDeleteSync(fence);
+
+		glBindBuffer(GL_UNIFORM_BUFFER, this->m_buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glDeleteBuffers(1, &this->m_buffer);
+	}
+
+	PaletteRing(const PaletteRing &) = delete;
+	PaletteRing &operator=(const PaletteRing &) = delete;
+
+	// Moves on to the next slot, waiting for the GPU to finish the frame that last used it
+	void begin_frame()
+	{
+		this->m_frame = (this->m_frame + 1) % static_cast<unsigned int>(this->m_fences.size());
+		this->m_used  = 0;
+		++this->m_serial;
+
+		GLsync &fence = this->m_fences[this->m_frame];
+
+		if (fence)
+		{
+			GLenum status = glClientWaitSync(fence, 0, 0);
+
+			if (status == GL_TIMEOUT_EXPIRED)
+			{
+				++this->m_waits_count;
+
+				// Flushing the first time round, the fence might not even be submitted yet
+				for (GLbitfield flush = GL_SYNC_FLUSH_COMMANDS_BIT; status == GL_TIMEOUT_EXPIRED; flush = 0)
+					status = glClientWaitSync(fence, flush, 1000000000);
+			}
+
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	// Fences the slot after the last draw of the frame reading from it
+	void end_frame()
+	{
+		this->m_fences[this->m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// a_size bytes of this frame's slot to write a palette into, a_offset is where to bind it from
+	// nullptr with a_offset 0 once the slot is full, callers fall back to their own buffer
+	void *allocate(size_t a_size, GLintptr &a_offset)
+	{
+		size_t size = this->align(a_size);
+
+		a_offset = 0;
+
+		if (this->m_used + size > this->m_frame_size)
+			return nullptr;
+
+		a_offset = static_cast<GLintptr>(this->m_frame * this->m_frame_size + this->m_used);
+		this->m_used += size;
+
+		return this->m_memory + a_offset;
+	}
+
+	// Counts begin_frame calls, tells apart allocations of this frame from older ones
+	unsigned int frame_serial() const
+	{
+		return this->m_serial;
+	}
+
+	// Binds a_size bytes from a_offset to uniform block binding a_index
+	void bind(GLuint a_index, GLintptr a_offset, size_t a_size) const
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, a_index, this->m_buffer, a_offset, static_cast<GLsizeiptr>(a_size));
+	}
+
+	// Times begin_frame had to wait for the GPU, more frames in flight help if this keeps growing
+	unsigned int waits_count() const
+	{
+		return this->m_waits_count;
+	}
+
+  private:
+	size_t align(size_t a_size) const
+	{
+		return (a_size + this->m_alignment - 1) / this->m_alignment * this->m_alignment;
+	}
+
+	GLuint               m_buffer      = 0;
+	unsigned char *      m_memory      = nullptr;        // Whole buffer, written by the CPU and only read by the GPU
+	std::vector<GLsync>  m_fences;                       // Per slot, set once the frame using it is submitted
+	size_t               m_alignment   = 256;
+	size_t               m_frame_size  = 0;
+	size_t               m_used        = 0;
+	unsigned int         m_frame       = 0;
+	unsigned int         m_serial      = 0;
+	unsigned int         m_waits_count = 0;
+};
+
+// Per instance data of AnimatedGeometry::draw_instanced
+typedef struct
+{
+	float    m_model[16];
+	uint32_t m_palette_offset;        // First joint of the instance's palette in the palette buffer
+	float    m_animation_time;        // Added to the time of the draw with an animation texture, see AnimatedGeometry::set_animation_texture
+} SkinnedInstance;
+
 class AnimatedGeometry
 {
   public:
@@ -393,33 +677,9 @@ class AnimatedGeometry
 					 unsigned int a_vertex_weight_buffer_object_size, void *a_vertex_weight_buffer_object,
 					 unsigned int a_vertex_joint_buffer_object_size, void *a_vertex_joint_buffer_object,
 					 unsigned int a_index_buffer_object_size, void *a_index_buffer_object,
-					 unsigned int a_primitivies_count, unsigned int a_joints_count = 44)
+					 unsigned int a_primitivies_count, unsigned int a_joints_count = 44, PaletteMode a_palette_mode = PaletteMode::matrix4)
 	{
-		this->m_program = compile_shaders(a_vertex_shader_src, a_fragment_shader_src);
-
-		check_gl_error(__FILE__, __LINE__);
-		this->m_model_location      = glGetUniformLocation(this->m_program, "model");
-		this->m_view_location       = glGetUniformLocation(this->m_program, "view");
-		this->m_projection_location = glGetUniformLocation(this->m_program, "projection");
-
-		this->m_texture_location = glGetUniformLocation(this->m_program, "diffuse_texture");
-
-		this->m_uniform_block_index = glGetUniformBlockIndex(this->m_program, "joint_matrices");
-
-		check_gl_error(__FILE__, __LINE__);
-		glGenBuffers(1, &this->m_joint_matrices);
-
-		check_gl_error(__FILE__, __LINE__);
-		glBindBuffer(GL_UNIFORM_BUFFER, this->m_joint_matrices);
-		glBufferData(GL_UNIFORM_BUFFER, a_joints_count * sizeof(ror::Matrix4f), nullptr, GL_STATIC_DRAW);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-		check_gl_error(__FILE__, __LINE__);
-		glBindBufferRange(GL_UNIFORM_BUFFER, 0, this->m_joint_matrices, 0, a_joints_count * sizeof(ror::Matrix4f));
-
-		check_gl_error(__FILE__, __LINE__);
-		if (this->m_uniform_block_index != -1)
-			glUniformBlockBinding(this->m_program, this->m_uniform_block_index, 0);
+		this->setup_program(a_vertex_shader_src, a_fragment_shader_src, a_joints_count, a_palette_mode);
 
 		check_gl_error(__FILE__, __LINE__);
 		glGenVertexArrays(1, &this->m_vertex_array);
@@ -441,24 +701,25 @@ class AnimatedGeometry
 		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_weight_buffer);
 		glBufferData(GL_ARRAY_BUFFER, a_vertex_weight_buffer_object_size, a_vertex_weight_buffer_object, GL_STATIC_DRAW);
 
-		glGenBuffers(1, &this->m_vertex_joint_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffer);
+		this->m_vertex_joint_buffers.resize(1);
+		glGenBuffers(1, &this->m_vertex_joint_buffers[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffers[0]);
 		glBufferData(GL_ARRAY_BUFFER, a_vertex_joint_buffer_object_size, a_vertex_joint_buffer_object, GL_STATIC_DRAW);
 
 		glGenBuffers(1, &this->m_index_buffer);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_index_buffer);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, a_index_buffer_object_size, a_index_buffer_object, GL_STATIC_DRAW);
 
-		glEnableVertexAttribArray(0);        // Position
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glEnableVertexAttribArray(1);        // Normal
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glEnableVertexAttribArray(2);        // UV
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glEnableVertexAttribArray(3);        // Weights
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glEnableVertexAttribArray(4);        // Joints
-		glVertexAttribIPointer(4, 3, GL_UNSIGNED_INT, 0, nullptr);
+		for (GLuint attribute = 0; attribute < 5; ++attribute)
+			glEnableVertexAttribArray(attribute);        // Position, normal, uv, weights and joints
+
+		// The generator writes as many influences per vertex as the most influenced vertex has, up to 4
+		this->m_vertices_count = static_cast<unsigned int>(a_vertex_position_buffer_object_size / (3 * sizeof(float)));
+		this->m_influences     = a_vertex_weight_buffer_object_size / (this->m_vertices_count * static_cast<unsigned int>(sizeof(float)));
+
+		assert(this->m_influences <= 4 && "Shaders skin with up to 4 influences");
+
+		this->set_vertex_attributes(this->m_joint_lod);
 
 		if (a_texture_file_name != nullptr)
 			this->m_texture = create_texture(a_texture_file_name);
@@ -467,25 +728,51 @@ class AnimatedGeometry
 		this->m_primitives_count = a_primitivies_count;
 	}
 
-	void bind_me(const GLfloat *model, const GLfloat *view, const GLfloat *projection)
+	// Same from interleaved vertices, see pack_skinned_vertices. The shaders are the same, weights are normalised to floats by the attribute
+	AnimatedGeometry(const char *a_vertex_shader_src, const char *a_fragment_shader_src, const char *a_texture_file_name,
+					 const std::vector<PackedSkinnedVertex> &a_vertices,
+					 unsigned int a_index_buffer_object_size, void *a_index_buffer_object,
+					 unsigned int a_primitivies_count, unsigned int a_joints_count = 44, PaletteMode a_palette_mode = PaletteMode::matrix4)
 	{
-		glUseProgram(m_program);
-		glBindVertexArray(m_vertex_array);
+		this->m_vertex_format = VertexFormat::packed;
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_position_buffer);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		this->setup_program(a_vertex_shader_src, a_fragment_shader_src, a_joints_count, a_palette_mode);
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_normal_buffer);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		check_gl_error(__FILE__, __LINE__);
+		glGenVertexArrays(1, &this->m_vertex_array);
+		glBindVertexArray(this->m_vertex_array);
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_uv_buffer);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+		// Joint lod 0 is the interleaved buffer itself
+		this->m_vertex_joint_buffers.resize(1);
+		glGenBuffers(1, &this->m_vertex_joint_buffers[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffers[0]);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(a_vertices.size() * sizeof(PackedSkinnedVertex)), a_vertices.data(), GL_STATIC_DRAW);
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_weight_buffer);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+		glGenBuffers(1, &this->m_index_buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_index_buffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, a_index_buffer_object_size, a_index_buffer_object, GL_STATIC_DRAW);
+
+		for (GLuint attribute = 0; attribute < 5; ++attribute)
+			glEnableVertexAttribArray(attribute);
+
+		this->m_vertices_count = static_cast<unsigned int>(a_vertices.size());
+		this->set_vertex_attributes(this->m_joint_lod);
 
-		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffer);
-		glVertexAttribIPointer(4, 3, GL_UNSIGNED_INT, 0, nullptr);
+		if (a_texture_file_name != nullptr)
+			this->m_texture = create_texture(a_texture_file_name);
+
+		check_gl_error(__FILE__, __LINE__);
+		this->m_primitives_count = a_primitivies_count;
+	}
+
+	void bind_me(const GLfloat *model, const GLfloat *view, const GLfloat *projection)
+	{
+		glUseProgram(m_program);
+		glBindVertexArray(m_vertex_array);
+
+		// Baked palettes are full skeleton ones
+		this->set_vertex_attributes(this->m_animation_texture != -1u ? 0 : this->m_joint_lod);
+		this->bind_animation_texture(this->m_animation_locations);
 
 		if (this->m_texture != -1)
 			glBindTexture(GL_TEXTURE_2D, this->m_texture);
@@ -497,6 +784,15 @@ class AnimatedGeometry
 		if (this->m_texture != -1 && this->m_texture_location != -1)
 			glUniform1i(this->m_texture_location, 0);
 
+		// Another geometry or the ring might have taken the binding
+		if (this->m_palette_ring && this->m_ring_offset != -1 && this->m_ring_frame != this->m_palette_ring->frame_serial())
+			this->carry_ring_palette();
+
+		if (this->m_palette_ring && this->m_ring_offset != -1)
+			this->m_palette_ring->bind(0, this->m_ring_offset, this->m_palette_size);
+		else
+			glBindBufferRange(GL_UNIFORM_BUFFER, 0, this->m_joint_matrices, 0, this->m_palette_size);
+
 		glBindBuffer(GL_UNIFORM_BUFFER, this->m_joint_matrices);
 
 		check_gl_error(__FILE__, __LINE__);
@@ -513,9 +809,90 @@ class AnimatedGeometry
 
 	void update_matrices(const std::vector<ror::Matrix4f> &a_matrices)
 	{
-		glBindBuffer(GL_UNIFORM_BUFFER, this->m_joint_matrices);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, a_matrices.size() * sizeof(ror::Matrix4f), a_matrices.data());
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		assert(this->m_palette_mode == PaletteMode::matrix4 && "Palette doesn't match the palette mode");
+
+		this->update_palette(a_matrices.data(), a_matrices.size() * sizeof(ror::Matrix4f));
+	}
+
+	void update_matrices(const std::vector<Matrix3x4> &a_matrices)
+	{
+		assert(this->m_palette_mode == PaletteMode::affine3x4 && "Palette doesn't match the palette mode");
+
+		this->update_palette(a_matrices.data(), a_matrices.size() * sizeof(Matrix3x4));
+	}
+
+	void update_matrices(const std::vector<DualQuaternion> &a_matrices)
+	{
+		assert(this->m_palette_mode == PaletteMode::dual_quaternion && "Palette doesn't match the palette mode");
+
+		this->update_palette(a_matrices.data(), a_matrices.size() * sizeof(DualQuaternion));
+	}
+
+	PaletteMode palette_mode() const
+	{
+		return this->m_palette_mode;
+	}
+
+	VertexFormat vertex_format() const
+	{
+		return this->m_vertex_format;
+	}
+
+	// Bytes bound for the joint_matrices block, at least the declared block size
+	unsigned int palette_size() const
+	{
+		return this->m_palette_size;
+	}
+
+	// Palettes are written straight into a slot of a_ring instead of the geometry's own uniform buffer. The caller begins the ring's
+	// frame before updating palettes and ends it after the draws. Frames without an update copy the last palette into their own slot
+	// while drawing. nullptr goes back to glBufferSubData uploads
+	void set_palette_ring(PaletteRing *a_ring)
+	{
+		this->m_palette_ring = a_ring;
+		this->m_ring_offset  = -1;
+	}
+
+	// Adds another set of joint indices, like the ones from AnimationLod::remap_vertex_joints, and returns its index for set_joint_lod
+	// Index 0 is the joint buffer given to the constructor. Packed geometry stores them as 4 bytes per vertex like its vertices
+	unsigned int add_joint_lod(unsigned int a_vertex_joint_buffer_object_size, const void *a_vertex_joint_buffer_object)
+	{
+		GLuint               buffer;
+		std::vector<uint8_t> packed_joints;
+
+		if (this->m_vertex_format == VertexFormat::packed)
+		{
+			const int *  joints     = static_cast<const int *>(a_vertex_joint_buffer_object);
+			unsigned int influences = a_vertex_joint_buffer_object_size / (sizeof(int) * this->m_vertices_count);
+
+			assert(influences <= 4 && "Packed vertices have room for 4 influences");
+
+			packed_joints.assign(this->m_vertices_count * 4, 0);
+
+			for (unsigned int i = 0; i < this->m_vertices_count; ++i)
+				for (unsigned int j = 0; j < influences; ++j)
+					packed_joints[i * 4 + j] = static_cast<uint8_t>(joints[i * influences + j]);
+
+			a_vertex_joint_buffer_object_size = static_cast<unsigned int>(packed_joints.size());
+			a_vertex_joint_buffer_object      = packed_joints.data();
+		}
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, a_vertex_joint_buffer_object_size, a_vertex_joint_buffer_object, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+		this->m_vertex_joint_buffers.push_back(buffer);
+
+		return static_cast<unsigned int>(this->m_vertex_joint_buffers.size() - 1);
+	}
+
+	// Joint indices used by the following draws, the palette uploaded must be the one these indices were remapped for
+	void set_joint_lod(unsigned int a_joint_lod)
+	{
+		assert(a_joint_lod < this->m_vertex_joint_buffers.size() && "Joint lod out of range");
+		this->m_joint_lod = a_joint_lod;
 	}
 
 	void draw(const GLfloat *model, const GLfloat *view, const GLfloat *projection, GLint prim)
@@ -526,7 +903,319 @@ class AnimatedGeometry
 		check_gl_error(__FILE__, __LINE__);
 	}
 
+	// Draws sample their palettes from a_texture, the palettes of a clip baked a frame per row with joints_count() * 3 RGBA32F rows each,
+	// instead of the joint_matrices block. The shaders need an animation_palettes sampler and animation_time, animation_duration,
+	// animation_frames and animation_loop uniforms. Call after enable_instancing for instanced draws to use it as well, see AnimationTexture
+	void set_animation_texture(GLuint a_texture, unsigned int a_frames_count, float a_duration, bool a_loop)
+	{
+		this->m_animation_texture  = a_texture;
+		this->m_animation_frames   = a_frames_count;
+		this->m_animation_duration = a_duration;
+		this->m_animation_loop     = a_loop;
+
+		this->m_animation_locations = animation_locations(this->m_program);
+
+		if (this->m_instanced_program != -1u)
+			this->m_instanced_animation_locations = animation_locations(this->m_instanced_program);
+	}
+
+	// Clip time of the following draws with an animation texture, instances add their own m_animation_time
+	void set_animation_time(float a_time)
+	{
+		this->m_animation_time = a_time;
+	}
+
+	// Sets up draw_instanced with its own program, the vertex shader reads a mat4 model at locations 5 to 8 and a uint palette_offset at 9 per instance
+	// Palettes are affine rows in a RGBA32F texture buffer named joint_palettes, a texture buffer rather than a storage buffer so it works on GL 4.1 too
+	// Texture buffers only have to hold 65536 texels, instances * a_instance_joints_count * 3 rows have to fit GL_MAX_TEXTURE_BUFFER_SIZE
+	// Returns how many instances fit, fewer than a_instances_count if the palettes don't, draw and update no more than that
+	unsigned int enable_instancing(const char *a_vertex_shader_src, const char *a_fragment_shader_src, unsigned int a_instances_count, unsigned int a_instance_joints_count)
+	{
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+
+		if (a_instance_joints_count > 0)
+		{
+			unsigned int max_instances = static_cast<unsigned int>(max_texels) / (a_instance_joints_count * 3);
+
+			if (a_instances_count > max_instances)
+			{
+				std::printf("GL_MAX_TEXTURE_BUFFER_SIZE of %d texels only fits the palettes of %u instances, drawing %u instead of %u\n",
+							max_texels, max_instances, max_instances, a_instances_count);
+				a_instances_count = max_instances;
+			}
+		}
+
+		this->m_instanced_program = compile_shaders(a_vertex_shader_src, a_fragment_shader_src);
+
+		this->m_instanced_view_location       = glGetUniformLocation(this->m_instanced_program, "view");
+		this->m_instanced_projection_location = glGetUniformLocation(this->m_instanced_program, "projection");
+
+		glUseProgram(this->m_instanced_program);
+		glUniform1i(glGetUniformLocation(this->m_instanced_program, "diffuse_texture"), 0);
+		glUniform1i(glGetUniformLocation(this->m_instanced_program, "joint_palettes"), 1);
+		glUseProgram(0);
+
+		this->m_instances_size         = a_instances_count * sizeof(SkinnedInstance);
+		this->m_instance_palettes_size = a_instances_count * a_instance_joints_count * sizeof(Matrix3x4);
+
+		glGenBuffers(1, &this->m_instance_palettes);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->m_instance_palettes);
+		glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(this->m_instance_palettes_size), nullptr, GL_STREAM_DRAW);
+
+		glGenTextures(1, &this->m_instance_palettes_texture);
+		glBindTexture(GL_TEXTURE_BUFFER, this->m_instance_palettes_texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->m_instance_palettes);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glBindVertexArray(this->m_vertex_array);
+
+		glGenBuffers(1, &this->m_instance_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(this->m_instances_size), nullptr, GL_STREAM_DRAW);
+
+		const GLsizei stride = sizeof(SkinnedInstance);
+
+		for (GLuint column = 0; column < 4; ++column)
+		{
+			glEnableVertexAttribArray(5 + column);        // Model
+			glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offsetof(SkinnedInstance, m_model) + column * 4 * sizeof(float)));
+			glVertexAttribDivisor(5 + column, 1);
+		}
+
+		glEnableVertexAttribArray(9);        // Palette offset
+		glVertexAttribIPointer(9, 1, GL_UNSIGNED_INT, stride, reinterpret_cast<void *>(offsetof(SkinnedInstance, m_palette_offset)));
+		glVertexAttribDivisor(9, 1);
+
+		glEnableVertexAttribArray(10);        // Animation time
+		glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offsetof(SkinnedInstance, m_animation_time)));
+		glVertexAttribDivisor(10, 1);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+
+		return a_instances_count;
+	}
+
+	// Palettes of all instances one after the other, a_palettes_size matrices, and the instances pointing into them
+	// The buffers get new storage of just the size used, so drawing the previous frame's instances doesn't stall the upload
+	void update_instances(const Matrix3x4 *a_palettes, unsigned int a_palettes_size, const SkinnedInstance *a_instances, unsigned int a_instances_count)
+	{
+		size_t palettes_size  = a_palettes_size * sizeof(Matrix3x4);
+		size_t instances_size = a_instances_count * sizeof(SkinnedInstance);
+
+		assert(palettes_size <= this->m_instance_palettes_size && instances_size <= this->m_instances_size && "More instances than enable_instancing was given");
+
+		glBindBuffer(GL_TEXTURE_BUFFER, this->m_instance_palettes);
+		glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(palettes_size), a_palettes, GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instances_size), a_instances, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+	}
+
+	// One draw of the first a_instances_count instances of update_instances
+	// Instances use the joint indices given to the constructor, so their palettes are full skeleton ones whatever the joint lod
+	void draw_instanced(const GLfloat *view, const GLfloat *projection, unsigned int a_instances_count, GLint prim)
+	{
+		assert(this->m_instanced_program != -1u && "Instancing isn't enabled");
+
+		glUseProgram(this->m_instanced_program);
+		glBindVertexArray(this->m_vertex_array);
+
+		this->set_vertex_attributes(0);
+		this->bind_animation_texture(this->m_instanced_animation_locations);
+
+		if (this->m_texture != -1)
+			glBindTexture(GL_TEXTURE_2D, this->m_texture);
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_BUFFER, this->m_instance_palettes_texture);
+		glActiveTexture(GL_TEXTURE0);
+
+		glUniformMatrix4fv(this->m_instanced_view_location, 1, GL_FALSE, view);
+		glUniformMatrix4fv(this->m_instanced_projection_location, 1, GL_FALSE, projection);
+
+		glDrawElementsInstanced(prim, this->m_primitives_count, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(a_instances_count));
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+
+		unbind_me();
+		check_gl_error(__FILE__, __LINE__);
+	}
+
   private:
+	typedef struct
+	{
+		GLint m_palettes;
+		GLint m_time;
+		GLint m_duration;
+		GLint m_frames;
+		GLint m_loop;
+	} AnimationLocations;
+
+	static AnimationLocations animation_locations(GLuint a_program)
+	{
+		AnimationLocations locations;
+
+		locations.m_palettes = glGetUniformLocation(a_program, "animation_palettes");
+		locations.m_time     = glGetUniformLocation(a_program, "animation_time");
+		locations.m_duration = glGetUniformLocation(a_program, "animation_duration");
+		locations.m_frames   = glGetUniformLocation(a_program, "animation_frames");
+		locations.m_loop     = glGetUniformLocation(a_program, "animation_loop");
+
+		return locations;
+	}
+
+	// Animation texture goes in unit 2, after the diffuse texture and the instance palettes. Expects a_locations' program to be in use
+	void bind_animation_texture(const AnimationLocations &a_locations)
+	{
+		if (this->m_animation_texture == -1u)
+			return;
+
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, this->m_animation_texture);
+		glActiveTexture(GL_TEXTURE0);
+
+		glUniform1i(a_locations.m_palettes, 2);
+		glUniform1f(a_locations.m_time, this->m_animation_time);
+		glUniform1f(a_locations.m_duration, this->m_animation_duration);
+		glUniform1i(a_locations.m_frames, static_cast<GLint>(this->m_animation_frames));
+		glUniform1i(a_locations.m_loop, this->m_animation_loop ? 1 : 0);
+	}
+
+	void setup_program(const char *a_vertex_shader_src, const char *a_fragment_shader_src, unsigned int a_joints_count, PaletteMode a_palette_mode)
+	{
+		this->m_palette_mode = a_palette_mode;
+
+		this->m_program = compile_shaders(a_vertex_shader_src, a_fragment_shader_src);
+
+		check_gl_error(__FILE__, __LINE__);
+		this->m_model_location      = glGetUniformLocation(this->m_program, "model");
+		this->m_view_location       = glGetUniformLocation(this->m_program, "view");
+		this->m_projection_location = glGetUniformLocation(this->m_program, "projection");
+
+		this->m_texture_location = glGetUniformLocation(this->m_program, "diffuse_texture");
+
+		this->m_uniform_block_index = glGetUniformBlockIndex(this->m_program, "joint_matrices");
+
+		// The bound range has to cover the whole block, which can be declared bigger than the skeleton
+		GLint block_size  = 0;
+		GLint buffer_size = static_cast<GLint>(a_joints_count * palette_joint_size(a_palette_mode));
+
+		if (this->m_uniform_block_index != GL_INVALID_INDEX)
+			glGetActiveUniformBlockiv(this->m_program, this->m_uniform_block_index, GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+
+		buffer_size          = std::max(buffer_size, block_size);
+		this->m_palette_size = static_cast<unsigned int>(buffer_size);
+
+		check_gl_error(__FILE__, __LINE__);
+		glGenBuffers(1, &this->m_joint_matrices);
+
+		check_gl_error(__FILE__, __LINE__);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->m_joint_matrices);
+		glBufferData(GL_UNIFORM_BUFFER, buffer_size, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		check_gl_error(__FILE__, __LINE__);
+		glBindBufferRange(GL_UNIFORM_BUFFER, 0, this->m_joint_matrices, 0, buffer_size);
+
+		check_gl_error(__FILE__, __LINE__);
+		if (this->m_uniform_block_index != GL_INVALID_INDEX)
+			glUniformBlockBinding(this->m_program, this->m_uniform_block_index, 0);
+	}
+
+	// Attribute pointers of the vertex format and a_joint_lod, expects the vertex array to be bound
+	void set_vertex_attributes(unsigned int a_joint_lod)
+	{
+		if (this->m_vertex_format == VertexFormat::separate)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_position_buffer);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_normal_buffer);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_uv_buffer);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_weight_buffer);
+			glVertexAttribPointer(3, static_cast<GLint>(this->m_influences), GL_FLOAT, GL_FALSE, 0, nullptr);
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffers[a_joint_lod]);
+			glVertexAttribIPointer(4, static_cast<GLint>(this->m_influences), GL_UNSIGNED_INT, 0, nullptr);
+
+			return;
+		}
+
+		const GLsizei stride = sizeof(PackedSkinnedVertex);
+
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffers[0]);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offsetof(PackedSkinnedVertex, m_position)));
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, reinterpret_cast<void *>(offsetof(PackedSkinnedVertex, m_normal)));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(offsetof(PackedSkinnedVertex, m_uv)));
+		glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void *>(offsetof(PackedSkinnedVertex, m_weights)));
+
+		if (a_joint_lod == 0)
+			glVertexAttribIPointer(4, 4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<void *>(offsetof(PackedSkinnedVertex, m_joints)));
+		else
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, this->m_vertex_joint_buffers[a_joint_lod]);
+			glVertexAttribIPointer(4, 4, GL_UNSIGNED_BYTE, 0, nullptr);
+		}
+	}
+
+	// With a ring the palette goes straight into this frame's slot, or into the own buffer if the slot is full
+	// A copy stays on the CPU for frames without an update, reading back from the mapping could be very slow
+	void update_palette(const void *a_palette, size_t a_size)
+	{
+		assert(a_size <= this->m_palette_size && "Palette bigger than the uniform block");
+
+		if (this->m_palette_ring)
+		{
+			auto bytes = static_cast<const unsigned char *>(a_palette);
+			this->m_palette.assign(bytes, bytes + a_size);
+		}
+
+		this->write_palette(a_palette, a_size);
+	}
+
+	// Writes the last palette again into this frame's slot, the earlier slot gets reused once the ring comes round
+	void carry_ring_palette()
+	{
+		this->write_palette(this->m_palette.data(), this->m_palette.size());
+	}
+
+	void write_palette(const void *a_palette, size_t a_size)
+	{
+		if (this->m_palette_ring)
+		{
+			GLintptr offset  = 0;
+			void *   palette = this->m_palette_ring->allocate(this->m_palette_size, offset);
+
+			this->m_ring_offset = palette ? offset : -1;
+			this->m_ring_frame  = this->m_palette_ring->frame_serial();
+
+			if (palette)
+			{
+				std::memcpy(palette, a_palette, a_size);
+				return;
+			}
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, this->m_joint_matrices);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(a_size), a_palette);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
 	GLuint m_program          = -1;
 	GLint  m_texture          = -1;
 	GLint  m_texture_location = -1;
@@ -537,11 +1226,41 @@ class AnimatedGeometry
 	GLuint m_vertex_normal_buffer;
 	GLuint m_vertex_uv_buffer;
 	GLuint m_vertex_weight_buffer;
-	GLuint m_vertex_joint_buffer;
 	GLuint m_index_buffer;
 
-	GLuint m_uniform_block_index = -1;
-	GLuint m_joint_matrices      = -1;
+	std::vector<GLuint> m_vertex_joint_buffers;        // One per joint lod, the first is the vertex buffer of packed geometry
+	unsigned int        m_joint_lod      = 0;
+	unsigned int        m_vertices_count = 0;
+	unsigned int        m_influences     = 4;        // Weights and joints per vertex in the separate buffers
+	VertexFormat        m_vertex_format  = VertexFormat::separate;
+
+	GLuint       m_uniform_block_index = GL_INVALID_INDEX;
+	GLuint       m_joint_matrices      = -1;
+	PaletteMode  m_palette_mode        = PaletteMode::matrix4;
+	unsigned int m_palette_size        = 0;
+
+	PaletteRing *m_palette_ring = nullptr;
+	GLintptr     m_ring_offset  = -1;        // Latest palette in m_palette_ring, -1 when it's in m_joint_matrices
+	unsigned int m_ring_frame   = 0;         // PaletteRing::frame_serial of m_ring_offset
+
+	std::vector<unsigned char> m_palette;        // Latest palette with a ring, carried into the slots of frames without an update
+
+	GLuint m_instanced_program             = -1;
+	GLint  m_instanced_view_location       = -1;
+	GLint  m_instanced_projection_location = -1;
+	GLuint m_instance_buffer               = -1;        // SkinnedInstance per instance
+	GLuint m_instance_palettes             = -1;        // Matrix3x4 rows of all instances
+	GLuint m_instance_palettes_texture     = -1;
+	size_t m_instances_size                = 0;
+	size_t m_instance_palettes_size        = 0;
+
+	GLuint             m_animation_texture  = -1;        // Baked palettes sampled instead of the joint_matrices block
+	unsigned int       m_animation_frames   = 0;
+	float              m_animation_duration = 0.0f;
+	float              m_animation_time     = 0.0f;
+	bool               m_animation_loop     = true;
+	AnimationLocations m_animation_locations;
+	AnimationLocations m_instanced_animation_locations;
 
 	GLuint m_vertex_array;
 	GLuint m_primitives_count;
@@ -0,0 +1,206 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "gl_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#if defined HEADLESS_EGL
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
+
+// OpenGL context without a window or a display for CI and GPU-less build nodes
+// Uses EGL's surfaceless platform, which Mesa provides for its llvmpipe software rasterizer and for GPUs through render nodes
+// There's no default framebuffer, frames are drawn into a multisampled framebuffer object of the window's size instead
+class HeadlessContext
+{
+  public:
+	HeadlessContext(){};
+
+	~HeadlessContext()
+	{
+		this->destroy();
+	}
+
+	HeadlessContext(const HeadlessContext &) = delete;
+	HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+	// Creates a 4.5 core context like the windowed one and binds an a_width by a_height framebuffer, prints why on failure
+	bool create(int a_width, int a_height, int a_samples = 4)
+	{
+		auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+		if (get_platform_display)
+			this->m_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+		// Drivers without the surfaceless platform might still allow surfaceless contexts on the default display
+		if (this->m_display == EGL_NO_DISPLAY)
+			this->m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+		EGLint major, minor;
+
+		if (this->m_display == EGL_NO_DISPLAY || !eglInitialize(this->m_display, &major, &minor))
+			return this->fail("Failed to initialize an EGL display");
+
+		if (!eglBindAPI(EGL_OPENGL_API))
+			return this->fail("EGL can't create desktop OpenGL contexts");
+
+		// The default surface type is window, surfaceless displays only have pbuffer configs
+		const EGLint config_attributes[]  = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+		const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+											 EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+
+		EGLConfig config;
+		EGLint    configs_count = 0;
+
+		if (!eglChooseConfig(this->m_display, config_attributes, &config, 1, &configs_count) || configs_count == 0)
+			return this->fail("No EGL config for OpenGL");
+
+		this->m_context = eglCreateContext(this->m_display, config, EGL_NO_CONTEXT, context_attributes);
+
+		if (this->m_context == EGL_NO_CONTEXT)
+			return this->fail("Failed to create an OpenGL 4.5 core context");
+
+		if (!eglMakeCurrent(this->m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->m_context))
+			return this->fail("Surfaceless contexts aren't supported");
+
+		glGenRenderbuffers(2, this->m_renderbuffers);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, this->m_renderbuffers[0]);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, GL_RGBA8, a_width, a_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->m_renderbuffers[1]);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, GL_DEPTH_COMPONENT16, a_width, a_height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &this->m_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->m_framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->m_renderbuffers[0]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->m_renderbuffers[1]);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			return this->fail("Offscreen framebuffer is incomplete");
+
+		// Nothing sets the viewport without a surface
+		glViewport(0, 0, a_width, a_height);
+
+		std::printf("Headless EGL %d.%d, %s, %s\n", major, minor, glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+		return true;
+	}
+
+	// Stands in for the swap, waits for the frame to finish so its GPU time is part of the frame
+	void swap()
+	{
+		glFinish();
+	}
+
+	void destroy()
+	{
+		if (this->m_context != EGL_NO_CONTEXT)
+		{
+			glDeleteFramebuffers(1, &this->m_framebuffer);
+			glDeleteRenderbuffers(2, this->m_renderbuffers);
+
+			eglMakeCurrent(this->m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(this->m_display, this->m_context);
+		}
+
+		if (this->m_display != EGL_NO_DISPLAY)
+			eglTerminate(this->m_display);
+
+		this->m_context          = EGL_NO_CONTEXT;
+		this->m_display          = EGL_NO_DISPLAY;
+		this->m_framebuffer      = 0;
+		this->m_renderbuffers[0] = this->m_renderbuffers[1] = 0;
+	}
+
+  private:
+	bool fail(const char *a_message)
+	{
+		std::fprintf(stderr, "%s, EGL error 0x%x\n", a_message, eglGetError());
+		this->destroy();
+		return false;
+	}
+
+	EGLDisplay m_display          = EGL_NO_DISPLAY;
+	EGLContext m_context          = EGL_NO_CONTEXT;
+	GLuint     m_framebuffer      = 0;
+	GLuint     m_renderbuffers[2] = {0, 0};        // Color and depth
+};
+#else
+// Built without EGL, see CMakeLists.txt
+class HeadlessContext
+{
+  public:
+	bool create(int, int, int = 4)
+	{
+		std::fprintf(stderr, "Headless mode needs EGL, which wasn't found at build time\n");
+		return false;
+	}
+
+	void swap()
+	{}
+
+	void destroy()
+	{}
+};
+#endif
+
+// Durations of one phase of the frame over a whole run
+class PhaseTimings
+{
+  public:
+	PhaseTimings(const char *a_name) :
+		m_name(a_name)
+	{}
+
+	void add(double a_milliseconds)
+	{
+		this->m_samples.push_back(a_milliseconds);
+	}
+
+	// One line of mean, median, 99th percentile and worst in milliseconds
+	void print()
+	{
+		if (this->m_samples.empty())
+			return;
+
+		std::vector<double> sorted(this->m_samples);
+		std::sort(sorted.begin(), sorted.end());
+
+		double total = 0.0;
+		for (double sample : sorted)
+			total += sample;
+
+		std::printf("%-12s %10.3f %10.3f %10.3f %10.3f\n", this->m_name, total / static_cast<double>(sorted.size()), sorted[sorted.size() / 2],
+					sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)], sorted.back());
+	}
+
+  private:
+	const char *        m_name;
+	std::vector<double> m_samples;
+};
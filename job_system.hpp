@@ -0,0 +1,272 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool for data parallel loops, like updating every character of a crowd or skinning a mesh on the CPU
+// parallel_for splits the index range evenly between the threads. Each thread takes chunks off the front of its own range
+// and once that runs dry steals the back half of another thread's remaining range, so uneven costs still keep all threads busy
+// Chunk sizes adapt to the measured cost per index, aiming for chunks of roughly m_chunk_duration. Cheap items get big chunks
+// that amortise the locking, expensive ones small chunks that balance well. Workers are created once and sleep between calls
+class JobSystem
+{
+  public:
+	JobSystem(unsigned int a_threads_count = std::max(1u, std::thread::hardware_concurrency())) :
+		m_threads_count(std::max(1u, a_threads_count)), m_ranges(m_threads_count)
+	{
+		for (unsigned int i = 1; i < this->m_threads_count; ++i)
+			this->m_workers.emplace_back(&JobSystem::worker, this, i);
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			this->m_exit = true;
+		}
+
+		this->m_start.notify_all();
+
+		for (auto &worker : this->m_workers)
+			worker.join();
+	}
+
+	JobSystem(const JobSystem &) = delete;
+	JobSystem &operator=(const JobSystem &) = delete;
+
+	unsigned int threads_count() const
+	{
+		return this->m_threads_count;
+	}
+
+	// Target duration of a chunk in nanoseconds, long enough to hide the cost of taking it
+	void set_chunk_duration(double a_nanoseconds)
+	{
+		this->m_chunk_duration = a_nanoseconds;
+	}
+
+	// Ranges stolen from other threads during the last parallel_for
+	unsigned int steals_count() const
+	{
+		unsigned int steals = 0;
+
+		for (auto &range : this->m_ranges)
+			steals += range.m_steals;
+
+		return steals;
+	}
+
+	// Calls a_function(first, last, thread) for chunks covering [0, a_count), thread is below threads_count() and is the same
+	// for all chunks running on one thread, so it can index per thread scratch. Chunks are multiples of a_granularity except
+	// the last one. The calling thread takes part and the call blocks until every chunk is done
+	template <typename _function>
+	void parallel_for(unsigned int a_count, _function &&a_function, unsigned int a_granularity = 1)
+	{
+		if (a_count == 0)
+			return;
+
+		this->m_context     = &a_function;
+		this->m_job         = [](void *a_context, unsigned int a_first, unsigned int a_last, unsigned int a_thread) { (*static_cast<_function *>(a_context))(a_first, a_last, a_thread); };
+		this->m_granularity = std::max(1u, a_granularity);
+
+		// Even split rounded to the granularity, later threads get nothing if there aren't enough chunks to go around
+		unsigned int chunks_count = (a_count + this->m_granularity - 1) / this->m_granularity;
+
+		for (unsigned int i = 0; i < this->m_threads_count; ++i)
+		{
+			Range &range = this->m_ranges[i];
+
+			range.m_begin  = std::min(static_cast<unsigned int>(static_cast<uint64_t>(chunks_count) * i / this->m_threads_count) * this->m_granularity, a_count);
+			range.m_end    = std::min(static_cast<unsigned int>(static_cast<uint64_t>(chunks_count) * (i + 1) / this->m_threads_count) * this->m_granularity, a_count);
+			range.m_steals = 0;
+		}
+
+		if (this->m_threads_count > 1)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->m_mutex);
+				this->m_pending = this->m_threads_count - 1;
+				++this->m_generation;
+			}
+
+			this->m_start.notify_all();
+		}
+
+		this->run(0);
+
+		if (this->m_threads_count > 1)
+		{
+			std::unique_lock<std::mutex> lock(this->m_mutex);
+			this->m_done.wait(lock, [this]() { return this->m_pending == 0; });
+		}
+	}
+
+  private:
+	// Indices [m_begin, m_end) not taken yet, the owner takes from the front and thieves from the back
+	// Aligned to a cache line so threads working on their own ranges don't share lines
+	struct alignas(64) Range
+	{
+		std::mutex   m_mutex;
+		unsigned int m_begin  = 0;
+		unsigned int m_end    = 0;
+		unsigned int m_steals = 0;
+	};
+
+	// Takes up to a_size indices off the front of the own range
+	bool take(unsigned int a_thread, unsigned int a_size, unsigned int &a_first, unsigned int &a_last)
+	{
+		Range &range = this->m_ranges[a_thread];
+
+		std::lock_guard<std::mutex> lock(range.m_mutex);
+
+		if (range.m_begin == range.m_end)
+			return false;
+
+		a_first       = range.m_begin;
+		a_last        = std::min(range.m_end, range.m_begin + a_size);
+		range.m_begin = a_last;
+
+		return true;
+	}
+
+	// Moves the back half of the first non empty range after a_thread's into a_thread's own range
+	bool steal(unsigned int a_thread)
+	{
+		for (unsigned int i = 1; i < this->m_threads_count; ++i)
+		{
+			Range &victim = this->m_ranges[(a_thread + i) % this->m_threads_count];
+
+			unsigned int first, last;
+
+			{
+				std::lock_guard<std::mutex> lock(victim.m_mutex);
+
+				if (victim.m_begin == victim.m_end)
+					continue;
+
+				// Split on a chunk boundary, a last lone chunk is taken whole
+				unsigned int chunks = (victim.m_end - victim.m_begin + this->m_granularity - 1) / this->m_granularity;
+
+				first        = victim.m_begin + chunks / 2 * this->m_granularity;
+				last         = victim.m_end;
+				victim.m_end = first;
+			}
+
+			Range &range = this->m_ranges[a_thread];
+
+			std::lock_guard<std::mutex> lock(range.m_mutex);
+			range.m_begin = first;
+			range.m_end   = last;
+			++range.m_steals;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	// Indices that take about m_chunk_duration at a_cost nanoseconds each, in whole granules
+	unsigned int chunk_size(double a_cost) const
+	{
+		if (a_cost <= 0.0)
+			return this->m_granularity;
+
+		double granules = std::min(std::max(this->m_chunk_duration / (a_cost * this->m_granularity), 1.0), 1e6);
+
+		return static_cast<unsigned int>(granules) * this->m_granularity;
+	}
+
+	void run(unsigned int a_thread)
+	{
+		// Nanoseconds per index measured on this thread, the first chunk is a single granule to measure it
+		double       cost  = 0.0;
+		unsigned int first = 0, last = 0;
+
+		do
+		{
+			unsigned int size = this->chunk_size(cost);
+
+			while (this->take(a_thread, size, first, last))
+			{
+				auto start = std::chrono::steady_clock::now();
+
+				this->m_job(this->m_context, first, last, a_thread);
+
+				double duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				cost            = duration / (last - first);
+				size            = this->chunk_size(cost);
+			}
+		} while (this->steal(a_thread));
+	}
+
+	void worker(unsigned int a_index)
+	{
+		unsigned int generation = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->m_mutex);
+				this->m_start.wait(lock, [this, generation]() { return this->m_exit || this->m_generation != generation; });
+
+				if (this->m_exit)
+					return;
+
+				generation = this->m_generation;
+			}
+
+			this->run(a_index);
+
+			{
+				std::lock_guard<std::mutex> lock(this->m_mutex);
+				if (--this->m_pending == 0)
+					this->m_done.notify_one();
+			}
+		}
+	}
+
+	unsigned int             m_threads_count;
+	std::vector<Range>       m_ranges;        // One per thread, the calling thread is 0
+	std::vector<std::thread> m_workers;
+
+	void (*m_job)(void *, unsigned int, unsigned int, unsigned int) = nullptr;
+	void *       m_context                                          = nullptr;
+	unsigned int m_granularity                                      = 1;
+	double       m_chunk_duration                                   = 20000.0;
+
+	std::mutex              m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	unsigned int            m_generation = 0;
+	unsigned int            m_pending    = 0;
+	bool                    m_exit       = false;
+};
@@ -0,0 +1,238 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_clip.hpp"
+#include "simd_kernels.hpp"
+#include "skeletal_animation.hpp"
+#include "skeleton.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Final skinning palettes of a clip sampled at a fixed rate, world times inverse bind of every joint, frame after frame
+// Only valid for characters playing the clip on its own, blends and lods need the full evaluation
+class BakedClip
+{
+  public:
+	BakedClip(){};
+
+	BakedClip(const Skeleton &a_skeleton, const AnimationClip &a_clip, float a_rate) :
+		m_joints_count(a_skeleton.joints_count()), m_rate(a_rate), m_loop_mode(a_clip.loop_mode())
+	{
+		assert(a_rate > 0.0f && "Bake rate must be positive");
+
+		// Looping clips don't bake the end of the cycle, sampling wraps back to frame 0 instead
+		if (this->m_loop_mode == LoopMode::loop)
+			this->m_frames_count = std::max(static_cast<unsigned int>(std::round(a_clip.loop_duration() * a_rate)), 1u);
+		else
+			this->m_frames_count = static_cast<unsigned int>(std::ceil(a_clip.duration() * a_rate)) + 1;
+
+		this->m_duration = this->m_loop_mode == LoopMode::loop ? a_clip.loop_duration() : a_clip.duration();
+		this->m_palettes.resize(this->m_frames_count * this->m_joints_count);
+
+		AnimationPlayer        player(&a_clip);
+		std::vector<Transform> world_transforms;
+		std::vector<Matrix3x4> palette;
+
+		for (unsigned int f = 0; f < this->m_frames_count; ++f)
+		{
+			// Loop cycles don't always fit a whole number of frames, stretch them slightly so frame 0 follows the last one
+			player.seek(std::min(static_cast<float>(f) * this->m_duration / this->frame_span(), this->m_duration));
+
+			evaluate_world_transforms(a_skeleton, player, world_transforms);
+			get_joint_matrices(a_skeleton, world_transforms, palette);
+
+			std::copy(palette.begin(), palette.end(), this->m_palettes.begin() + f * this->m_joints_count);
+		}
+	}
+
+	unsigned int frames_count() const
+	{
+		return this->m_frames_count;
+	}
+
+	unsigned int joints_count() const
+	{
+		return this->m_joints_count;
+	}
+
+	float rate() const
+	{
+		return this->m_rate;
+	}
+
+	// Loop duration of looping clips
+	float duration() const
+	{
+		return this->m_duration;
+	}
+
+	LoopMode loop_mode() const
+	{
+		return this->m_loop_mode;
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_palettes.size() * sizeof(Matrix3x4);
+	}
+
+	// Palette of the frame a_frame, joints_count() matrices
+	const Matrix3x4 *frame(unsigned int a_frame) const
+	{
+		return this->m_palettes.data() + a_frame * this->m_joints_count;
+	}
+
+	// Writes joints_count() matrices for clip time a_time into a_palette, a lerp between the two closest frames
+	void sample(float a_time, Matrix3x4 *a_palette) const
+	{
+		float        position = std::min(std::max(a_time, 0.0f), this->m_duration) / this->m_duration * this->frame_span();
+		unsigned int from     = std::min(static_cast<unsigned int>(position), this->m_frames_count - 1);
+		unsigned int to       = from + 1;
+
+		if (to == this->m_frames_count)
+			to = this->m_loop_mode == LoopMode::loop ? 0 : from;
+
+		simd_kernels().m_interpolate_batch(this->frame(from)->m_values, this->frame(to)->m_values, position - static_cast<float>(from), a_palette->m_values,
+										   this->m_joints_count * 12);
+	}
+
+  private:
+	// Frame intervals covering the clip, a looping clip has one more to wrap around with
+	float frame_span() const
+	{
+		return static_cast<float>(this->m_loop_mode == LoopMode::loop ? this->m_frames_count : this->m_frames_count - 1);
+	}
+
+	std::vector<Matrix3x4> m_palettes;        // m_frames_count * m_joints_count
+	unsigned int           m_frames_count = 0;
+	unsigned int           m_joints_count = 0;
+	float                  m_rate         = 0.0f;
+	float                  m_duration     = 0.0f;
+	LoopMode               m_loop_mode    = LoopMode::loop;
+};
+
+// Baked clips of one skeleton within a memory budget, clips are baked on first use and the least recently used ones are evicted
+// A clip bigger than the whole budget is still baked but evicts everything else
+class PaletteCache
+{
+  public:
+	PaletteCache(const Skeleton &a_skeleton, size_t a_budget_bytes, float a_rate = 30.0f) :
+		m_skeleton(&a_skeleton), m_budget(a_budget_bytes), m_rate(a_rate)
+	{}
+
+	// Palette of a_player at its current time, joints_count() matrices
+	void sample(const AnimationPlayer &a_player, Matrix3x4 *a_palette)
+	{
+		this->get(a_player.clip()).sample(a_player.time(), a_palette);
+	}
+
+	// Baked a_clip, baking it now if it isn't cached. The reference is valid until the clip is evicted by another get()
+	const BakedClip &get(const AnimationClip *a_clip)
+	{
+		auto found = this->m_lookup.find(a_clip);
+
+		if (found != this->m_lookup.end())
+		{
+			// Most recently used go to the front
+			this->m_clips.splice(this->m_clips.begin(), this->m_clips, found->second);
+			return found->second->second;
+		}
+
+		BakedClip baked(*this->m_skeleton, *a_clip, this->m_rate);
+
+		while (!this->m_clips.empty() && this->m_size + baked.size_in_bytes() > this->m_budget)
+		{
+			this->m_size -= this->m_clips.back().second.size_in_bytes();
+			this->m_lookup.erase(this->m_clips.back().first);
+			this->m_clips.pop_back();
+			++this->m_evictions_count;
+		}
+
+		this->m_size += baked.size_in_bytes();
+		this->m_clips.emplace_front(a_clip, std::move(baked));
+		this->m_lookup[a_clip] = this->m_clips.begin();
+		++this->m_bakes_count;
+
+		return this->m_clips.front().second;
+	}
+
+	// Drops a_clip if it's cached, needed before a clip is destroyed or changed
+	void evict(const AnimationClip *a_clip)
+	{
+		auto found = this->m_lookup.find(a_clip);
+
+		if (found != this->m_lookup.end())
+		{
+			this->m_size -= found->second->second.size_in_bytes();
+			this->m_clips.erase(found->second);
+			this->m_lookup.erase(found);
+		}
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_size;
+	}
+
+	size_t budget() const
+	{
+		return this->m_budget;
+	}
+
+	unsigned int clips_count() const
+	{
+		return static_cast<unsigned int>(this->m_clips.size());
+	}
+
+	unsigned int bakes_count() const
+	{
+		return this->m_bakes_count;
+	}
+
+	unsigned int evictions_count() const
+	{
+		return this->m_evictions_count;
+	}
+
+  private:
+	typedef std::list<std::pair<const AnimationClip *, BakedClip>> Clips;
+
+	const Skeleton *                                           m_skeleton = nullptr;
+	Clips                                                      m_clips;        // Most recently used first
+	std::unordered_map<const AnimationClip *, Clips::iterator> m_lookup;
+	size_t                                                     m_budget          = 0;
+	size_t                                                     m_size            = 0;
+	float                                                      m_rate            = 30.0f;
+	unsigned int                                               m_bakes_count     = 0;
+	unsigned int                                               m_evictions_count = 0;
+};
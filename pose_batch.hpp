@@ -0,0 +1,373 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_clip.hpp"
+#include "animation_track.hpp"
+#include "skeleton.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE__)
+#	include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#	include <arm_neon.h>
+#endif
+
+// SIMD register types for PoseBatch lanes, GCC doesn't allow vector_size to depend on a template parameter
+template <unsigned int _lanes>
+struct PoseBatchLane;
+
+template <>
+struct PoseBatchLane<4>
+{
+	typedef float    type __attribute__((vector_size(16)));
+	typedef uint32_t bits __attribute__((vector_size(16)));
+	typedef uint16_t half __attribute__((vector_size(8)));
+};
+
+template <>
+struct PoseBatchLane<8>
+{
+	typedef float    type __attribute__((vector_size(32)));
+	typedef uint32_t bits __attribute__((vector_size(32)));
+	typedef uint16_t half __attribute__((vector_size(16)));
+};
+
+// Widest batch that pays off on the target. Without AVX the compiler splits 8 lanes into two SSE halves which is slower than 4,
+// with AVX 8 lanes are about a quarter faster. 16 lanes were never faster than 8, even with AVX-512
+#if defined(__AVX__)
+const unsigned int pose_batch_lanes = 8;
+#else
+const unsigned int pose_batch_lanes = 4;
+#endif
+
+// Square root of every lane in place with the target's vector instruction, std::sqrt of each lane stays scalar because it might set errno
+inline void lane_sqrt(PoseBatchLane<4>::type &a_value)
+{
+#if defined(__SSE__)
+	a_value = reinterpret_cast<PoseBatchLane<4>::type>(_mm_sqrt_ps(reinterpret_cast<__m128>(a_value)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	a_value = reinterpret_cast<PoseBatchLane<4>::type>(vsqrtq_f32(reinterpret_cast<float32x4_t>(a_value)));
+#else
+	for (unsigned int l = 0; l < 4; ++l)
+		a_value[l] = std::sqrt(a_value[l]);
+#endif
+}
+
+// Without AVX as two halves, same as the compiler splits the rest of the 8 lane math
+inline void lane_sqrt(PoseBatchLane<8>::type &a_value)
+{
+#if defined(__AVX__)
+	a_value = reinterpret_cast<PoseBatchLane<8>::type>(_mm256_sqrt_ps(reinterpret_cast<__m256>(a_value)));
+#else
+	PoseBatchLane<4>::type halves[2];
+	std::memcpy(halves, &a_value, sizeof(halves));
+
+	lane_sqrt(halves[0]);
+	lane_sqrt(halves[1]);
+
+	std::memcpy(&a_value, halves, sizeof(halves));
+#endif
+}
+
+// QVV transforms of _lanes characters or nodes, one per SIMD lane, with the same math as the scalar transform functions
+template <unsigned int _lanes>
+struct TransformLanes
+{
+	typedef typename PoseBatchLane<_lanes>::type Lane;
+	typedef typename PoseBatchLane<_lanes>::bits LaneBits;
+
+	Lane m_qx, m_qy, m_qz, m_qw;
+	Lane m_tx, m_ty, m_tz;
+	Lane m_sx, m_sy, m_sz;
+
+	static void store(TransformLanes &a_lanes, unsigned int a_lane, const Quaternion &a_rotation, const ror::Vector3f &a_translation, const ror::Vector3f &a_scale)
+	{
+		a_lanes.m_qx[a_lane] = a_rotation.x;
+		a_lanes.m_qy[a_lane] = a_rotation.y;
+		a_lanes.m_qz[a_lane] = a_rotation.z;
+		a_lanes.m_qw[a_lane] = a_rotation.w;
+		a_lanes.m_tx[a_lane] = a_translation.x;
+		a_lanes.m_ty[a_lane] = a_translation.y;
+		a_lanes.m_tz[a_lane] = a_translation.z;
+		a_lanes.m_sx[a_lane] = a_scale.x;
+		a_lanes.m_sy[a_lane] = a_scale.y;
+		a_lanes.m_sz[a_lane] = a_scale.z;
+	}
+
+	static void broadcast(const Transform &a_transform, TransformLanes &a_lanes)
+	{
+		a_lanes.m_qx = Lane{} + a_transform.m_rotation.x;
+		a_lanes.m_qy = Lane{} + a_transform.m_rotation.y;
+		a_lanes.m_qz = Lane{} + a_transform.m_rotation.z;
+		a_lanes.m_qw = Lane{} + a_transform.m_rotation.w;
+		a_lanes.m_tx = Lane{} + a_transform.m_translation.x;
+		a_lanes.m_ty = Lane{} + a_transform.m_translation.y;
+		a_lanes.m_tz = Lane{} + a_transform.m_translation.z;
+		a_lanes.m_sx = Lane{} + a_transform.m_scale.x;
+		a_lanes.m_sy = Lane{} + a_transform.m_scale.y;
+		a_lanes.m_sz = Lane{} + a_transform.m_scale.z;
+	}
+
+	// Same math as TrackTable::sample for all lanes
+	static void interpolate(const TransformLanes &a_from, const TransformLanes &a_to, const Lane &a_t, TransformLanes &a_out)
+	{
+		Lane dot = a_from.m_qx * a_to.m_qx + a_from.m_qy * a_to.m_qy + a_from.m_qz * a_to.m_qz + a_from.m_qw * a_to.m_qw;
+
+		// Shortest path, flip the sign of t wherever dot is negative
+		LaneBits sign_mask = LaneBits{} + 0x80000000u;
+		Lane     s         = 1.0f - a_t;
+		Lane     t         = reinterpret_cast<Lane>(reinterpret_cast<LaneBits>(a_t) ^ (reinterpret_cast<LaneBits>(dot) & sign_mask));
+
+		Lane x = a_from.m_qx * s + a_to.m_qx * t;
+		Lane y = a_from.m_qy * s + a_to.m_qy * t;
+		Lane z = a_from.m_qz * s + a_to.m_qz * t;
+		Lane w = a_from.m_qw * s + a_to.m_qw * t;
+
+		Lane inverse = x * x + y * y + z * z + w * w;
+		lane_sqrt(inverse);
+		inverse = 1.0f / inverse;
+
+		a_out.m_qx = x * inverse;
+		a_out.m_qy = y * inverse;
+		a_out.m_qz = z * inverse;
+		a_out.m_qw = w * inverse;
+
+		a_out.m_tx = a_from.m_tx + (a_to.m_tx - a_from.m_tx) * a_t;
+		a_out.m_ty = a_from.m_ty + (a_to.m_ty - a_from.m_ty) * a_t;
+		a_out.m_tz = a_from.m_tz + (a_to.m_tz - a_from.m_tz) * a_t;
+		a_out.m_sx = a_from.m_sx + (a_to.m_sx - a_from.m_sx) * a_t;
+		a_out.m_sy = a_from.m_sy + (a_to.m_sy - a_from.m_sy) * a_t;
+		a_out.m_sz = a_from.m_sz + (a_to.m_sz - a_from.m_sz) * a_t;
+	}
+
+	// Same math as transform_multiply for all lanes
+	static void multiply(const TransformLanes &a_parent, const TransformLanes &a_child, TransformLanes &a_out)
+	{
+		const Lane &px = a_parent.m_qx, &py = a_parent.m_qy, &pz = a_parent.m_qz, &pw = a_parent.m_qw;
+
+		// Rotate parent scaled child translation by parent rotation
+		Lane vx = a_child.m_tx * a_parent.m_sx;
+		Lane vy = a_child.m_ty * a_parent.m_sy;
+		Lane vz = a_child.m_tz * a_parent.m_sz;
+
+		Lane rx = 2.0f * (py * vz - pz * vy);
+		Lane ry = 2.0f * (pz * vx - px * vz);
+		Lane rz = 2.0f * (px * vy - py * vx);
+
+		TransformLanes out;
+
+		out.m_tx = a_parent.m_tx + vx + pw * rx + (py * rz - pz * ry);
+		out.m_ty = a_parent.m_ty + vy + pw * ry + (pz * rx - px * rz);
+		out.m_tz = a_parent.m_tz + vz + pw * rz + (px * ry - py * rx);
+
+		out.m_qx = pw * a_child.m_qx + px * a_child.m_qw + py * a_child.m_qz - pz * a_child.m_qy;
+		out.m_qy = pw * a_child.m_qy - px * a_child.m_qz + py * a_child.m_qw + pz * a_child.m_qx;
+		out.m_qz = pw * a_child.m_qz + px * a_child.m_qy - py * a_child.m_qx + pz * a_child.m_qw;
+		out.m_qw = pw * a_child.m_qw - px * a_child.m_qx - py * a_child.m_qy - pz * a_child.m_qz;
+
+		out.m_sx = a_parent.m_sx * a_child.m_sx;
+		out.m_sy = a_parent.m_sy * a_child.m_sy;
+		out.m_sz = a_parent.m_sz * a_child.m_sz;
+
+		a_out = out;
+	}
+};
+
+// Evaluates many characters sharing a skeleton together, _lanes characters at a time
+// Each joint is processed for all characters of a group at once with characters interleaved in structure of arrays form,
+// so every SIMD lane is one character. Lanes use GCC/Clang vector extensions which map to SSE/AVX/NEON registers
+template <unsigned int _lanes>
+class PoseBatch
+{
+  public:
+	PoseBatch(const Skeleton &a_skeleton) :
+		m_skeleton(&a_skeleton), m_world(a_skeleton.size())
+	{}
+
+	// Writes out joints_count() palette matrices for each instance one after the other in a_palettes
+	// Palettes can be ror::Matrix4f or affine Matrix3x4, cursors of the instances are updated, nothing is allocated
+	template <typename _palette>
+	void evaluate(AnimationPlayer *a_instances, unsigned int a_instances_count, _palette *a_palettes)
+	{
+		unsigned int joints_count = this->m_skeleton->joints_count();
+
+		for (unsigned int first = 0; first < a_instances_count; first += _lanes)
+			this->evaluate_group(a_instances + first, std::min(_lanes, a_instances_count - first), a_palettes + first * joints_count);
+	}
+
+  private:
+	typedef TransformLanes<_lanes> Lanes;
+	typedef typename Lanes::Lane   Lane;
+
+	// a_palette is affine column-major, 3 rows per column
+	static void scatter(const Lane *a_palette, unsigned int a_lane, ror::Matrix4f &a_out)
+	{
+		float *out = a_out.m_values;
+
+		for (unsigned int c = 0; c < 4; ++c)
+		{
+			out[c * 4 + 0] = a_palette[c * 3 + 0][a_lane];
+			out[c * 4 + 1] = a_palette[c * 3 + 1][a_lane];
+			out[c * 4 + 2] = a_palette[c * 3 + 2][a_lane];
+			out[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+		}
+	}
+
+	static void scatter(const Lane *a_palette, unsigned int a_lane, Matrix3x4 &a_out)
+	{
+		float *out = a_out.m_values;
+
+		for (unsigned int r = 0; r < 3; ++r)
+			for (unsigned int c = 0; c < 4; ++c)
+				out[r * 4 + c] = a_palette[c * 3 + r][a_lane];
+	}
+
+	// Converts world transforms of all lanes to matrices, multiplies with the inverse bind and scatters into each lane's palette
+	template <typename _palette>
+	static void write_palette(const Lanes &a_world, const ror::Matrix4f &a_inverse_bind, unsigned int a_lanes_count, _palette *a_palettes, unsigned int a_stride)
+	{
+		const Lane &x = a_world.m_qx, &y = a_world.m_qy, &z = a_world.m_qz, &w = a_world.m_qw;
+
+		// Affine column-major, 3 rows per column
+		Lane matrix[12];
+
+		matrix[0]  = (1.0f - 2.0f * (y * y + z * z)) * a_world.m_sx;
+		matrix[1]  = (2.0f * (x * y + w * z)) * a_world.m_sx;
+		matrix[2]  = (2.0f * (x * z - w * y)) * a_world.m_sx;
+		matrix[3]  = (2.0f * (x * y - w * z)) * a_world.m_sy;
+		matrix[4]  = (1.0f - 2.0f * (x * x + z * z)) * a_world.m_sy;
+		matrix[5]  = (2.0f * (y * z + w * x)) * a_world.m_sy;
+		matrix[6]  = (2.0f * (x * z + w * y)) * a_world.m_sz;
+		matrix[7]  = (2.0f * (y * z - w * x)) * a_world.m_sz;
+		matrix[8]  = (1.0f - 2.0f * (x * x + y * y)) * a_world.m_sz;
+		matrix[9]  = a_world.m_tx;
+		matrix[10] = a_world.m_ty;
+		matrix[11] = a_world.m_tz;
+
+		const float *inverse = a_inverse_bind.m_values;
+		Lane         palette[12];
+
+		for (unsigned int c = 0; c < 4; ++c)
+			for (unsigned int r = 0; r < 3; ++r)
+				palette[c * 3 + r] = matrix[r] * inverse[c * 4] + matrix[3 + r] * inverse[c * 4 + 1] + matrix[6 + r] * inverse[c * 4 + 2] +
+									 (c == 3 ? matrix[9 + r] : Lane{});
+
+		for (unsigned int l = 0; l < a_lanes_count; ++l)
+			scatter(palette, l, a_palettes[l * a_stride]);
+	}
+
+	template <typename _palette>
+	void evaluate_group(AnimationPlayer *a_instances, unsigned int a_instances_count, _palette *a_palettes)
+	{
+		const Skeleton &skeleton     = *this->m_skeleton;
+		unsigned int    joints_count = skeleton.joints_count();
+
+		const TrackTable *tracks[_lanes];
+		unsigned int      from_keys[_lanes];        // First index of the previous keyframe in the key major arrays
+		unsigned int      to_keys[_lanes];          // First index of the next keyframe, keyframe 0 when a looping clip wraps around
+		Lane              fractions;
+		bool              same_tracks = true;
+
+		// Unused lanes repeat the last instance so the lane math doesn't need masking
+		for (unsigned int l = 0; l < _lanes; ++l)
+		{
+			if (l < a_instances_count)
+			{
+				KeyframeSpan span = a_instances[l].sample();
+
+				tracks[l]    = &a_instances[l].clip()->tracks();
+				from_keys[l] = span.m_from * tracks[l]->tracks_count();
+				to_keys[l]   = span.m_to * tracks[l]->tracks_count();
+				fractions[l] = span.m_t;
+			}
+			else
+			{
+				tracks[l]    = tracks[l - 1];
+				from_keys[l] = from_keys[l - 1];
+				to_keys[l]   = to_keys[l - 1];
+				fractions[l] = fractions[l - 1];
+			}
+
+			same_tracks = same_tracks && tracks[l] == tracks[0];
+		}
+
+		Lanes from, to;
+
+		for (unsigned int i = 0, joint = 0; i < skeleton.size(); ++i)
+		{
+			// Usually the whole group plays the same clip, so the track lookup is shared
+			int   shared_track = tracks[0]->track(i);
+			Lanes &world       = this->m_world[i];
+
+			if (same_tracks && shared_track == -1)
+				Lanes::broadcast(skeleton.local_bind(i), world);        // Not animated, no need to gather or interpolate
+			else
+			{
+				for (unsigned int l = 0; l < _lanes; ++l)
+				{
+					const TrackTable &table = *tracks[l];
+					int               track = same_tracks ? shared_track : table.track(i);
+
+					if (track == -1)
+					{
+						const Transform &rest = skeleton.local_bind(i);
+						Lanes::store(from, l, rest.m_rotation, rest.m_translation, rest.m_scale);
+						Lanes::store(to, l, rest.m_rotation, rest.m_translation, rest.m_scale);
+					}
+					else
+					{
+						unsigned int index = from_keys[l] + static_cast<unsigned int>(track);
+						unsigned int next  = to_keys[l] + static_cast<unsigned int>(track);
+
+						Lanes::store(from, l, table.rotations()[index], table.translations()[index], table.scales()[index]);
+						Lanes::store(to, l, table.rotations()[next], table.translations()[next], table.scales()[next]);
+					}
+				}
+
+				Lanes::interpolate(from, to, fractions, world);
+			}
+
+			int parent = skeleton.parent(i);
+
+			if (parent != -1)
+				Lanes::multiply(this->m_world[static_cast<unsigned int>(parent)], world, world);
+
+			if (skeleton.is_joint(i))
+			{
+				write_palette(world, skeleton.joint_inverse_bind(joint), a_instances_count, a_palettes + joint, joints_count);
+				++joint;
+			}
+		}
+	}
+
+	const Skeleton *   m_skeleton;
+	std::vector<Lanes> m_world;        // World transforms of the current group, one per node
+};
@@ -0,0 +1,390 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_clip.hpp"
+#include "animation_track.hpp"
+#include "pose_batch.hpp"
+#include "skeleton.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Arrays of LocalPose and JointMask are padded to a multiple of the widest blend so groups never need a scalar tail
+constexpr unsigned int pose_padding = 16;
+
+// Local space transforms of all nodes of a skeleton in structure of arrays form, one padded array per QVV component
+// Padding nodes hold the identity transform
+class LocalPose
+{
+  public:
+	enum Component
+	{
+		qx,
+		qy,
+		qz,
+		qw,
+		tx,
+		ty,
+		tz,
+		sx,
+		sy,
+		sz,
+		components_count
+	};
+
+	LocalPose(){};
+
+	// Rest pose of a_skeleton
+	explicit LocalPose(const Skeleton &a_skeleton)
+	{
+		this->resize(a_skeleton.size());
+
+		for (unsigned int i = 0; i < a_skeleton.size(); ++i)
+			this->set(i, a_skeleton.local_bind(i));
+	}
+
+	void resize(unsigned int a_nodes_count)
+	{
+		this->m_size   = a_nodes_count;
+		this->m_stride = (a_nodes_count + pose_padding - 1) / pose_padding * pose_padding;
+		this->m_values.assign(this->m_stride * components_count, 0.0f);
+
+		for (auto component : {qw, sx, sy, sz})
+			std::fill_n(this->m_values.begin() + component * this->m_stride, this->m_stride, 1.0f);
+	}
+
+	unsigned int size() const
+	{
+		return this->m_size;
+	}
+
+	// Padded size of each component array
+	unsigned int stride() const
+	{
+		return this->m_stride;
+	}
+
+	float *component(Component a_component)
+	{
+		return this->m_values.data() + a_component * this->m_stride;
+	}
+
+	const float *component(Component a_component) const
+	{
+		return this->m_values.data() + a_component * this->m_stride;
+	}
+
+	Transform get(unsigned int a_index) const
+	{
+		const float *v = this->m_values.data() + a_index;
+		unsigned int s = this->m_stride;
+
+		return Transform{Quaternion{v[qx * s], v[qy * s], v[qz * s], v[qw * s]},
+						 ror::Vector3f(v[tx * s], v[ty * s], v[tz * s]),
+						 ror::Vector3f(v[sx * s], v[sy * s], v[sz * s])};
+	}
+
+	void set(unsigned int a_index, const Transform &a_transform)
+	{
+		float *      v = this->m_values.data() + a_index;
+		unsigned int s = this->m_stride;
+
+		v[qx * s] = a_transform.m_rotation.x;
+		v[qy * s] = a_transform.m_rotation.y;
+		v[qz * s] = a_transform.m_rotation.z;
+		v[qw * s] = a_transform.m_rotation.w;
+		v[tx * s] = a_transform.m_translation.x;
+		v[ty * s] = a_transform.m_translation.y;
+		v[tz * s] = a_transform.m_translation.z;
+		v[sx * s] = a_transform.m_scale.x;
+		v[sy * s] = a_transform.m_scale.y;
+		v[sz * s] = a_transform.m_scale.z;
+	}
+
+  private:
+	unsigned int       m_size   = 0;
+	unsigned int       m_stride = 0;
+	std::vector<float> m_values;
+};
+
+// Per node blend weights of a layer, like 1 on the spine and everything under it for an upper body overlay
+class JointMask
+{
+  public:
+	JointMask(){};
+
+	JointMask(const Skeleton &a_skeleton, float a_weight = 0.0f) :
+		m_weights((a_skeleton.size() + pose_padding - 1) / pose_padding * pose_padding, 0.0f)
+	{
+		std::fill_n(this->m_weights.begin(), a_skeleton.size(), a_weight);
+	}
+
+	// Sets a_weight on a_node and all of its descendants, nodes are parent before child so one forward walk finds them all
+	void set_subtree(const Skeleton &a_skeleton, unsigned int a_node, float a_weight)
+	{
+		std::vector<bool> inside(a_skeleton.size(), false);
+
+		inside[a_node] = true;
+		for (unsigned int i = a_node; i < a_skeleton.size(); ++i)
+		{
+			int parent = a_skeleton.parent(i);
+
+			if (i == a_node || (parent != -1 && inside[static_cast<unsigned int>(parent)]))
+			{
+				inside[i]          = true;
+				this->m_weights[i] = a_weight;
+			}
+		}
+	}
+
+	void set(unsigned int a_node, float a_weight)
+	{
+		this->m_weights[a_node] = a_weight;
+	}
+
+	float weight(unsigned int a_node) const
+	{
+		return this->m_weights[a_node];
+	}
+
+	// Padded with zeros
+	const float *data() const
+	{
+		return this->m_weights.data();
+	}
+
+  private:
+	std::vector<float> m_weights;
+};
+
+enum class BlendMode
+{
+	override,        // Lerps the layer over the layers below it by its weight, crossfades are two override layers
+	additive         // Adds the difference between the layer and m_reference on top of the layers below it
+};
+
+// One clip in a blend, layers are applied in order on top of the rest pose
+typedef struct
+{
+	AnimationPlayer *m_player;
+	float            m_weight;
+	BlendMode        m_mode;
+	const JointMask *m_mask;             // nullptr to blend every node
+	const LocalPose *m_reference;        // Additive layers only, usually the first keyframe of the additive clip
+} BlendLayer;
+
+// Samples any number of clips into local poses and blends them into one in a single pass over the skeleton
+// Only animated nodes are sampled, into per layer structure of arrays poses that already hold the rest pose everywhere else.
+// The blend then runs _lanes nodes at a time on contiguous arrays, with all layers applied before anything is written back.
+// A 3 layer blend costs about 3 samples plus one hierarchy pass instead of 3 full evaluations
+template <unsigned int _lanes = pose_batch_lanes>
+class PoseBlender
+{
+  public:
+	PoseBlender(const Skeleton &a_skeleton, unsigned int a_layers_max = 4) :
+		m_skeleton(&a_skeleton), m_rest(a_skeleton), m_samples(a_layers_max, m_rest), m_sampled_tracks(a_layers_max, nullptr)
+	{}
+
+	unsigned int layers_max() const
+	{
+		return static_cast<unsigned int>(this->m_samples.size());
+	}
+
+	// a_pose must already be sized to the skeleton, nothing is allocated. Cursors of the layer players are updated
+	void blend(BlendLayer *a_layers, unsigned int a_layers_count, LocalPose &a_pose)
+	{
+		assert(a_layers_count <= this->layers_max() && "Too many blend layers");
+		assert(a_pose.size() == this->m_skeleton->size() && "Pose not sized for the skeleton");
+
+		for (unsigned int i = 0; i < a_layers_count; ++i)
+			if (a_layers[i].m_weight > 0.0f)
+				this->sample(*a_layers[i].m_player, i);
+
+		for (unsigned int first = 0; first < this->m_skeleton->size(); first += _lanes)
+		{
+			Lanes result;
+			load(this->m_rest, first, result);
+
+			for (unsigned int i = 0; i < a_layers_count; ++i)
+			{
+				const BlendLayer &layer = a_layers[i];
+
+				if (layer.m_weight <= 0.0f)
+					continue;
+
+				Lane weight = Lane{} + layer.m_weight;
+				if (layer.m_mask)
+				{
+					Lane mask;
+					std::memcpy(&mask, layer.m_mask->data() + first, sizeof(Lane));
+					weight *= mask;
+				}
+
+				Lanes sample;
+				load(this->m_samples[i], first, sample);
+
+				if (layer.m_mode == BlendMode::override)
+				{
+					if (full_weight(weight))
+						result = sample;        // Usually the base layer, no need to lerp with the rest pose
+					else
+						Lanes::interpolate(result, sample, weight, result);
+				}
+				else
+				{
+					assert(layer.m_reference && "Additive layers need a reference pose");
+
+					Lanes reference;
+					load(*layer.m_reference, first, reference);
+					add(result, sample, reference, weight, result);
+				}
+			}
+
+			store(result, first, a_pose);
+		}
+	}
+
+	// Single clip into a_pose, for creating additive reference poses
+	void sample(AnimationPlayer &a_player, LocalPose &a_pose)
+	{
+		BlendLayer layer{&a_player, 1.0f, BlendMode::override, nullptr, nullptr};
+		this->blend(&layer, 1, a_pose);
+	}
+
+  private:
+	typedef TransformLanes<_lanes>  Lanes;
+	typedef typename Lanes::Lane     Lane;
+	typedef typename Lanes::LaneBits LaneBits;
+
+	static void load(const LocalPose &a_pose, unsigned int a_first, Lanes &a_lanes)
+	{
+		Lane *lanes[LocalPose::components_count] = {&a_lanes.m_qx, &a_lanes.m_qy, &a_lanes.m_qz, &a_lanes.m_qw, &a_lanes.m_tx,
+													&a_lanes.m_ty, &a_lanes.m_tz, &a_lanes.m_sx, &a_lanes.m_sy, &a_lanes.m_sz};
+
+		for (unsigned int c = 0; c < LocalPose::components_count; ++c)
+			std::memcpy(lanes[c], a_pose.component(static_cast<LocalPose::Component>(c)) + a_first, sizeof(Lane));
+	}
+
+	static void store(const Lanes &a_lanes, unsigned int a_first, LocalPose &a_pose)
+	{
+		const Lane *lanes[LocalPose::components_count] = {&a_lanes.m_qx, &a_lanes.m_qy, &a_lanes.m_qz, &a_lanes.m_qw, &a_lanes.m_tx,
+														  &a_lanes.m_ty, &a_lanes.m_tz, &a_lanes.m_sx, &a_lanes.m_sy, &a_lanes.m_sz};
+
+		for (unsigned int c = 0; c < LocalPose::components_count; ++c)
+			std::memcpy(a_pose.component(static_cast<LocalPose::Component>(c)) + a_first, lanes[c], sizeof(Lane));
+	}
+
+	// Samples the animated nodes of a_player's clip into layer a_layer, the rest are left in the rest pose
+	// Gathering keyframes straight into lanes is slower, the narrow stores stall the wide loads that follow
+	void sample(AnimationPlayer &a_player, unsigned int a_layer)
+	{
+		const TrackTable &tracks = a_player.clip()->tracks();
+		LocalPose &       pose   = this->m_samples[a_layer];
+
+		// Nodes animated by the previous clip of this layer but not by this one need their rest pose back
+		if (this->m_sampled_tracks[a_layer] != &tracks)
+		{
+			pose                            = this->m_rest;
+			this->m_sampled_tracks[a_layer] = &tracks;
+		}
+
+		KeyframeSpan span = a_player.sample();
+
+		for (unsigned int i = 0; i < this->m_skeleton->size(); ++i)
+		{
+			int track = tracks.track(i);
+
+			if (track != -1)
+				pose.set(i, tracks.sample(track, span));
+		}
+	}
+
+	static bool full_weight(const Lane &a_weight)
+	{
+		for (unsigned int l = 0; l < _lanes; ++l)
+			if (a_weight[l] != 1.0f)
+				return false;
+
+		return true;
+	}
+
+	// a_base * (a_reference^-1 * a_layer)^a_weight, the rotation delta is nlerped from identity by the weight
+	static void add(const Lanes &a_base, const Lanes &a_layer, const Lanes &a_reference, const Lane &a_weight, Lanes &a_out)
+	{
+		// Conjugate of the reference times the layer rotation
+		const Lane &rx = a_reference.m_qx, &ry = a_reference.m_qy, &rz = a_reference.m_qz, &rw = a_reference.m_qw;
+
+		Lane dx = rw * a_layer.m_qx - rx * a_layer.m_qw - ry * a_layer.m_qz + rz * a_layer.m_qy;
+		Lane dy = rw * a_layer.m_qy + rx * a_layer.m_qz - ry * a_layer.m_qw - rz * a_layer.m_qx;
+		Lane dz = rw * a_layer.m_qz - rx * a_layer.m_qy + ry * a_layer.m_qx - rz * a_layer.m_qw;
+		Lane dw = rw * a_layer.m_qw + rx * a_layer.m_qx + ry * a_layer.m_qy + rz * a_layer.m_qz;
+
+		// Shortest path from identity, flip the sign of the weight wherever dw is negative
+		LaneBits sign_mask = LaneBits{} + 0x80000000u;
+		Lane     weight    = reinterpret_cast<Lane>(reinterpret_cast<LaneBits>(a_weight) ^ (reinterpret_cast<LaneBits>(dw) & sign_mask));
+
+		dx = dx * weight;
+		dy = dy * weight;
+		dz = dz * weight;
+		dw = dw * weight + (1.0f - a_weight);
+
+		Lane inverse = dx * dx + dy * dy + dz * dz + dw * dw;
+		lane_sqrt(inverse);
+		inverse = 1.0f / inverse;
+
+		dx *= inverse;
+		dy *= inverse;
+		dz *= inverse;
+		dw *= inverse;
+
+		const Lane &bx = a_base.m_qx, &by = a_base.m_qy, &bz = a_base.m_qz, &bw = a_base.m_qw;
+
+		Lanes out;
+
+		out.m_qx = bw * dx + bx * dw + by * dz - bz * dy;
+		out.m_qy = bw * dy - bx * dz + by * dw + bz * dx;
+		out.m_qz = bw * dz + bx * dy - by * dx + bz * dw;
+		out.m_qw = bw * dw - bx * dx - by * dy - bz * dz;
+
+		out.m_tx = a_base.m_tx + (a_layer.m_tx - a_reference.m_tx) * a_weight;
+		out.m_ty = a_base.m_ty + (a_layer.m_ty - a_reference.m_ty) * a_weight;
+		out.m_tz = a_base.m_tz + (a_layer.m_tz - a_reference.m_tz) * a_weight;
+
+		out.m_sx = a_base.m_sx * (1.0f + (a_layer.m_sx / a_reference.m_sx - 1.0f) * a_weight);
+		out.m_sy = a_base.m_sy * (1.0f + (a_layer.m_sy / a_reference.m_sy - 1.0f) * a_weight);
+		out.m_sz = a_base.m_sz * (1.0f + (a_layer.m_sz / a_reference.m_sz - 1.0f) * a_weight);
+
+		a_out = out;
+	}
+
+	const Skeleton *                m_skeleton;
+	LocalPose                       m_rest;                  // Padded rest pose, starting point of every blend
+	std::vector<LocalPose>          m_samples;               // One sampled pose per layer
+	std::vector<const TrackTable *> m_sampled_tracks;        // Clip last sampled into each layer
+};
@@ -0,0 +1,430 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_track.hpp"
+#include "pose_batch.hpp"
+#include "pose_blend.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Tracks of the quantized table are padded to a multiple of the widest decode
+constexpr unsigned int quantized_padding = 8;
+
+// Compressed storage of a TrackTable, created once at load time, sampled with the same KeyframeSpan
+// Rotations are smallest three, the largest component is dropped and rebuilt from the unit length, the other three are 15 bits each
+// in [-1/sqrt(2), 1/sqrt(2)] with the 2 bit index of the dropped one in their top bits, 48 bits per key
+// Translations and scales are 16 bits per component against the min/max of their track, constant ones aren't stored per key at all
+// Keys are key major like TrackTable with each component in its own array, so _lanes tracks decode from contiguous memory at once
+class QuantizedTrackTable
+{
+  public:
+	QuantizedTrackTable(){};
+
+	QuantizedTrackTable(const TrackTable &a_tracks, unsigned int a_nodes_count) :
+		m_node_tracks(a_nodes_count, -1), m_track_nodes(a_tracks.tracks_count()), m_tracks_count(a_tracks.tracks_count()),
+		m_keyframes_count(a_tracks.keyframes_count())
+	{
+		for (unsigned int i = 0; i < a_nodes_count; ++i)
+		{
+			int track = a_tracks.track(i);
+			if (track != -1)
+			{
+				this->m_node_tracks[i]                                = static_cast<int16_t>(track);
+				this->m_track_nodes[static_cast<unsigned int>(track)] = static_cast<uint16_t>(i);
+			}
+		}
+
+		this->m_stride = (this->m_tracks_count + quantized_padding - 1) / quantized_padding * quantized_padding;
+		this->m_rotations.assign(this->m_keyframes_count * 3 * this->m_stride, 0);
+
+		for (unsigned int k = 0; k < this->m_keyframes_count; ++k)
+			for (unsigned int t = 0; t < this->m_tracks_count; ++t)
+			{
+				uint16_t *rotation = this->m_rotations.data() + k * 3 * this->m_stride + t;
+				encode(a_tracks.keyframe(static_cast<int>(t), k).m_rotation, rotation[0], rotation[this->m_stride], rotation[2 * this->m_stride]);
+			}
+
+		// Padding lanes decode the identity
+		for (unsigned int k = 0; k < this->m_keyframes_count; ++k)
+			for (unsigned int t = this->m_tracks_count; t < this->m_stride; ++t)
+			{
+				uint16_t *rotation = this->m_rotations.data() + k * 3 * this->m_stride + t;
+				encode(quaternion_identity(), rotation[0], rotation[this->m_stride], rotation[2 * this->m_stride]);
+			}
+
+		this->m_translations.build(a_tracks, a_tracks.translations());
+		this->m_scales.build(a_tracks, a_tracks.scales());
+	}
+
+	// Returns -1 for nodes without animation
+	int track(unsigned int a_node) const
+	{
+		return this->m_node_tracks[a_node];
+	}
+
+	unsigned int tracks_count() const
+	{
+		return this->m_tracks_count;
+	}
+
+	unsigned int keyframes_count() const
+	{
+		return this->m_keyframes_count;
+	}
+
+	// Memory used by the keys, ranges and constants, node maps not included
+	size_t size_in_bytes() const
+	{
+		return this->m_rotations.size() * sizeof(uint16_t) + this->m_translations.size_in_bytes() + this->m_scales.size_in_bytes();
+	}
+
+	// Scalar decode of one track, same as TrackTable::sample with quantized keys
+	Transform sample(int a_track, const KeyframeSpan &a_span) const
+	{
+		assert(a_span.m_from < this->m_keyframes_count && a_span.m_to < this->m_keyframes_count);
+
+		unsigned int track = static_cast<unsigned int>(a_track);
+
+		return Transform{quaternion_nlerp(this->rotation(track, a_span.m_from), this->rotation(track, a_span.m_to), a_span.m_t),
+						 this->m_translations.sample(track, a_span),
+						 this->m_scales.sample(track, a_span)};
+	}
+
+	// Decodes and interpolates all tracks _lanes at a time into their nodes of a_pose, nodes without tracks are left as they are
+	template <unsigned int _lanes = pose_batch_lanes>
+	void sample(const KeyframeSpan &a_span, LocalPose &a_pose) const
+	{
+		static_assert(_lanes == 4 || _lanes == 8, "Tracks are padded for 4 or 8 lanes");
+		assert(a_span.m_from < this->m_keyframes_count && a_span.m_to < this->m_keyframes_count);
+
+		typedef typename PoseBatchLane<_lanes>::type Lane;
+		typedef typename PoseBatchLane<_lanes>::bits LaneBits;
+
+		float *qx = a_pose.component(LocalPose::qx), *qy = a_pose.component(LocalPose::qy);
+		float *qz = a_pose.component(LocalPose::qz), *qw = a_pose.component(LocalPose::qw);
+
+		const uint16_t *from = this->m_rotations.data() + a_span.m_from * 3 * this->m_stride;
+		const uint16_t *to   = this->m_rotations.data() + a_span.m_to * 3 * this->m_stride;
+
+		Lane     t         = Lane{} + a_span.m_t;
+		Lane     s         = 1.0f - t;
+		LaneBits sign_mask = LaneBits{} + 0x80000000u;
+
+		for (unsigned int first = 0; first < this->m_tracks_count; first += _lanes)
+		{
+			Lane x0, y0, z0, w0, x1, y1, z1, w1;
+
+			decode<_lanes>(from + first, this->m_stride, x0, y0, z0, w0);
+			decode<_lanes>(to + first, this->m_stride, x1, y1, z1, w1);
+
+			// Same nlerp as TransformLanes::interpolate, keys aren't hemisphere aligned after quantization so the sign of t is flipped per lane
+			Lane dot = x0 * x1 + y0 * y1 + z0 * z1 + w0 * w1;
+			Lane tt  = reinterpret_cast<Lane>(reinterpret_cast<LaneBits>(t) ^ (reinterpret_cast<LaneBits>(dot) & sign_mask));
+
+			Lane x = x0 * s + x1 * tt;
+			Lane y = y0 * s + y1 * tt;
+			Lane z = z0 * s + z1 * tt;
+			Lane w = w0 * s + w1 * tt;
+
+			Lane inverse = x * x + y * y + z * z + w * w;
+			lane_sqrt(inverse);
+			inverse = 1.0f / inverse;
+
+			x *= inverse;
+			y *= inverse;
+			z *= inverse;
+			w *= inverse;
+
+			unsigned int count = std::min(_lanes, this->m_tracks_count - first);
+			for (unsigned int l = 0; l < count; ++l)
+			{
+				unsigned int node = this->m_track_nodes[first + l];
+
+				qx[node] = x[l];
+				qy[node] = y[l];
+				qz[node] = z[l];
+				qw[node] = w[l];
+			}
+		}
+
+		this->m_translations.template sample<_lanes>(a_span, this->m_track_nodes, a_pose.component(LocalPose::tx), a_pose.component(LocalPose::ty),
+													   a_pose.component(LocalPose::tz));
+		this->m_scales.template sample<_lanes>(a_span, this->m_track_nodes, a_pose.component(LocalPose::sx), a_pose.component(LocalPose::sy),
+												 a_pose.component(LocalPose::sz));
+	}
+
+  private:
+	// Smallest three components are in [-1/sqrt(2), 1/sqrt(2)], mapped to [0, 32767]
+	static constexpr float rotation_range = 1.41421356f / 32767.0f;
+	static constexpr float rotation_min   = -0.70710678f;
+
+	static void encode(const Quaternion &a_rotation, uint16_t &a_first, uint16_t &a_second, uint16_t &a_third)
+	{
+		float q[4] = {a_rotation.x, a_rotation.y, a_rotation.z, a_rotation.w};
+
+		unsigned int largest = 0;
+		for (unsigned int i = 1; i < 4; ++i)
+			if (std::abs(q[i]) > std::abs(q[largest]))
+				largest = i;
+
+		// q and -q are the same rotation, make the dropped component positive so it can be rebuilt with a positive square root
+		float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint16_t packed[3];
+		for (unsigned int i = 0, j = 0; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+
+			float value = std::round((q[i] * sign - rotation_min) / rotation_range);
+			packed[j++] = static_cast<uint16_t>(std::min(std::max(value, 0.0f), 32767.0f));
+		}
+
+		a_first  = static_cast<uint16_t>(packed[0] | ((largest & 1u) << 15));
+		a_second = static_cast<uint16_t>(packed[1] | ((largest >> 1) << 15));
+		a_third  = packed[2];
+	}
+
+	Quaternion rotation(unsigned int a_track, unsigned int a_keyframe) const
+	{
+		const uint16_t *packed  = this->m_rotations.data() + a_keyframe * 3 * this->m_stride + a_track;
+		unsigned int    largest = (packed[0] >> 15) | ((packed[this->m_stride] >> 15) << 1);
+
+		float a = static_cast<float>(packed[0] & 0x7fff) * rotation_range + rotation_min;
+		float b = static_cast<float>(packed[this->m_stride] & 0x7fff) * rotation_range + rotation_min;
+		float c = static_cast<float>(packed[2 * this->m_stride]) * rotation_range + rotation_min;
+		float d = std::sqrt(std::max(1.0f - a * a - b * b - c * c, 0.0f));
+
+		switch (largest)
+		{
+			case 0:
+				return Quaternion{d, a, b, c};
+			case 1:
+				return Quaternion{a, d, b, c};
+			case 2:
+				return Quaternion{a, b, d, c};
+			default:
+				return Quaternion{a, b, c, d};
+		}
+	}
+
+	// Same as rotation() for _lanes tracks, a_packed points at the first component of the first track, a_stride apart
+	template <unsigned int _lanes>
+	static void decode(const uint16_t *a_packed, unsigned int a_stride, typename PoseBatchLane<_lanes>::type &a_x, typename PoseBatchLane<_lanes>::type &a_y,
+					   typename PoseBatchLane<_lanes>::type &a_z, typename PoseBatchLane<_lanes>::type &a_w)
+	{
+		typedef typename PoseBatchLane<_lanes>::type Lane;
+		typedef typename PoseBatchLane<_lanes>::bits LaneBits;
+		typedef typename PoseBatchLane<_lanes>::half LaneHalf;
+
+		LaneHalf first, second, third;
+		std::memcpy(&first, a_packed, sizeof(LaneHalf));
+		std::memcpy(&second, a_packed + a_stride, sizeof(LaneHalf));
+		std::memcpy(&third, a_packed + 2 * a_stride, sizeof(LaneHalf));
+
+		LaneBits p0 = __builtin_convertvector(first, LaneBits);
+		LaneBits p1 = __builtin_convertvector(second, LaneBits);
+		LaneBits p2 = __builtin_convertvector(third, LaneBits);
+
+		LaneBits largest = (p0 >> 15) | ((p1 >> 15) << 1);
+
+		Lane a = __builtin_convertvector(p0 & 0x7fffu, Lane) * rotation_range + rotation_min;
+		Lane b = __builtin_convertvector(p1 & 0x7fffu, Lane) * rotation_range + rotation_min;
+		Lane c = __builtin_convertvector(p2, Lane) * rotation_range + rotation_min;
+		Lane d = 1.0f - a * a - b * b - c * c;
+
+		d = d > 0.0f ? d : Lane{};
+		lane_sqrt(d);
+
+		a_x = largest == 0 ? d : a;
+		a_y = largest == 0 ? a : (largest == 1 ? d : b);
+		a_z = largest == 3 ? c : (largest == 2 ? d : b);
+		a_w = largest == 3 ? d : c;
+	}
+
+	// Translations or scales of all tracks, only tracks whose values change have keys
+	class Vector3Tracks
+	{
+	  public:
+		void build(const TrackTable &a_tracks, const ror::Vector3f *a_values)
+		{
+			unsigned int tracks_count    = a_tracks.tracks_count();
+			unsigned int keyframes_count = a_tracks.keyframes_count();
+
+			this->m_constants.resize(tracks_count);
+
+			std::vector<ror::Vector3f> minimums, maximums;
+
+			for (unsigned int t = 0; t < tracks_count; ++t)
+			{
+				ror::Vector3f minimum = a_values[t], maximum = a_values[t];
+
+				for (unsigned int k = 1; k < keyframes_count; ++k)
+				{
+					const ror::Vector3f &value = a_values[k * tracks_count + t];
+
+					minimum = ror::Vector3f(std::min(minimum.x, value.x), std::min(minimum.y, value.y), std::min(minimum.z, value.z));
+					maximum = ror::Vector3f(std::max(maximum.x, value.x), std::max(maximum.y, value.y), std::max(maximum.z, value.z));
+				}
+
+				this->m_constants[t] = a_values[t];
+
+				const float epsilon = 1e-5f;        // Same as the keyframe comparison of AnimationClip, below that its decomposition noise
+				if (maximum.x - minimum.x > epsilon || maximum.y - minimum.y > epsilon || maximum.z - minimum.z > epsilon)
+				{
+					this->m_tracks.push_back(static_cast<uint16_t>(t));
+					minimums.push_back(minimum);
+					maximums.push_back(maximum);
+				}
+			}
+
+			unsigned int count = static_cast<unsigned int>(this->m_tracks.size());
+
+			this->m_stride = (count + quantized_padding - 1) / quantized_padding * quantized_padding;
+			this->m_ranges.assign(6 * this->m_stride, 0.0f);
+			this->m_keys.assign(keyframes_count * 3 * this->m_stride, 0);
+
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				const float *minimum = &minimums[i].x, *maximum = &maximums[i].x;
+
+				for (unsigned int c = 0; c < 3; ++c)
+				{
+					float extent = maximum[c] - minimum[c];
+
+					this->m_ranges[c * this->m_stride + i]       = minimum[c];
+					this->m_ranges[(3 + c) * this->m_stride + i] = extent / 65535.0f;
+
+					for (unsigned int k = 0; k < keyframes_count; ++k)
+					{
+						float value = (&a_values[k * tracks_count + this->m_tracks[i]].x)[c];
+						float key   = extent > 0.0f ? std::round((value - minimum[c]) / extent * 65535.0f) : 0.0f;
+
+						this->m_keys[(k * 3 + c) * this->m_stride + i] = static_cast<uint16_t>(std::min(std::max(key, 0.0f), 65535.0f));
+					}
+				}
+			}
+
+			// Scalar sampling looks up a track's keys through this
+			this->m_track_keys.assign(tracks_count, -1);
+			for (unsigned int i = 0; i < count; ++i)
+				this->m_track_keys[this->m_tracks[i]] = static_cast<int16_t>(i);
+		}
+
+		size_t size_in_bytes() const
+		{
+			return this->m_keys.size() * sizeof(uint16_t) + this->m_ranges.size() * sizeof(float) + this->m_tracks.size() * sizeof(uint16_t) +
+				   this->m_constants.size() * sizeof(ror::Vector3f);
+		}
+
+		ror::Vector3f sample(unsigned int a_track, const KeyframeSpan &a_span) const
+		{
+			int index = this->m_track_keys[a_track];
+			if (index == -1)
+				return this->m_constants[a_track];
+
+			float value[3];
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				unsigned int i       = static_cast<unsigned int>(index);
+				float        minimum = this->m_ranges[c * this->m_stride + i];
+				float        scale   = this->m_ranges[(3 + c) * this->m_stride + i];
+				float        from    = minimum + static_cast<float>(this->m_keys[(a_span.m_from * 3 + c) * this->m_stride + i]) * scale;
+				float        to      = minimum + static_cast<float>(this->m_keys[(a_span.m_to * 3 + c) * this->m_stride + i]) * scale;
+
+				value[c] = from + (to - from) * a_span.m_t;
+			}
+
+			return ror::Vector3f(value[0], value[1], value[2]);
+		}
+
+		// Writes constants of all tracks then decodes the keyed ones _lanes at a time
+		template <unsigned int _lanes>
+		void sample(const KeyframeSpan &a_span, const std::vector<uint16_t> &a_track_nodes, float *a_x, float *a_y, float *a_z) const
+		{
+			typedef typename PoseBatchLane<_lanes>::type Lane;
+			typedef typename PoseBatchLane<_lanes>::bits LaneBits;
+			typedef typename PoseBatchLane<_lanes>::half LaneHalf;
+
+			for (unsigned int t = 0; t < this->m_constants.size(); ++t)
+			{
+				unsigned int node = a_track_nodes[t];
+
+				a_x[node] = this->m_constants[t].x;
+				a_y[node] = this->m_constants[t].y;
+				a_z[node] = this->m_constants[t].z;
+			}
+
+			float *out[3] = {a_x, a_y, a_z};
+			Lane   t      = Lane{} + a_span.m_t;
+
+			for (unsigned int first = 0; first < this->m_tracks.size(); first += _lanes)
+			{
+				unsigned int count = std::min(_lanes, static_cast<unsigned int>(this->m_tracks.size()) - first);
+
+				for (unsigned int c = 0; c < 3; ++c)
+				{
+					Lane     minimum, scale;
+					LaneHalf from, to;
+
+					std::memcpy(&minimum, this->m_ranges.data() + c * this->m_stride + first, sizeof(Lane));
+					std::memcpy(&scale, this->m_ranges.data() + (3 + c) * this->m_stride + first, sizeof(Lane));
+					std::memcpy(&from, this->m_keys.data() + (a_span.m_from * 3 + c) * this->m_stride + first, sizeof(LaneHalf));
+					std::memcpy(&to, this->m_keys.data() + (a_span.m_to * 3 + c) * this->m_stride + first, sizeof(LaneHalf));
+
+					Lane v0 = minimum + __builtin_convertvector(__builtin_convertvector(from, LaneBits), Lane) * scale;
+					Lane v1 = minimum + __builtin_convertvector(__builtin_convertvector(to, LaneBits), Lane) * scale;
+					Lane v  = v0 + (v1 - v0) * t;
+
+					for (unsigned int l = 0; l < count; ++l)
+						out[c][a_track_nodes[this->m_tracks[first + l]]] = v[l];
+				}
+			}
+		}
+
+	  private:
+		std::vector<ror::Vector3f> m_constants;         // Per track, first keyframe value, used by tracks without keys
+		std::vector<uint16_t>      m_tracks;            // Track of each keyed lane
+		std::vector<int16_t>       m_track_keys;        // Keyed lane of each track or -1
+		std::vector<float>         m_ranges;            // Minimum xyz then scale xyz, each m_stride long
+		std::vector<uint16_t>      m_keys;              // Keyframe major, x y z arrays of m_stride each per keyframe
+		unsigned int               m_stride = 0;
+	};
+
+	std::vector<int16_t>  m_node_tracks;        // Per node track index or -1
+	std::vector<uint16_t> m_track_nodes;        // Node of each track
+	std::vector<uint16_t> m_rotations;          // Keyframe major, 3 packed arrays of m_stride each per keyframe
+	Vector3Tracks         m_translations;
+	Vector3Tracks         m_scales;
+	unsigned int          m_tracks_count    = 0;
+	unsigned int          m_keyframes_count = 0;
+	unsigned int          m_stride          = 0;
+};
@@ -0,0 +1,782 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "transform.hpp"
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+
+// SIMD versions of the math used every frame by the animation code
+// All matrices are column-major float[16] same as ror::Matrix4f::m_values, outputs are allowed to alias inputs
+// The implementation is selected at runtime depending on what the CPU supports, scalar versions are always available
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define SIMD_KERNELS_X86
+#	include <immintrin.h>
+#elif defined(__aarch64__)
+#	define SIMD_KERNELS_NEON
+#	include <arm_neon.h>
+#endif
+
+enum class SimdLevel
+{
+	scalar,
+	sse4,
+	avx2,
+	neon
+};
+
+typedef struct
+{
+	SimdLevel   m_level;
+	const char *m_name;
+
+	// a_out = a_left * a_right
+	void (*m_matrix4_multiply)(const float *a_left, const float *a_right, float *a_out);
+
+	// Same as above but assumes both have 0, 0, 0, 1 as the last row
+	void (*m_matrix4_multiply_affine)(const float *a_left, const float *a_right, float *a_out);
+
+	// a_out[i] = a_left[i] * a_right[i] for a_count matrices
+	void (*m_matrix4_multiply_batch)(const float *a_left, const float *a_right, float *a_out, unsigned int a_count);
+
+	// Element wise lerp of all 16 values
+	void (*m_matrix4_interpolate)(const float *a_from, const float *a_to, float a_t, float *a_out);
+
+	// Element wise lerp of a_count floats, like two whole palettes
+	void (*m_interpolate_batch)(const float *a_from, const float *a_to, float a_t, float *a_out, unsigned int a_count);
+
+	// a_out[i] = nlerp(a_from[i], a_to[i], a_t) for a_count quaternions
+	void (*m_quaternion_nlerp_batch)(const Quaternion *a_from, const Quaternion *a_to, float a_t, Quaternion *a_out, unsigned int a_count);
+
+	// Linear blend skinning of a_count vertices with 3 influences each, a_palette is Matrix3x4 rows, 12 floats per joint
+	// The SIMD kernels work on 4 or 8 vertices per iteration, counts that are multiples of 8 avoid the scalar tail
+	// Positions, normals and weights are 3 floats per vertex, output normals are normalised
+	void (*m_skin_vertices)(const float *a_positions, const float *a_normals, const float *a_weights, const int *a_joints,
+							const float *a_palette, unsigned int a_count, float *a_out_positions, float *a_out_normals);
+} SimdKernels;
+
+void matrix4_multiply_scalar(const float *a_left, const float *a_right, float *a_out)
+{
+	float out[16];
+
+	for (int c = 0; c < 4; ++c)
+		for (int r = 0; r < 4; ++r)
+			out[c * 4 + r] = a_left[r] * a_right[c * 4] + a_left[4 + r] * a_right[c * 4 + 1] + a_left[8 + r] * a_right[c * 4 + 2] + a_left[12 + r] * a_right[c * 4 + 3];
+
+	std::memcpy(a_out, out, sizeof(out));
+}
+
+void matrix4_multiply_affine_scalar(const float *a_left, const float *a_right, float *a_out)
+{
+	float out[16];
+
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 3; ++r)
+			out[c * 4 + r] = a_left[r] * a_right[c * 4] + a_left[4 + r] * a_right[c * 4 + 1] + a_left[8 + r] * a_right[c * 4 + 2];
+
+		out[c * 4 + 3] = 0.0f;
+	}
+
+	out[12] += a_left[12];
+	out[13] += a_left[13];
+	out[14] += a_left[14];
+	out[15] = 1.0f;
+
+	std::memcpy(a_out, out, sizeof(out));
+}
+
+void matrix4_multiply_batch_scalar(const float *a_left, const float *a_right, float *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		matrix4_multiply_scalar(a_left + i * 16, a_right + i * 16, a_out + i * 16);
+}
+
+void matrix4_interpolate_scalar(const float *a_from, const float *a_to, float a_t, float *a_out)
+{
+	for (int i = 0; i < 16; ++i)
+		a_out[i] = a_from[i] + (a_to[i] - a_from[i]) * a_t;
+}
+
+void interpolate_batch_scalar(const float *a_from, const float *a_to, float a_t, float *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		a_out[i] = a_from[i] + (a_to[i] - a_from[i]) * a_t;
+}
+
+void quaternion_nlerp_batch_scalar(const Quaternion *a_from, const Quaternion *a_to, float a_t, Quaternion *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		a_out[i] = quaternion_nlerp(a_from[i], a_to[i], a_t);
+}
+
+void skin_vertices_scalar(const float *a_positions, const float *a_normals, const float *a_weights, const int *a_joints,
+						  const float *a_palette, unsigned int a_count, float *a_out_positions, float *a_out_normals)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		const float *weights = a_weights + i * 3;
+		const int *  joints  = a_joints + i * 3;
+		const float *m0      = a_palette + joints[0] * 12;
+		const float *m1      = a_palette + joints[1] * 12;
+		const float *m2      = a_palette + joints[2] * 12;
+
+		float rows[12];
+		for (int e = 0; e < 12; ++e)
+			rows[e] = m0[e] * weights[0] + m1[e] * weights[1] + m2[e] * weights[2];
+
+		const float *position = a_positions + i * 3;
+		const float *normal   = a_normals + i * 3;
+		float        skinned_normal[3];
+
+		for (int r = 0; r < 3; ++r)
+		{
+			const float *row = rows + r * 4;
+
+			a_out_positions[i * 3 + r] = row[0] * position[0] + row[1] * position[1] + row[2] * position[2] + row[3];
+			skinned_normal[r]          = row[0] * normal[0] + row[1] * normal[1] + row[2] * normal[2];
+		}
+
+		float length = std::sqrt(skinned_normal[0] * skinned_normal[0] + skinned_normal[1] * skinned_normal[1] + skinned_normal[2] * skinned_normal[2]);
+
+		for (int r = 0; r < 3; ++r)
+			a_out_normals[i * 3 + r] = skinned_normal[r] / length;
+	}
+}
+
+#if defined(SIMD_KERNELS_X86)
+
+__attribute__((target("sse4.1"))) void matrix4_multiply_sse4(const float *a_left, const float *a_right, float *a_out)
+{
+	__m128 l0 = _mm_loadu_ps(a_left + 0);
+	__m128 l1 = _mm_loadu_ps(a_left + 4);
+	__m128 l2 = _mm_loadu_ps(a_left + 8);
+	__m128 l3 = _mm_loadu_ps(a_left + 12);
+
+	__m128 out[4];
+
+	for (int c = 0; c < 4; ++c)
+	{
+		__m128 r = _mm_loadu_ps(a_right + c * 4);
+
+		out[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, _mm_shuffle_ps(r, r, 0x00)), _mm_mul_ps(l1, _mm_shuffle_ps(r, r, 0x55))),
+							_mm_add_ps(_mm_mul_ps(l2, _mm_shuffle_ps(r, r, 0xAA)), _mm_mul_ps(l3, _mm_shuffle_ps(r, r, 0xFF))));
+	}
+
+	for (int c = 0; c < 4; ++c)
+		_mm_storeu_ps(a_out + c * 4, out[c]);
+}
+
+__attribute__((target("sse4.1"))) void matrix4_multiply_affine_sse4(const float *a_left, const float *a_right, float *a_out)
+{
+	__m128 l0 = _mm_loadu_ps(a_left + 0);
+	__m128 l1 = _mm_loadu_ps(a_left + 4);
+	__m128 l2 = _mm_loadu_ps(a_left + 8);
+	__m128 l3 = _mm_loadu_ps(a_left + 12);
+
+	__m128 out[4];
+
+	// Last row of a_left is 0, 0, 0, 1 so the w of each column comes out right without the 4th term
+	for (int c = 0; c < 4; ++c)
+	{
+		__m128 r = _mm_loadu_ps(a_right + c * 4);
+
+		out[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, _mm_shuffle_ps(r, r, 0x00)), _mm_mul_ps(l1, _mm_shuffle_ps(r, r, 0x55))),
+							_mm_mul_ps(l2, _mm_shuffle_ps(r, r, 0xAA)));
+	}
+
+	out[3] = _mm_add_ps(out[3], l3);
+
+	for (int c = 0; c < 4; ++c)
+		_mm_storeu_ps(a_out + c * 4, out[c]);
+}
+
+__attribute__((target("sse4.1"))) void matrix4_multiply_batch_sse4(const float *a_left, const float *a_right, float *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		matrix4_multiply_sse4(a_left + i * 16, a_right + i * 16, a_out + i * 16);
+}
+
+__attribute__((target("sse4.1"))) void matrix4_interpolate_sse4(const float *a_from, const float *a_to, float a_t, float *a_out)
+{
+	__m128 t = _mm_set1_ps(a_t);
+
+	for (int c = 0; c < 16; c += 4)
+	{
+		__m128 from = _mm_loadu_ps(a_from + c);
+		_mm_storeu_ps(a_out + c, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(a_to + c), from), t)));
+	}
+}
+
+__attribute__((target("sse4.1"))) void interpolate_batch_sse4(const float *a_from, const float *a_to, float a_t, float *a_out, unsigned int a_count)
+{
+	__m128       t     = _mm_set1_ps(a_t);
+	unsigned int i     = 0;
+	unsigned int count = a_count & ~3u;
+
+	for (; i < count; i += 4)
+	{
+		__m128 from = _mm_loadu_ps(a_from + i);
+		_mm_storeu_ps(a_out + i, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(a_to + i), from), t)));
+	}
+
+	interpolate_batch_scalar(a_from + i, a_to + i, a_t, a_out + i, a_count - i);
+}
+
+__attribute__((target("sse4.1"))) void quaternion_nlerp_batch_sse4(const Quaternion *a_from, const Quaternion *a_to, float a_t, Quaternion *a_out, unsigned int a_count)
+{
+	__m128 s         = _mm_set1_ps(1.0f - a_t);
+	__m128 t         = _mm_set1_ps(a_t);
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		__m128 from = _mm_loadu_ps(&a_from[i].x);
+		__m128 to   = _mm_loadu_ps(&a_to[i].x);
+
+		// Flip a_to into the same hemisphere by xoring in the sign of the dot product
+		__m128 sign = _mm_and_ps(_mm_dp_ps(from, to, 0xFF), sign_mask);
+		__m128 out  = _mm_add_ps(_mm_mul_ps(from, s), _mm_mul_ps(_mm_xor_ps(to, sign), t));
+
+		out = _mm_div_ps(out, _mm_sqrt_ps(_mm_dp_ps(out, out, 0xFF)));
+		_mm_storeu_ps(&a_out[i].x, out);
+	}
+}
+
+__attribute__((target("avx2,fma"))) void matrix4_multiply_avx2(const float *a_left, const float *a_right, float *a_out)
+{
+	// Each 256 bit register holds two columns, left columns are duplicated in both halves
+	__m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 0));
+	__m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 4));
+	__m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 8));
+	__m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 12));
+
+	__m256 r01 = _mm256_loadu_ps(a_right + 0);
+	__m256 r23 = _mm256_loadu_ps(a_right + 8);
+
+	__m256 o01 = _mm256_mul_ps(l0, _mm256_shuffle_ps(r01, r01, 0x00));
+	o01        = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(r01, r01, 0x55), o01);
+	o01        = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(r01, r01, 0xAA), o01);
+	o01        = _mm256_fmadd_ps(l3, _mm256_shuffle_ps(r01, r01, 0xFF), o01);
+
+	__m256 o23 = _mm256_mul_ps(l0, _mm256_shuffle_ps(r23, r23, 0x00));
+	o23        = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(r23, r23, 0x55), o23);
+	o23        = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(r23, r23, 0xAA), o23);
+	o23        = _mm256_fmadd_ps(l3, _mm256_shuffle_ps(r23, r23, 0xFF), o23);
+
+	_mm256_storeu_ps(a_out + 0, o01);
+	_mm256_storeu_ps(a_out + 8, o23);
+}
+
+__attribute__((target("avx2,fma"))) void matrix4_multiply_affine_avx2(const float *a_left, const float *a_right, float *a_out)
+{
+	__m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 0));
+	__m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 4));
+	__m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a_left + 8));
+
+	// Translation only goes into the last column
+	__m256 l3 = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_loadu_ps(a_left + 12), 1);
+
+	__m256 r01 = _mm256_loadu_ps(a_right + 0);
+	__m256 r23 = _mm256_loadu_ps(a_right + 8);
+
+	__m256 o01 = _mm256_mul_ps(l0, _mm256_shuffle_ps(r01, r01, 0x00));
+	o01        = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(r01, r01, 0x55), o01);
+	o01        = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(r01, r01, 0xAA), o01);
+
+	__m256 o23 = _mm256_mul_ps(l0, _mm256_shuffle_ps(r23, r23, 0x00));
+	o23        = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(r23, r23, 0x55), o23);
+	o23        = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(r23, r23, 0xAA), o23);
+	o23        = _mm256_add_ps(o23, l3);
+
+	_mm256_storeu_ps(a_out + 0, o01);
+	_mm256_storeu_ps(a_out + 8, o23);
+}
+
+__attribute__((target("avx2,fma"))) void matrix4_multiply_batch_avx2(const float *a_left, const float *a_right, float *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		matrix4_multiply_avx2(a_left + i * 16, a_right + i * 16, a_out + i * 16);
+}
+
+__attribute__((target("avx2,fma"))) void matrix4_interpolate_avx2(const float *a_from, const float *a_to, float a_t, float *a_out)
+{
+	__m256 t = _mm256_set1_ps(a_t);
+
+	__m256 from0 = _mm256_loadu_ps(a_from + 0);
+	__m256 from1 = _mm256_loadu_ps(a_from + 8);
+
+	_mm256_storeu_ps(a_out + 0, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(a_to + 0), from0), t, from0));
+	_mm256_storeu_ps(a_out + 8, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(a_to + 8), from1), t, from1));
+}
+
+__attribute__((target("avx2,fma"))) void interpolate_batch_avx2(const float *a_from, const float *a_to, float a_t, float *a_out, unsigned int a_count)
+{
+	__m256       t     = _mm256_set1_ps(a_t);
+	unsigned int i     = 0;
+	unsigned int count = a_count & ~7u;
+
+	for (; i < count; i += 8)
+	{
+		__m256 from = _mm256_loadu_ps(a_from + i);
+		_mm256_storeu_ps(a_out + i, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(a_to + i), from), t, from));
+	}
+
+	interpolate_batch_scalar(a_from + i, a_to + i, a_t, a_out + i, a_count - i);
+}
+
+__attribute__((target("avx2,fma"))) void quaternion_nlerp_batch_avx2(const Quaternion *a_from, const Quaternion *a_to, float a_t, Quaternion *a_out, unsigned int a_count)
+{
+	__m256 s         = _mm256_set1_ps(1.0f - a_t);
+	__m256 t         = _mm256_set1_ps(a_t);
+	__m256 sign_mask = _mm256_set1_ps(-0.0f);
+
+	unsigned int i = 0;
+
+	// Two quaternions per register, dp_ps works per 128 bit lane
+	for (; i + 2 <= a_count; i += 2)
+	{
+		__m256 from = _mm256_loadu_ps(&a_from[i].x);
+		__m256 to   = _mm256_loadu_ps(&a_to[i].x);
+
+		__m256 sign = _mm256_and_ps(_mm256_dp_ps(from, to, 0xFF), sign_mask);
+		__m256 out  = _mm256_fmadd_ps(_mm256_xor_ps(to, sign), t, _mm256_mul_ps(from, s));
+
+		out = _mm256_div_ps(out, _mm256_sqrt_ps(_mm256_dp_ps(out, out, 0xFF)));
+		_mm256_storeu_ps(&a_out[i].x, out);
+	}
+
+	if (i < a_count)
+		quaternion_nlerp_batch_sse4(a_from + i, a_to + i, a_t, a_out + i, a_count - i);
+}
+
+// Splits x, y, z triplets of 4 vertices into one register per component
+__attribute__((target("sse4.1"))) inline void deinterleave3_sse4(const float *a_in, __m128 &a_x, __m128 &a_y, __m128 &a_z)
+{
+	__m128 v0 = _mm_loadu_ps(a_in + 0);        // x0 y0 z0 x1
+	__m128 v1 = _mm_loadu_ps(a_in + 4);        // y1 z1 x2 y2
+	__m128 v2 = _mm_loadu_ps(a_in + 8);        // z2 x3 y3 z3
+
+	__m128 t0 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));        // x2 y2 x3 y3
+	__m128 t1 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 2, 1));        // y0 z0 y1 z1
+
+	a_x = _mm_shuffle_ps(v0, t0, _MM_SHUFFLE(2, 0, 3, 0));
+	a_y = _mm_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));
+	a_z = _mm_shuffle_ps(t1, v2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// Inverse of deinterleave3_sse4
+__attribute__((target("sse4.1"))) inline void interleave3_sse4(__m128 a_x, __m128 a_y, __m128 a_z, float *a_out)
+{
+	__m128 xy_low  = _mm_unpacklo_ps(a_x, a_y);                                 // x0 y0 x1 y1
+	__m128 xy_high = _mm_unpackhi_ps(a_x, a_y);                                 // x2 y2 x3 y3
+	__m128 zx      = _mm_shuffle_ps(a_z, a_x, _MM_SHUFFLE(1, 0, 1, 0));         // z0 z1 x0 x1
+	__m128 yz      = _mm_shuffle_ps(xy_low, zx, _MM_SHUFFLE(1, 0, 3, 2));       // x1 y1 z0 z1
+	__m128 zx_high = _mm_shuffle_ps(a_z, xy_high, _MM_SHUFFLE(2, 2, 2, 2));     // z2 z2 x3 x3
+	__m128 yz_high = _mm_shuffle_ps(xy_high, a_z, _MM_SHUFFLE(3, 3, 3, 3));     // y3 y3 z3 z3
+
+	_mm_storeu_ps(a_out + 0, _mm_shuffle_ps(xy_low, zx, _MM_SHUFFLE(3, 0, 1, 0)));
+	_mm_storeu_ps(a_out + 4, _mm_shuffle_ps(yz, xy_high, _MM_SHUFFLE(1, 0, 3, 1)));
+	_mm_storeu_ps(a_out + 8, _mm_shuffle_ps(zx_high, yz_high, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Four vertices per iteration. The palette rows are blended per vertex, that is a gather nothing vectorises across vertices,
+// then transposed so each register holds one matrix element of all 4 vertices. Transform and normalise are then plain
+// vertical math with no horizontal adds, and the tail goes through the scalar kernel
+__attribute__((target("sse4.1"))) void skin_vertices_sse4(const float *a_positions, const float *a_normals, const float *a_weights, const int *a_joints,
+														  const float *a_palette, unsigned int a_count, float *a_out_positions, float *a_out_normals)
+{
+	unsigned int i = 0;
+
+	for (; i + 4 <= a_count; i += 4)
+	{
+		__m128 rows[3][4];
+
+		for (int v = 0; v < 4; ++v)
+		{
+			const float *weights = a_weights + (i + v) * 3;
+			const int *  joints  = a_joints + (i + v) * 3;
+			const float *m0      = a_palette + joints[0] * 12;
+			const float *m1      = a_palette + joints[1] * 12;
+			const float *m2      = a_palette + joints[2] * 12;
+
+			__m128 w0 = _mm_set1_ps(weights[0]);
+			__m128 w1 = _mm_set1_ps(weights[1]);
+			__m128 w2 = _mm_set1_ps(weights[2]);
+
+			for (int r = 0; r < 3; ++r)
+				rows[r][v] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m0 + r * 4), w0), _mm_mul_ps(_mm_loadu_ps(m1 + r * 4), w1)),
+										_mm_mul_ps(_mm_loadu_ps(m2 + r * 4), w2));
+		}
+
+		// rows[r][c] becomes element r, c of the 4 blended matrices
+		for (int r = 0; r < 3; ++r)
+			_MM_TRANSPOSE4_PS(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+
+		__m128 px, py, pz, nx, ny, nz;
+		deinterleave3_sse4(a_positions + i * 3, px, py, pz);
+		deinterleave3_sse4(a_normals + i * 3, nx, ny, nz);
+
+		__m128 out_position[3], out_normal[3];
+
+		for (int r = 0; r < 3; ++r)
+		{
+			out_position[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[r][0], px), _mm_mul_ps(rows[r][1], py)), _mm_add_ps(_mm_mul_ps(rows[r][2], pz), rows[r][3]));
+			out_normal[r]   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[r][0], nx), _mm_mul_ps(rows[r][1], ny)), _mm_mul_ps(rows[r][2], nz));
+		}
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(out_normal[0], out_normal[0]), _mm_mul_ps(out_normal[1], out_normal[1])),
+											   _mm_mul_ps(out_normal[2], out_normal[2])));
+
+		interleave3_sse4(out_position[0], out_position[1], out_position[2], a_out_positions + i * 3);
+		interleave3_sse4(_mm_div_ps(out_normal[0], length), _mm_div_ps(out_normal[1], length), _mm_div_ps(out_normal[2], length), a_out_normals + i * 3);
+	}
+
+	if (i < a_count)
+		skin_vertices_scalar(a_positions + i * 3, a_normals + i * 3, a_weights + i * 3, a_joints + i * 3, a_palette, a_count - i, a_out_positions + i * 3, a_out_normals + i * 3);
+}
+
+// Same shuffles as deinterleave3_sse4, vertices 0 to 3 in the low 128 bits and 4 to 7 in the high ones
+__attribute__((target("avx2,fma"))) inline void deinterleave3_avx2(const float *a_in, __m256 &a_x, __m256 &a_y, __m256 &a_z)
+{
+	__m256 v0 = _mm256_loadu2_m128(a_in + 12, a_in + 0);
+	__m256 v1 = _mm256_loadu2_m128(a_in + 16, a_in + 4);
+	__m256 v2 = _mm256_loadu2_m128(a_in + 20, a_in + 8);
+
+	__m256 t0 = _mm256_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));
+	__m256 t1 = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 2, 1));
+
+	a_x = _mm256_shuffle_ps(v0, t0, _MM_SHUFFLE(2, 0, 3, 0));
+	a_y = _mm256_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));
+	a_z = _mm256_shuffle_ps(t1, v2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+__attribute__((target("avx2,fma"))) inline void interleave3_avx2(__m256 a_x, __m256 a_y, __m256 a_z, float *a_out)
+{
+	__m256 xy_low  = _mm256_unpacklo_ps(a_x, a_y);
+	__m256 xy_high = _mm256_unpackhi_ps(a_x, a_y);
+	__m256 zx      = _mm256_shuffle_ps(a_z, a_x, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 yz      = _mm256_shuffle_ps(xy_low, zx, _MM_SHUFFLE(1, 0, 3, 2));
+	__m256 zx_high = _mm256_shuffle_ps(a_z, xy_high, _MM_SHUFFLE(2, 2, 2, 2));
+	__m256 yz_high = _mm256_shuffle_ps(xy_high, a_z, _MM_SHUFFLE(3, 3, 3, 3));
+
+	_mm256_storeu2_m128(a_out + 12, a_out + 0, _mm256_shuffle_ps(xy_low, zx, _MM_SHUFFLE(3, 0, 1, 0)));
+	_mm256_storeu2_m128(a_out + 16, a_out + 4, _mm256_shuffle_ps(yz, xy_high, _MM_SHUFFLE(1, 0, 3, 1)));
+	_mm256_storeu2_m128(a_out + 20, a_out + 8, _mm256_shuffle_ps(zx_high, yz_high, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Transposes the 4x4 block in each 128 bit half
+__attribute__((target("avx2,fma"))) inline void transpose4_avx2(__m256 &a_r0, __m256 &a_r1, __m256 &a_r2, __m256 &a_r3)
+{
+	__m256 t0 = _mm256_unpacklo_ps(a_r0, a_r1);
+	__m256 t1 = _mm256_unpackhi_ps(a_r0, a_r1);
+	__m256 t2 = _mm256_unpacklo_ps(a_r2, a_r3);
+	__m256 t3 = _mm256_unpackhi_ps(a_r2, a_r3);
+
+	a_r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	a_r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	a_r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	a_r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Eight vertices per iteration, vertex v and v + 4 share a register while blending so the transpose and the AoS shuffles
+// stay within 128 bit halves, then the same vertical math as sse4 with fma
+__attribute__((target("avx2,fma"))) void skin_vertices_avx2(const float *a_positions, const float *a_normals, const float *a_weights, const int *a_joints,
+															const float *a_palette, unsigned int a_count, float *a_out_positions, float *a_out_normals)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= a_count; i += 8)
+	{
+		__m256 rows[3][4];
+
+		for (int v = 0; v < 4; ++v)
+		{
+			const float *weights_a = a_weights + (i + v) * 3;
+			const float *weights_b = a_weights + (i + v + 4) * 3;
+			const int *  joints_a  = a_joints + (i + v) * 3;
+			const int *  joints_b  = a_joints + (i + v + 4) * 3;
+
+			const float *a0 = a_palette + joints_a[0] * 12, *a1 = a_palette + joints_a[1] * 12, *a2 = a_palette + joints_a[2] * 12;
+			const float *b0 = a_palette + joints_b[0] * 12, *b1 = a_palette + joints_b[1] * 12, *b2 = a_palette + joints_b[2] * 12;
+
+			__m256 w0 = _mm256_setr_m128(_mm_set1_ps(weights_a[0]), _mm_set1_ps(weights_b[0]));
+			__m256 w1 = _mm256_setr_m128(_mm_set1_ps(weights_a[1]), _mm_set1_ps(weights_b[1]));
+			__m256 w2 = _mm256_setr_m128(_mm_set1_ps(weights_a[2]), _mm_set1_ps(weights_b[2]));
+
+			for (int r = 0; r < 3; ++r)
+			{
+				rows[r][v] = _mm256_mul_ps(_mm256_loadu2_m128(b0 + r * 4, a0 + r * 4), w0);
+				rows[r][v] = _mm256_fmadd_ps(_mm256_loadu2_m128(b1 + r * 4, a1 + r * 4), w1, rows[r][v]);
+				rows[r][v] = _mm256_fmadd_ps(_mm256_loadu2_m128(b2 + r * 4, a2 + r * 4), w2, rows[r][v]);
+			}
+		}
+
+		for (int r = 0; r < 3; ++r)
+			transpose4_avx2(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+
+		__m256 px, py, pz, nx, ny, nz;
+		deinterleave3_avx2(a_positions + i * 3, px, py, pz);
+		deinterleave3_avx2(a_normals + i * 3, nx, ny, nz);
+
+		__m256 out_position[3], out_normal[3];
+
+		for (int r = 0; r < 3; ++r)
+		{
+			out_position[r] = _mm256_fmadd_ps(rows[r][0], px, _mm256_fmadd_ps(rows[r][1], py, _mm256_fmadd_ps(rows[r][2], pz, rows[r][3])));
+			out_normal[r]   = _mm256_fmadd_ps(rows[r][0], nx, _mm256_fmadd_ps(rows[r][1], ny, _mm256_mul_ps(rows[r][2], nz)));
+		}
+
+		__m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(out_normal[0], out_normal[0], _mm256_fmadd_ps(out_normal[1], out_normal[1], _mm256_mul_ps(out_normal[2], out_normal[2]))));
+
+		interleave3_avx2(out_position[0], out_position[1], out_position[2], a_out_positions + i * 3);
+		interleave3_avx2(_mm256_div_ps(out_normal[0], length), _mm256_div_ps(out_normal[1], length), _mm256_div_ps(out_normal[2], length), a_out_normals + i * 3);
+	}
+
+	if (i < a_count)
+		skin_vertices_sse4(a_positions + i * 3, a_normals + i * 3, a_weights + i * 3, a_joints + i * 3, a_palette, a_count - i, a_out_positions + i * 3, a_out_normals + i * 3);
+}
+
+#elif defined(SIMD_KERNELS_NEON)
+
+void matrix4_multiply_neon(const float *a_left, const float *a_right, float *a_out)
+{
+	float32x4_t l0 = vld1q_f32(a_left + 0);
+	float32x4_t l1 = vld1q_f32(a_left + 4);
+	float32x4_t l2 = vld1q_f32(a_left + 8);
+	float32x4_t l3 = vld1q_f32(a_left + 12);
+
+	float32x4_t out[4];
+
+	for (int c = 0; c < 4; ++c)
+	{
+		float32x4_t r = vld1q_f32(a_right + c * 4);
+
+		out[c] = vmulq_laneq_f32(l0, r, 0);
+		out[c] = vfmaq_laneq_f32(out[c], l1, r, 1);
+		out[c] = vfmaq_laneq_f32(out[c], l2, r, 2);
+		out[c] = vfmaq_laneq_f32(out[c], l3, r, 3);
+	}
+
+	for (int c = 0; c < 4; ++c)
+		vst1q_f32(a_out + c * 4, out[c]);
+}
+
+void matrix4_multiply_affine_neon(const float *a_left, const float *a_right, float *a_out)
+{
+	float32x4_t l0 = vld1q_f32(a_left + 0);
+	float32x4_t l1 = vld1q_f32(a_left + 4);
+	float32x4_t l2 = vld1q_f32(a_left + 8);
+	float32x4_t l3 = vld1q_f32(a_left + 12);
+
+	float32x4_t out[4];
+
+	for (int c = 0; c < 4; ++c)
+	{
+		float32x4_t r = vld1q_f32(a_right + c * 4);
+
+		out[c] = vmulq_laneq_f32(l0, r, 0);
+		out[c] = vfmaq_laneq_f32(out[c], l1, r, 1);
+		out[c] = vfmaq_laneq_f32(out[c], l2, r, 2);
+	}
+
+	out[3] = vaddq_f32(out[3], l3);
+
+	for (int c = 0; c < 4; ++c)
+		vst1q_f32(a_out + c * 4, out[c]);
+}
+
+void matrix4_multiply_batch_neon(const float *a_left, const float *a_right, float *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+		matrix4_multiply_neon(a_left + i * 16, a_right + i * 16, a_out + i * 16);
+}
+
+void matrix4_interpolate_neon(const float *a_from, const float *a_to, float a_t, float *a_out)
+{
+	for (int c = 0; c < 16; c += 4)
+	{
+		float32x4_t from = vld1q_f32(a_from + c);
+		vst1q_f32(a_out + c, vfmaq_n_f32(from, vsubq_f32(vld1q_f32(a_to + c), from), a_t));
+	}
+}
+
+void interpolate_batch_neon(const float *a_from, const float *a_to, float a_t, float *a_out, unsigned int a_count)
+{
+	unsigned int i     = 0;
+	unsigned int count = a_count & ~3u;
+
+	for (; i < count; i += 4)
+	{
+		float32x4_t from = vld1q_f32(a_from + i);
+		vst1q_f32(a_out + i, vfmaq_n_f32(from, vsubq_f32(vld1q_f32(a_to + i), from), a_t));
+	}
+
+	interpolate_batch_scalar(a_from + i, a_to + i, a_t, a_out + i, a_count - i);
+}
+
+void quaternion_nlerp_batch_neon(const Quaternion *a_from, const Quaternion *a_to, float a_t, Quaternion *a_out, unsigned int a_count)
+{
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		float32x4_t from = vld1q_f32(&a_from[i].x);
+		float32x4_t to   = vld1q_f32(&a_to[i].x);
+
+		float t   = vaddvq_f32(vmulq_f32(from, to)) < 0.0f ? -a_t : a_t;
+		float32x4_t out = vfmaq_n_f32(vmulq_n_f32(from, 1.0f - a_t), to, t);
+
+		out = vmulq_n_f32(out, 1.0f / std::sqrt(vaddvq_f32(vmulq_f32(out, out))));
+		vst1q_f32(&a_out[i].x, out);
+	}
+}
+
+// Four vertices per iteration, vld3q and vst3q do the AoS to SoA shuffles. Rows are blended per vertex and transposed so
+// the transform and normalise are vertical like the x86 kernels, the tail goes through the scalar kernel
+void skin_vertices_neon(const float *a_positions, const float *a_normals, const float *a_weights, const int *a_joints,
+						const float *a_palette, unsigned int a_count, float *a_out_positions, float *a_out_normals)
+{
+	unsigned int i = 0;
+
+	for (; i + 4 <= a_count; i += 4)
+	{
+		float32x4_t rows[3][4];
+
+		for (int v = 0; v < 4; ++v)
+		{
+			const float *weights = a_weights + (i + v) * 3;
+			const int *  joints  = a_joints + (i + v) * 3;
+			const float *m0      = a_palette + joints[0] * 12;
+			const float *m1      = a_palette + joints[1] * 12;
+			const float *m2      = a_palette + joints[2] * 12;
+
+			for (int r = 0; r < 3; ++r)
+			{
+				rows[r][v] = vmulq_n_f32(vld1q_f32(m0 + r * 4), weights[0]);
+				rows[r][v] = vfmaq_n_f32(rows[r][v], vld1q_f32(m1 + r * 4), weights[1]);
+				rows[r][v] = vfmaq_n_f32(rows[r][v], vld1q_f32(m2 + r * 4), weights[2]);
+			}
+		}
+
+		// rows[r][c] becomes element r, c of the 4 blended matrices
+		for (int r = 0; r < 3; ++r)
+		{
+			float32x4x2_t t01 = vtrnq_f32(rows[r][0], rows[r][1]);
+			float32x4x2_t t23 = vtrnq_f32(rows[r][2], rows[r][3]);
+
+			rows[r][0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+			rows[r][1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+			rows[r][2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+			rows[r][3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+		}
+
+		float32x4x3_t position = vld3q_f32(a_positions + i * 3);
+		float32x4x3_t normal   = vld3q_f32(a_normals + i * 3);
+		float32x4x3_t out_position, out_normal;
+
+		for (int r = 0; r < 3; ++r)
+		{
+			out_position.val[r] = vfmaq_f32(vfmaq_f32(vfmaq_f32(rows[r][3], rows[r][0], position.val[0]), rows[r][1], position.val[1]), rows[r][2], position.val[2]);
+			out_normal.val[r]   = vfmaq_f32(vfmaq_f32(vmulq_f32(rows[r][0], normal.val[0]), rows[r][1], normal.val[1]), rows[r][2], normal.val[2]);
+		}
+
+		float32x4_t length = vsqrtq_f32(vfmaq_f32(vfmaq_f32(vmulq_f32(out_normal.val[0], out_normal.val[0]), out_normal.val[1], out_normal.val[1]), out_normal.val[2], out_normal.val[2]));
+
+		for (int r = 0; r < 3; ++r)
+			out_normal.val[r] = vdivq_f32(out_normal.val[r], length);
+
+		vst3q_f32(a_out_positions + i * 3, out_position);
+		vst3q_f32(a_out_normals + i * 3, out_normal);
+	}
+
+	if (i < a_count)
+		skin_vertices_scalar(a_positions + i * 3, a_normals + i * 3, a_weights + i * 3, a_joints + i * 3, a_palette, a_count - i, a_out_positions + i * 3, a_out_normals + i * 3);
+}
+
+#endif
+
+bool simd_level_supported(SimdLevel a_level)
+{
+	switch (a_level)
+	{
+		case SimdLevel::scalar:
+			return true;
+#if defined(SIMD_KERNELS_X86)
+		case SimdLevel::sse4:
+			return __builtin_cpu_supports("sse4.1");
+		case SimdLevel::avx2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(SIMD_KERNELS_NEON)
+		case SimdLevel::neon:
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+// Returns the kernels for a_level, or the scalar ones if a_level isn't supported on this CPU
+SimdKernels get_simd_kernels(SimdLevel a_level)
+{
+	SimdKernels kernels{SimdLevel::scalar, "scalar",
+						matrix4_multiply_scalar, matrix4_multiply_affine_scalar, matrix4_multiply_batch_scalar,
+						matrix4_interpolate_scalar, interpolate_batch_scalar, quaternion_nlerp_batch_scalar, skin_vertices_scalar};
+
+	if (!simd_level_supported(a_level))
+		return kernels;
+
+#if defined(SIMD_KERNELS_X86)
+	if (a_level == SimdLevel::sse4)
+		kernels = SimdKernels{SimdLevel::sse4, "sse4.1",
+							  matrix4_multiply_sse4, matrix4_multiply_affine_sse4, matrix4_multiply_batch_sse4,
+							  matrix4_interpolate_sse4, interpolate_batch_sse4, quaternion_nlerp_batch_sse4, skin_vertices_sse4};
+	else if (a_level == SimdLevel::avx2)
+		kernels = SimdKernels{SimdLevel::avx2, "avx2",
+							  matrix4_multiply_avx2, matrix4_multiply_affine_avx2, matrix4_multiply_batch_avx2,
+							  matrix4_interpolate_avx2, interpolate_batch_avx2, quaternion_nlerp_batch_avx2, skin_vertices_avx2};
+#elif defined(SIMD_KERNELS_NEON)
+	if (a_level == SimdLevel::neon)
+		kernels = SimdKernels{SimdLevel::neon, "neon",
+							  matrix4_multiply_neon, matrix4_multiply_affine_neon, matrix4_multiply_batch_neon,
+							  matrix4_interpolate_neon, interpolate_batch_neon, quaternion_nlerp_batch_neon, skin_vertices_neon};
+#endif
+
+	return kernels;
+}
+
+// Best kernels for this CPU, detected once on first use
+const SimdKernels &simd_kernels()
+{
+	static const SimdKernels kernels = []() {
+		for (auto level : {SimdLevel::avx2, SimdLevel::neon, SimdLevel::sse4})
+			if (simd_level_supported(level))
+				return get_simd_kernels(level);
+
+		return get_simd_kernels(SimdLevel::scalar);
+	}();
+
+	return kernels;
+}
@@ -22,12 +22,21 @@
 //
 // Version: 1.0.0
 
+#include <cmath>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <utility>
 #include <vector>
 
+#include "animation_texture.hpp"
+#include "benchmark.hpp"
+#include "crowd_animation.hpp"
+#include "frame_pipeline.hpp"
 #include "geometry.hpp"
+#include "headless.hpp"
 #include "math/rormatrix4.hpp"
 #include "math/rormatrix4_functions.hpp"
 #include "math/rorvector3.hpp"
@@ -46,8 +55,69 @@ float             aspect_ratio       = 1.0f;
 Geometry *        cube               = nullptr;
 Geometry *        astro_boy_skeleton = nullptr;
 AnimatedGeometry *astro_boy_skin     = nullptr;
+PaletteRing *     palette_ring       = nullptr;        // Persistently mapped palettes, nullptr without GL 4.4 or with --subdata-palette
 double            old_time           = 0.0;
 
+GLFWwindow *    main_window           = nullptr;
+HeadlessContext headless_context;
+unsigned int    headless_frames_count = 0;                   // --headless 600 renders 600 frames offscreen and prints timings, 0 opens a window
+double          headless_frame_time   = 1.0 / 60.0;          // --frame-time 0.0333, simulated seconds per headless frame
+unsigned int    rendered_frames_count = 0;
+
+// Palette of one frame in the format of the palette mode, built by animate_palette and uploaded by upload_palette
+typedef struct
+{
+	std::vector<Transform>      m_world_transforms;
+	std::vector<ror::Matrix4f>  m_joint_matrices;
+	std::vector<Matrix3x4>      m_joint_rows;
+	std::vector<DualQuaternion> m_joint_dual_quaternions;
+	std::vector<Matrix3x4>      m_crowd_palettes;        // Only pipelined, the crowd animates every frame whatever the lod
+	unsigned int                m_level   = 0;
+	bool                        m_updated = false;        // The lod skipped this frame, the uploaded palette stays
+} FramePalette;
+
+// What the animation of a frame needs from the render thread, so a pipelined animation thread shares nothing else with it
+typedef struct
+{
+	float m_delta_time;
+	float m_distance;
+} AnimationRequest;
+
+Skeleton        astro_boy_rig;
+AnimationClip   astro_boy_clip;
+AnimationPlayer astro_boy_player;
+FramePalette    astro_boy_frame;
+FramePalette    astro_boy_previous_frame;        // Update before astro_boy_frame, only with --tick-rate
+FramePalette    astro_boy_tick_frame;            // Latest tick, the lod might have skipped it
+FramePalette    astro_boy_blended_frame;         // Between the last two updates
+float           astro_boy_tick_time          = 0.0f;        // Time since the last tick
+unsigned int    astro_boy_ticks_since_update = 0;           // Ticks since astro_boy_frame
+unsigned int    astro_boy_update_ticks       = 1;           // Ticks from astro_boy_previous_frame to astro_boy_frame
+
+JobSystem *                  crowd_jobs      = nullptr;
+CrowdAnimation<> *           crowd_animation = nullptr;
+std::vector<AnimationPlayer> crowd_players;
+std::vector<Matrix3x4>       crowd_palettes;        // Palettes of all the crowd one after the other, pipelined frames have their own
+std::vector<SkinnedInstance> crowd_instances;
+
+AnimationTexture *astro_boy_animation_texture = nullptr;        // Only with --baked
+float             astro_boy_baked_time        = 0.0f;
+
+AnimationLod              astro_boy_lod;
+std::vector<unsigned int> astro_boy_skin_joint_lods;        // AnimatedGeometry joint lod of each AnimationLod level
+unsigned int              astro_boy_lod_level = -1u;
+unsigned int              frame_index         = 0;
+float                     astro_boy_distance  = 10.0f;        // W and S to move away and closer
+const float               astro_boy_height    = 5.75f;
+
+PaletteMode  palette_mode         = PaletteMode::matrix4;          // --affine-palette or --dq-palette to change
+unsigned int pipeline_slots_count = 0;                             // --pipelined or --pipelined-double to animate the next frame while this one renders
+bool         persistent_palette   = true;                          // --subdata-palette uploads with glBufferSubData even where persistent mapping works
+VertexFormat vertex_format        = VertexFormat::packed;          // --separate-vertices draws from a float buffer per attribute instead of interleaved packed vertices
+bool         baked_animation      = false;                         // --baked samples palettes baked into a texture at load in the vertex shader, ignores pipelining, tick rate and the palette flags
+unsigned int crowd_count          = 0;                             // --crowd 1000 draws that many more astro boys behind the first one with one instanced draw
+float        animation_tick_rate  = 0.0f;                          // --tick-rate 30 animates at a fixed rate and interpolates palettes in between, 0 every frame, ignored when pipelined
+
 static const char *vertex_shader_src =
 	"#version 330 core\n"
 	"layout (location = 0) in vec4 position;\n"
@@ -70,6 +140,7 @@ static const char *fragment_shader_src =
 	"}\n";
 
 // https://learnopengl.com/Lighting/Basic-Lighting\n
+// Up to 4 influences, the last weight is what the first three leave so 3 float weights with the default w and 4 packed ones both work
 static const char *vertex_shader_lit_src =
 	"#version 330 core\n"
 	"layout (location = 0) in vec4 position;\n"
@@ -93,7 +164,217 @@ static const char *vertex_shader_lit_src =
 	"	 mat4 keyframe_transform =\n"
 	"		joints_matrix[joints.x] * weights.x +\n"
 	"		joints_matrix[joints.y] * weights.y +\n"
-	"		joints_matrix[joints.z] * weights.z;\n"
+	"		joints_matrix[joints.z] * weights.z +\n"
+	"		joints_matrix[joints.w] * (1.0 - weights.x - weights.y - weights.z);\n"
+	"	 mat4 model_animated = model * keyframe_transform;\n"
+	"    position_out = vec3(model_animated * position);\n"
+	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
+	"    uv_out = uv;  \n"
+	"    uv_out.y = 1.0 - uv.y;  \n"
+	"    gl_Position = projection * view * vec4(position_out, 1.0);\n"
+	"}\n";
+
+// Same as above with the palette stored as three rows per joint, 256 joints fit in 12KB
+static const char *vertex_shader_lit_affine_src =
+	"#version 330 core\n"
+	"layout (location = 0) in vec4 position;\n"
+	"layout (location = 1) in vec3 normal;\n"
+	"layout (location = 2) in vec2 uv;\n"
+	"layout (location = 3) in vec4 weights;\n"
+	"layout (location = 4) in uvec4 joints;\n"
+	"out vec3 position_out;\n"
+	"out vec3 normal_out;\n"
+	"out vec2 uv_out;\n"
+	"uniform mat4 model;\n"
+	"uniform mat4 view;\n"
+	"uniform mat4 projection;\n"
+	"const int joints_max = 256;\n"
+	"layout (std140) uniform joint_matrices\n"
+	"{\n"
+	"    vec4 joints_rows[joints_max * 3];\n"
+	"};\n"
+	"vec4 joint_row(uint row)\n"
+	"{\n"
+	"	 return joints_rows[joints.x * 3u + row] * weights.x +\n"
+	"		joints_rows[joints.y * 3u + row] * weights.y +\n"
+	"		joints_rows[joints.z * 3u + row] * weights.z +\n"
+	"		joints_rows[joints.w * 3u + row] * (1.0 - weights.x - weights.y - weights.z);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	 mat4 keyframe_transform = transpose(mat4(joint_row(0u), joint_row(1u), joint_row(2u), vec4(0.0, 0.0, 0.0, 1.0)));\n"
+	"	 mat4 model_animated = model * keyframe_transform;\n"
+	"    position_out = vec3(model_animated * position);\n"
+	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
+	"    uv_out = uv;  \n"
+	"    uv_out.y = 1.0 - uv.y;  \n"
+	"    gl_Position = projection * view * vec4(position_out, 1.0);\n"
+	"}\n";
+
+// Dual quaternion skinning, blends two vec4 per joint in the hemisphere of the first joint, 256 joints fit in 8KB
+static const char *vertex_shader_lit_dq_src =
+	"#version 330 core\n"
+	"layout (location = 0) in vec4 position;\n"
+	"layout (location = 1) in vec3 normal;\n"
+	"layout (location = 2) in vec2 uv;\n"
+	"layout (location = 3) in vec4 weights;\n"
+	"layout (location = 4) in uvec4 joints;\n"
+	"out vec3 position_out;\n"
+	"out vec3 normal_out;\n"
+	"out vec2 uv_out;\n"
+	"uniform mat4 model;\n"
+	"uniform mat4 view;\n"
+	"uniform mat4 projection;\n"
+	"const int joints_max = 256;\n"
+	"layout (std140) uniform joint_matrices\n"
+	"{\n"
+	"    vec4 joints_dual_quaternions[joints_max * 2];\n"
+	"};\n"
+	"void main()\n"
+	"{\n"
+	"	 vec4 real_x = joints_dual_quaternions[joints.x * 2u];\n"
+	"	 vec4 real_y = joints_dual_quaternions[joints.y * 2u];\n"
+	"	 vec4 real_z = joints_dual_quaternions[joints.z * 2u];\n"
+	"	 vec4 real_w = joints_dual_quaternions[joints.w * 2u];\n"
+	"	 float weight_w = 1.0 - weights.x - weights.y - weights.z;\n"
+	"	 float weight_y = dot(real_x, real_y) < 0.0 ? -weights.y : weights.y;\n"
+	"	 float weight_z = dot(real_x, real_z) < 0.0 ? -weights.z : weights.z;\n"
+	"	 weight_w = dot(real_x, real_w) < 0.0 ? -weight_w : weight_w;\n"
+	"	 vec4 real = real_x * weights.x + real_y * weight_y + real_z * weight_z + real_w * weight_w;\n"
+	"	 vec4 dual = joints_dual_quaternions[joints.x * 2u + 1u] * weights.x +\n"
+	"		joints_dual_quaternions[joints.y * 2u + 1u] * weight_y +\n"
+	"		joints_dual_quaternions[joints.z * 2u + 1u] * weight_z +\n"
+	"		joints_dual_quaternions[joints.w * 2u + 1u] * weight_w;\n"
+	"	 float inverse_length = 1.0 / length(real);\n"
+	"	 real *= inverse_length;\n"
+	"	 dual *= inverse_length;\n"
+	"	 vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));\n"
+	"	 vec3 skinned = position.xyz + 2.0 * cross(real.xyz, cross(real.xyz, position.xyz) + real.w * position.xyz) + translation;\n"
+	"    position_out = vec3(model * vec4(skinned, 1.0));\n"
+	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
+	"    uv_out = uv;  \n"
+	"    uv_out.y = 1.0 - uv.y;  \n"
+	"    gl_Position = projection * view * vec4(position_out, 1.0);\n"
+	"}\n";
+
+// Same as the affine shader for a crowd drawn with one instanced draw, the model and palette offset come from the instance
+// and the palettes of all instances from a texture buffer
+static const char *vertex_shader_lit_instanced_src =
+	"#version 330 core\n"
+	"layout (location = 0) in vec4 position;\n"
+	"layout (location = 1) in vec3 normal;\n"
+	"layout (location = 2) in vec2 uv;\n"
+	"layout (location = 3) in vec4 weights;\n"
+	"layout (location = 4) in uvec4 joints;\n"
+	"layout (location = 5) in mat4 model;\n"
+	"layout (location = 9) in uint palette_offset;\n"
+	"out vec3 position_out;\n"
+	"out vec3 normal_out;\n"
+	"out vec2 uv_out;\n"
+	"uniform mat4 view;\n"
+	"uniform mat4 projection;\n"
+	"uniform samplerBuffer joint_palettes;\n"
+	"vec4 palette_row(uint joint, uint row)\n"
+	"{\n"
+	"	 return texelFetch(joint_palettes, int((palette_offset + joint) * 3u + row));\n"
+	"}\n"
+	"vec4 joint_row(uint row)\n"
+	"{\n"
+	"	 return palette_row(joints.x, row) * weights.x +\n"
+	"		palette_row(joints.y, row) * weights.y +\n"
+	"		palette_row(joints.z, row) * weights.z +\n"
+	"		palette_row(joints.w, row) * (1.0 - weights.x - weights.y - weights.z);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	 mat4 keyframe_transform = transpose(mat4(joint_row(0u), joint_row(1u), joint_row(2u), vec4(0.0, 0.0, 0.0, 1.0)));\n"
+	"	 mat4 model_animated = model * keyframe_transform;\n"
+	"    position_out = vec3(model_animated * position);\n"
+	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
+	"    uv_out = uv;  \n"
+	"    uv_out.y = 1.0 - uv.y;  \n"
+	"    gl_Position = projection * view * vec4(position_out, 1.0);\n"
+	"}\n";
+
+// Samples an AnimationTexture the way BakedClip::sample does, shared by both baked shaders
+// find_frames(time) picks the two frames around time, joint_row(row) blends their rows by the vertex's weights
+#define BAKED_PALETTE_GLSL \
+	"uniform sampler2D animation_palettes;\n" \
+	"uniform float animation_time;\n" \
+	"uniform float animation_duration;\n" \
+	"uniform int animation_frames;\n" \
+	"uniform bool animation_loop;\n" \
+	"int frame_from;\n" \
+	"int frame_to;\n" \
+	"float frame_t;\n" \
+	"void find_frames(float time)\n" \
+	"{\n" \
+	"	 float span = float(animation_loop ? animation_frames : animation_frames - 1);\n" \
+	"	 float position = (animation_loop ? mod(time, animation_duration) : clamp(time, 0.0, animation_duration)) / animation_duration * span;\n" \
+	"	 frame_from = min(int(position), animation_frames - 1);\n" \
+	"	 frame_to = frame_from + 1 < animation_frames ? frame_from + 1 : (animation_loop ? 0 : frame_from);\n" \
+	"	 frame_t = position - float(frame_from);\n" \
+	"}\n" \
+	"vec4 palette_row(uint joint, uint row)\n" \
+	"{\n" \
+	"	 int texel = int(joint * 3u + row);\n" \
+	"	 return mix(texelFetch(animation_palettes, ivec2(texel, frame_from), 0), texelFetch(animation_palettes, ivec2(texel, frame_to), 0), frame_t);\n" \
+	"}\n" \
+	"vec4 joint_row(uint row)\n" \
+	"{\n" \
+	"	 return palette_row(joints.x, row) * weights.x +\n" \
+	"		palette_row(joints.y, row) * weights.y +\n" \
+	"		palette_row(joints.z, row) * weights.z +\n" \
+	"		palette_row(joints.w, row) * (1.0 - weights.x - weights.y - weights.z);\n" \
+	"}\n"
+
+// Palettes sampled from an AnimationTexture, the two frames around animation_time are interpolated so nothing is uploaded per frame
+static const char *vertex_shader_lit_baked_src =
+	"#version 330 core\n"
+	"layout (location = 0) in vec4 position;\n"
+	"layout (location = 1) in vec3 normal;\n"
+	"layout (location = 2) in vec2 uv;\n"
+	"layout (location = 3) in vec4 weights;\n"
+	"layout (location = 4) in uvec4 joints;\n"
+	"out vec3 position_out;\n"
+	"out vec3 normal_out;\n"
+	"out vec2 uv_out;\n"
+	"uniform mat4 model;\n"
+	"uniform mat4 view;\n"
+	"uniform mat4 projection;\n"
+	BAKED_PALETTE_GLSL
+	"void main()\n"
+	"{\n"
+	"	 find_frames(animation_time);\n"
+	"	 mat4 keyframe_transform = transpose(mat4(joint_row(0u), joint_row(1u), joint_row(2u), vec4(0.0, 0.0, 0.0, 1.0)));\n"
+	"	 mat4 model_animated = model * keyframe_transform;\n"
+	"    position_out = vec3(model_animated * position);\n"
+	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
+	"    uv_out = uv;  \n"
+	"    uv_out.y = 1.0 - uv.y;  \n"
+	"    gl_Position = projection * view * vec4(position_out, 1.0);\n"
+	"}\n";
+
+// Baked palettes for the instanced crowd, each instance is animation_time plus its own time into the clip
+static const char *vertex_shader_lit_instanced_baked_src =
+	"#version 330 core\n"
+	"layout (location = 0) in vec4 position;\n"
+	"layout (location = 1) in vec3 normal;\n"
+	"layout (location = 2) in vec2 uv;\n"
+	"layout (location = 3) in vec4 weights;\n"
+	"layout (location = 4) in uvec4 joints;\n"
+	"layout (location = 5) in mat4 model;\n"
+	"layout (location = 10) in float instance_time;\n"
+	"out vec3 position_out;\n"
+	"out vec3 normal_out;\n"
+	"out vec2 uv_out;\n"
+	"uniform mat4 view;\n"
+	"uniform mat4 projection;\n"
+	BAKED_PALETTE_GLSL
+	"void main()\n"
+	"{\n"
+	"	 find_frames(animation_time + instance_time);\n"
+	"	 mat4 keyframe_transform = transpose(mat4(joint_row(0u), joint_row(1u), joint_row(2u), vec4(0.0, 0.0, 0.0, 1.0)));\n"
 	"	 mat4 model_animated = model * keyframe_transform;\n"
 	"    position_out = vec3(model_animated * position);\n"
 	"    normal_out = mat3(transpose(inverse(model))) * normal;  \n"
@@ -140,6 +421,75 @@ static const char *fragment_shader_lit_src =
 void idle()
 {}
 
+// Seconds since the start, simulated in headless runs so they animate the same however long frames take
+double current_time()
+{
+	if (headless_frames_count > 0)
+		return rendered_frames_count * headless_frame_time;
+
+	return glfwGetTime();
+}
+
+// Rows of astro boys standing behind the first one, each a bit further into the clip than the one before
+void setup_crowd()
+{
+	unsigned int joints_count = astro_boy_rig.joints_count();
+
+	// Baked instances read the animation texture and don't need room for palettes
+	crowd_count = astro_boy_skin->enable_instancing(baked_animation ? vertex_shader_lit_instanced_baked_src : vertex_shader_lit_instanced_src, fragment_shader_lit_src,
+													crowd_count, baked_animation ? 0 : joints_count);
+
+	unsigned int columns = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(crowd_count))));
+
+	crowd_players.assign(crowd_count, AnimationPlayer(&astro_boy_clip));
+	crowd_instances.resize(crowd_count);
+
+	if (!baked_animation)
+	{
+		crowd_jobs      = new JobSystem();
+		crowd_animation = new CrowdAnimation<>(astro_boy_rig, *crowd_jobs);
+	}
+
+	auto rotation_x = ror::matrix4_rotation_around_x(ror::to_radians(-90.0f));
+
+	for (unsigned int i = 0; i < crowd_count; ++i)
+	{
+		float x = (static_cast<float>(i % columns) - static_cast<float>(columns - 1) * 0.5f) * 3.0f;
+		float z = -astro_boy_distance - 4.0f - static_cast<float>(i / columns) * 4.0f;
+
+		auto model = ror::matrix4_translation(x, -3.0f, z) * rotation_x;
+
+		std::memcpy(crowd_instances[i].m_model, model.m_values, sizeof(crowd_instances[i].m_model));
+		crowd_instances[i].m_palette_offset = i * joints_count;
+		crowd_instances[i].m_animation_time = astro_boy_clip.loop_duration() * static_cast<float>(i) / static_cast<float>(crowd_count);
+
+		crowd_players[i].seek(crowd_instances[i].m_animation_time);
+	}
+
+	// Baked instances never change, only the time of the draw moves them
+	if (baked_animation)
+		astro_boy_skin->update_instances(nullptr, 0, crowd_instances.data(), crowd_count);
+}
+
+// The crowd skips the lods and the ticks, it animates on the job system with the rest of the frame's animation, touches no GL state
+void animate_crowd(const AnimationRequest &a_request, std::vector<Matrix3x4> &a_palettes)
+{
+	if (!crowd_animation)
+		return;
+
+	a_palettes.resize(crowd_count * astro_boy_rig.joints_count());
+	crowd_animation->update(crowd_players.data(), crowd_count, a_request.m_delta_time, a_palettes.data());
+}
+
+// All the crowd's palettes go up in one buffer
+void upload_crowd(const std::vector<Matrix3x4> &a_palettes)
+{
+	if (a_palettes.empty())
+		return;
+
+	astro_boy_skin->update_instances(a_palettes.data(), static_cast<unsigned int>(a_palettes.size()), crowd_instances.data(), crowd_count);
+}
+
 void setup()
 {
 	glEnable(GL_CULL_FACE);
@@ -153,89 +503,285 @@ void setup()
 
 	cube = create_cube(3.5f, ror::Vector3f(0.0f, 0.0f, 3.5f), vertex_shader_src, fragment_shader_src);
 
+	// Runtime skeleton used by all the per frame code
+	astro_boy_rig    = create_astro_boy_skeleton();
+	astro_boy_clip   = create_astro_boy_clip(astro_boy_rig);
+	astro_boy_player = AnimationPlayer(&astro_boy_clip);
+	astro_boy_frame.m_world_transforms.reserve(astro_boy_rig.size());
+	astro_boy_frame.m_joint_matrices.reserve(astro_boy_rig.joints_count());
+	astro_boy_frame.m_joint_rows.reserve(astro_boy_rig.joints_count());
+	astro_boy_frame.m_joint_dual_quaternions.reserve(astro_boy_rig.joints_count());
+
+	// Baked before any geometry so a clip that doesn't fit a texture can still animate on the CPU
+	if (baked_animation)
+	{
+		astro_boy_animation_texture = new AnimationTexture(BakedClip(astro_boy_rig, astro_boy_clip, 30.0f));
+
+		if (!astro_boy_animation_texture->valid())
+		{
+			std::printf("--baked is ignored, animating on the CPU instead\n");
+
+			delete astro_boy_animation_texture;
+			astro_boy_animation_texture = nullptr;
+			baked_animation             = false;
+		}
+	}
+
 	// setup skeleton and get world matrices
-	auto astro_boy_matrices = get_world_matrices_for_skeleton(astro_boy_tree, astro_boy_nodes_count);
+	auto astro_boy_matrices = get_world_matrices_for_skeleton(astro_boy_rig);
 	astro_boy_skeleton      = get_lines_from_skeleton(astro_boy_matrices, vertex_shader_src, fragment_shader_src);
 
-	std::vector<ror::Matrix4f> astro_boy_joint_matrices;
+	const char *vertex_shader_skin_src = vertex_shader_lit_src;
 
-	for (auto &elem : astro_boy_matrices)
+	if (baked_animation)
+		vertex_shader_skin_src = vertex_shader_lit_baked_src;
+	else if (palette_mode == PaletteMode::affine3x4)
+		vertex_shader_skin_src = vertex_shader_lit_affine_src;
+	else if (palette_mode == PaletteMode::dual_quaternion)
+		vertex_shader_skin_src = vertex_shader_lit_dq_src;
+
+	if (vertex_format == VertexFormat::packed)
 	{
-		if (astro_boy_tree[elem.first].m_type == 1)
-		{
-			astro_boy_joint_matrices.push_back(elem.second.second * get_ror_matrix4(astro_boy_tree[elem.first].m_inverse));
-		}
+		auto vertices = pack_skinned_vertices(astro_boy_positions, astro_boy_normals, astro_boy_uvs, astro_boy_weights, astro_boy_joints,
+											  astro_boy_weights_array_count / astro_boy_vertex_count, astro_boy_vertex_count);
+
+		astro_boy_skin = new AnimatedGeometry(vertex_shader_skin_src, fragment_shader_lit_src, "astro_boy.jpg", vertices,
+											  sizeof(float) * astro_boy_indices_array_count, astro_boy_indices,
+											  astro_boy_indices_array_count, astro_boy_rig.joints_count(), palette_mode);
+	}
+	else
+		astro_boy_skin = new AnimatedGeometry(vertex_shader_skin_src, fragment_shader_lit_src, "astro_boy.jpg",
+											  sizeof(float) * astro_boy_positions_array_count, astro_boy_positions,
+											  sizeof(float) * astro_boy_normals_array_count, astro_boy_normals,
+											  sizeof(float) * astro_boy_uvs_array_count, astro_boy_uvs,
+											  sizeof(float) * astro_boy_weights_array_count, astro_boy_weights,
+											  sizeof(int) * astro_boy_joints_array_count, astro_boy_joints,
+											  sizeof(float) * astro_boy_indices_array_count, astro_boy_indices,
+											  astro_boy_indices_array_count, astro_boy_rig.joints_count(), palette_mode);
+
+	if (persistent_palette && !baked_animation && buffer_storage_supported())
+	{
+		palette_ring = new PaletteRing(astro_boy_skin->palette_size());
+		astro_boy_skin->set_palette_ring(palette_ring);
+	}
+
+	// Each level has its own remapped joint indices matching its compact palette
+	astro_boy_lod = AnimationLod(astro_boy_rig, get_astro_boy_lod_levels());
+
+	for (unsigned int level = 0; level < astro_boy_lod.levels_count(); ++level)
+	{
+		auto joints = astro_boy_lod.remap_vertex_joints(level, astro_boy_joints, astro_boy_joints_array_count);
+		astro_boy_skin_joint_lods.push_back(astro_boy_skin->add_joint_lod(sizeof(int) * astro_boy_joints_array_count, joints.data()));
 	}
 
-	astro_boy_skin = new AnimatedGeometry(vertex_shader_lit_src, fragment_shader_lit_src, "astro_boy.jpg",
-										  sizeof(float) * astro_boy_positions_array_count, astro_boy_positions,
-										  sizeof(float) * astro_boy_normals_array_count, astro_boy_normals,
-										  sizeof(float) * astro_boy_uvs_array_count, astro_boy_uvs,
-										  sizeof(float) * astro_boy_weights_array_count, astro_boy_weights,
-										  sizeof(int) * astro_boy_joints_array_count, astro_boy_joints,
-										  sizeof(float) * astro_boy_indices_array_count, astro_boy_indices,
-										  astro_boy_indices_array_count);
+	switch (palette_mode)
+	{
+		case PaletteMode::matrix4:
+			get_joint_matrices(astro_boy_rig, astro_boy_frame.m_joint_matrices);
+			astro_boy_skin->update_matrices(astro_boy_frame.m_joint_matrices);
+			break;
+		case PaletteMode::affine3x4:
+			get_joint_matrices(astro_boy_rig, astro_boy_frame.m_joint_rows);
+			astro_boy_skin->update_matrices(astro_boy_frame.m_joint_rows);
+			break;
+		case PaletteMode::dual_quaternion:
+			get_joint_matrices(astro_boy_rig, astro_boy_frame.m_joint_dual_quaternions);
+			astro_boy_skin->update_matrices(astro_boy_frame.m_joint_dual_quaternions);
+			break;
+	}
+
+	if (crowd_count > 0)
+		setup_crowd();
+
+	// After the crowd so its instanced draws sample the texture too
+	if (baked_animation)
+		astro_boy_animation_texture->attach(*astro_boy_skin);
+}
+
+// Advances the character and builds its palette into a_frame, touches no GL state so it can run on another thread
+void animate_palette(const AnimationRequest &a_request, FramePalette &a_frame)
+{
+	astro_boy_player.advance(a_request.m_delta_time);
+
+	unsigned int level = astro_boy_lod.select(lod_screen_size(astro_boy_height, a_request.m_distance, ror::to_radians(60.0f)));
+
+	// A level change needs a new palette straight away, it doesn't match the other level's joint indices
+	// The frame counts up every frame, even on a level change, so the update cadence doesn't drift
+	unsigned int frame = frame_index++;
+	a_frame.m_updated  = level != astro_boy_lod_level || astro_boy_lod.needs_update(level, frame);
+
+	if (!a_frame.m_updated)
+		return;
 
-	astro_boy_skin->update_matrices(astro_boy_joint_matrices);
+	astro_boy_lod_level = level;
+	a_frame.m_level     = level;
+
+	evaluate_world_transforms(astro_boy_rig, astro_boy_player, astro_boy_lod, level, a_frame.m_world_transforms);
+
+	switch (palette_mode)
+	{
+		case PaletteMode::matrix4:
+			get_joint_matrices(astro_boy_rig, a_frame.m_world_transforms, astro_boy_lod, level, a_frame.m_joint_matrices);
+			break;
+		case PaletteMode::affine3x4:
+			get_joint_matrices(astro_boy_rig, a_frame.m_world_transforms, astro_boy_lod, level, a_frame.m_joint_rows);
+			break;
+		case PaletteMode::dual_quaternion:
+			get_joint_matrices(astro_boy_rig, a_frame.m_world_transforms, astro_boy_lod, level, a_frame.m_joint_dual_quaternions);
+			break;
+	}
 }
 
-std::pair<unsigned int, double> get_keyframe_time()
+// Pipelined frames can be dropped, a lod skip replacing a dropped update would leave the palette of the frame before that uploaded
+// The crowd palettes of a_frame are newer and stay
+void supersede_palette(FramePalette &a_frame, const FramePalette &a_dropped)
 {
-	double new_time = 0.0;
+	if (!a_dropped.m_updated || a_frame.m_updated)
+		return;
 
-	if (do_animate)
-		new_time = glfwGetTime();
+	a_frame.m_world_transforms       = a_dropped.m_world_transforms;
+	a_frame.m_joint_matrices         = a_dropped.m_joint_matrices;
+	a_frame.m_joint_rows             = a_dropped.m_joint_rows;
+	a_frame.m_joint_dual_quaternions = a_dropped.m_joint_dual_quaternions;
+	a_frame.m_level                  = a_dropped.m_level;
+	a_frame.m_updated                = true;
+}
 
-	auto delta = new_time - old_time;
+// The whole animation of a pipelined frame, runs on the animation thread
+void animate_frame(const AnimationRequest &a_request, FramePalette &a_frame)
+{
+	animate_palette(a_request, a_frame);
+	animate_crowd(a_request, a_frame.m_crowd_palettes);
+}
 
-	// Note this is very specific to AstroBoy
-	static double accumulate_time  = 0.0;
-	static int    current_keyframe = 0;
-	const double  pf               = 1.166670 / 36.0;
+void upload_palette(const FramePalette &a_frame)
+{
+	if (!a_frame.m_updated)
+		return;
 
-	accumulate_time += delta;
-	if (do_animate)
-		current_keyframe = accumulate_time / pf;
+	astro_boy_skin->set_joint_lod(astro_boy_skin_joint_lods[a_frame.m_level]);
 
-	if (accumulate_time > 1.66670 || (current_keyframe > astro_boy_animation_keyframes_count - 5))        // Last 5 frames don't quite work with the animation loop, so ignored
+	switch (palette_mode)
 	{
-		accumulate_time  = 0.0;
-		current_keyframe = 0;
+		case PaletteMode::matrix4:
+			astro_boy_skin->update_matrices(a_frame.m_joint_matrices);
+			break;
+		case PaletteMode::affine3x4:
+			astro_boy_skin->update_matrices(a_frame.m_joint_rows);
+			break;
+		case PaletteMode::dual_quaternion:
+			astro_boy_skin->update_matrices(a_frame.m_joint_dual_quaternions);
+			break;
 	}
+}
+
+// Time since the last request and the camera distance of get_mvp
+AnimationRequest animation_request()
+{
+	double new_time = current_time();
+	auto   delta    = new_time - old_time;
 
 	old_time = new_time;
 
-	return std::make_pair(current_keyframe, delta);
+	return AnimationRequest{do_animate ? static_cast<float>(delta) : 0.0f, std::sqrt(36.0f + astro_boy_distance * astro_boy_distance)};
 }
 
-void animate()
+// Palettes of the last two updates are interpolated, drawing lags up to an update behind the animation
+// Lod levels that skip ticks update every few ticks, the interpolation spans all the ticks between the two updates
+void animate_ticks(const AnimationRequest &a_request)
 {
-	std::vector<ror::Matrix4f> astro_boy_joint_matrices;
-	astro_boy_joint_matrices.reserve(astro_boy_nodes_count);
+	const unsigned int max_ticks = 4;        // After a long stall the rest are dropped instead of catching up
+	float              tick      = 1.0f / animation_tick_rate;
+
+	astro_boy_tick_time += a_request.m_delta_time;
+
+	for (unsigned int ticks = 0; astro_boy_tick_time >= tick; ++ticks)
+	{
+		if (ticks == max_ticks)
+		{
+			astro_boy_tick_time = std::fmod(astro_boy_tick_time, tick);
+			break;
+		}
+
+		astro_boy_tick_time -= tick;
+		++astro_boy_ticks_since_update;
+
+		animate_palette(AnimationRequest{tick, a_request.m_distance}, astro_boy_tick_frame);
+
+		// The lod skipped this tick, the last two updates stay
+		if (!astro_boy_tick_frame.m_updated)
+			continue;
+
+		std::swap(astro_boy_previous_frame, astro_boy_frame);
+		std::swap(astro_boy_frame, astro_boy_tick_frame);
+
+		astro_boy_update_ticks       = astro_boy_ticks_since_update;
+		astro_boy_ticks_since_update = 0;
+	}
 
-	auto [current_keyframe, delta_time] = get_keyframe_time();
+	// Nothing to interpolate from before the second update or across a lod level change
+	if (!astro_boy_previous_frame.m_updated || astro_boy_previous_frame.m_level != astro_boy_frame.m_level)
+	{
+		upload_palette(astro_boy_frame);
+		return;
+	}
+
+	float t = std::min((static_cast<float>(astro_boy_ticks_since_update) * tick + astro_boy_tick_time) / (static_cast<float>(astro_boy_update_ticks) * tick), 1.0f);
+
+	switch (palette_mode)
+	{
+		case PaletteMode::matrix4:
+			interpolate_joint_matrices(astro_boy_previous_frame.m_joint_matrices, astro_boy_frame.m_joint_matrices, t, astro_boy_blended_frame.m_joint_matrices);
+			break;
+		case PaletteMode::affine3x4:
+			interpolate_joint_matrices(astro_boy_previous_frame.m_joint_rows, astro_boy_frame.m_joint_rows, t, astro_boy_blended_frame.m_joint_rows);
+			break;
+		case PaletteMode::dual_quaternion:
+			interpolate_joint_matrices(astro_boy_previous_frame.m_joint_dual_quaternions, astro_boy_frame.m_joint_dual_quaternions, t, astro_boy_blended_frame.m_joint_dual_quaternions);
+			break;
+	}
+
+	astro_boy_blended_frame.m_level   = astro_boy_frame.m_level;
+	astro_boy_blended_frame.m_updated = true;
+
+	upload_palette(astro_boy_blended_frame);
+}
+
+void animate()
+{
+	// Baked palettes only need the clip time
+	if (baked_animation)
+	{
+		// Wrapped so float precision doesn't run out after hours of play
+		astro_boy_baked_time = std::fmod(astro_boy_baked_time + animation_request().m_delta_time, astro_boy_animation_texture->duration());
+		astro_boy_skin->set_animation_time(astro_boy_baked_time);
+		return;
+	}
 
-	auto astro_boy_matrices = get_world_matrices_for_skinning(astro_boy_tree, astro_boy_nodes_count, current_keyframe, delta_time);
+	AnimationRequest request = animation_request();
 
-	for (size_t i = 0; i < astro_boy_matrices.size(); ++i)
+	if (animation_tick_rate > 0.0f)
+		animate_ticks(request);
+	else
 	{
-		if (astro_boy_tree[i].m_type == 1)
-			astro_boy_joint_matrices.push_back(astro_boy_matrices[i] * get_ror_matrix4(astro_boy_tree[i].m_inverse));
+		animate_palette(request, astro_boy_frame);
+		upload_palette(astro_boy_frame);
 	}
 
-	astro_boy_skin->update_matrices(astro_boy_joint_matrices);
+	animate_crowd(request, crowd_palettes);
+	upload_crowd(crowd_palettes);
 }
 
 void get_mvp(ror::Matrix4f &out_model, ror::Matrix4f &out_view, ror::Matrix4f &out_projection)
 {
 	static float current_rotation = 0.0f;
 
-	current_rotation = do_animate ? static_cast<float>(glfwGetTime() * 70.0f) : current_rotation;
+	current_rotation = do_animate ? static_cast<float>(current_time() * 70.0f) : current_rotation;
 
 	// Rotation around X to bring Y-Up
 	auto rotation_x = ror::matrix4_rotation_around_x(ror::to_radians(-90.0f));
 
-	auto translation = ror::matrix4_translation(0.0f, -3.0f, -10.0f);
+	auto translation = ror::matrix4_translation(0.0f, -3.0f, -astro_boy_distance);
 	auto rotation_y  = ror::matrix4_rotation_around_y(ror::to_radians(current_rotation));
 	out_projection   = ror::make_perspective(ror::to_radians(60.0f), aspect_ratio, 0.5f, 100.0f);
 	out_view         = ror::make_look_at(ror::Vector3f(0.0f, 3.0f, 0.0f), ror::Vector3f(0.0f, 0.0f, -10.0f), ror::Vector3f(0.0f, 1.0f, 0.0f));
@@ -259,6 +805,9 @@ void display()
 	if (show_skin)
 		astro_boy_skin->draw(model.m_values, view.m_values, projection.m_values, GL_TRIANGLES);
 
+	if (show_skin && crowd_count > 0)
+		astro_boy_skin->draw_instanced(view.m_values, projection.m_values, crowd_count, GL_TRIANGLES);
+
 	if (show_skeleton)
 		astro_boy_skeleton->draw(mvp.m_values, GL_LINES);
 }
@@ -298,8 +847,12 @@ void key(GLFWwindow *window, int k, int s, int action, int mods)
 			show_cube = true;
 			break;
 		case GLFW_KEY_W:
+			if (action != GLFW_RELEASE)
+				astro_boy_distance += 5.0f;
 			break;
 		case GLFW_KEY_S:
+			if (action != GLFW_RELEASE)
+				astro_boy_distance = std::max(astro_boy_distance - 5.0f, 10.0f);
 			break;
 		case GLFW_KEY_R:
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -326,10 +879,8 @@ void resize(GLFWwindow *window, int width, int height)
 	aspect_ratio = static_cast<float>(width_) / static_cast<float>(height_);
 }
 
-int main(int argc, char **argv)
+void open_window()
 {
-	GLFWwindow *window;
-
 	if (!glfwInit())
 	{
 		fprintf(stderr, "Failed to initialize GLFW\n");
@@ -352,32 +903,176 @@ int main(int argc, char **argv)
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
 
-	window = glfwCreateWindow(SCR_Width, SCR_Height, "Simple Skeletal Animation", NULL, NULL);
+	main_window = glfwCreateWindow(SCR_Width, SCR_Height, "Simple Skeletal Animation", NULL, NULL);
 
-	if (!window)
+	if (!main_window)
 	{
 		fprintf(stderr, "Failed to open GLFW window\n");
 		glfwTerminate();
 		exit(EXIT_FAILURE);
 	}
 
-	glfwMakeContextCurrent(window);
+	glfwMakeContextCurrent(main_window);
 	glfwSwapInterval(0);
 
-	glfwSetKeyCallback(window, key);
-	glfwSetWindowSizeCallback(window, resize);
+	glfwSetKeyCallback(main_window, key);
+	glfwSetWindowSizeCallback(main_window, resize);
+}
 
-	setup();
+// Runs frames until the window is closed or all headless frames are done, a_animate(first) gets the palette of each frame ready
+// Headless runs print how long each phase took
+template <typename _animate>
+void run_frames(_animate &&a_animate)
+{
+	typedef std::chrono::steady_clock clock;
+
+	PhaseTimings animate_timings("animate"), display_timings("display"), swap_timings("swap"), frame_timings("frame");
 
-	// Main loop
-	while (!glfwWindowShouldClose(window))
+	auto milliseconds = [](clock::time_point a_from, clock::time_point a_to) { return std::chrono::duration<double, std::milli>(a_to - a_from).count(); };
+	auto run_start    = clock::now();
+
+	for (rendered_frames_count = 0; headless_frames_count > 0 ? rendered_frames_count < headless_frames_count : !glfwWindowShouldClose(main_window); ++rendered_frames_count)
 	{
-		animate();
+		auto start = clock::now();
+
+		// Palettes are written into the ring while animating, so its frame starts before and ends after the draws
+		if (palette_ring)
+			palette_ring->begin_frame();
+
+		a_animate(rendered_frames_count == 0);
+
+		auto animated = clock::now();
+
 		display();
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if (palette_ring)
+			palette_ring->end_frame();
+
+		auto displayed = clock::now();
+
+		if (headless_frames_count > 0)
+			headless_context.swap();
+		else
+		{
+			glfwSwapBuffers(main_window);
+			glfwPollEvents();
+		}
+
+		auto swapped = clock::now();
+
+		animate_timings.add(milliseconds(start, animated));
+		display_timings.add(milliseconds(animated, displayed));
+		swap_timings.add(milliseconds(displayed, swapped));
+		frame_timings.add(milliseconds(start, swapped));
+	}
+
+	if (headless_frames_count > 0)
+	{
+		double run_time = milliseconds(run_start, clock::now());
+
+		std::printf("%u frames of %g simulated seconds in %.1f ms, %.1f fps\n", rendered_frames_count, headless_frame_time, run_time, rendered_frames_count / run_time * 1e3);
+		std::printf("%-12s %10s %10s %10s %10s\n", "ms", "mean", "median", "99th", "max");
+
+		animate_timings.print();
+		display_timings.print();
+		swap_timings.print();
+		frame_timings.print();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+		return run_benchmarks() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	const char *palette_flag = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--mat4-palette") == 0)
+		{
+			palette_mode = PaletteMode::matrix4;
+			palette_flag = argv[i];
+		}
+		else if (std::strcmp(argv[i], "--affine-palette") == 0)
+		{
+			palette_mode = PaletteMode::affine3x4;
+			palette_flag = argv[i];
+		}
+		else if (std::strcmp(argv[i], "--dq-palette") == 0)
+		{
+			palette_mode = PaletteMode::dual_quaternion;
+			palette_flag = argv[i];
+		}
+		else if (std::strcmp(argv[i], "--pipelined") == 0)
+			pipeline_slots_count = 3;
+		else if (std::strcmp(argv[i], "--pipelined-double") == 0)
+			pipeline_slots_count = 2;
+		else if (std::strcmp(argv[i], "--subdata-palette") == 0)
+			persistent_palette = false;
+		else if (std::strcmp(argv[i], "--separate-vertices") == 0)
+			vertex_format = VertexFormat::separate;
+		else if (std::strcmp(argv[i], "--baked") == 0)
+			baked_animation = true;
+		else if (std::strcmp(argv[i], "--crowd") == 0 && i + 1 < argc)
+			crowd_count = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+		else if (std::strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+			animation_tick_rate = static_cast<float>(std::atof(argv[++i]));
+		else if (std::strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+			headless_frames_count = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 1));
+		else if (std::strcmp(argv[i], "--frame-time") == 0 && i + 1 < argc)
+			headless_frame_time = std::atof(argv[++i]);
+	}
+
+	// Baked palettes are always affine rows in the animation texture
+	if (baked_animation && palette_flag)
+		std::printf("%s is ignored with --baked, baked palettes are affine rows sampled from a texture\n", palette_flag);
+
+	// Pipelined and baked frames animate once per frame
+	if (animation_tick_rate > 0.0f && (baked_animation || pipeline_slots_count > 0))
+		std::printf("--tick-rate is ignored with %s\n", baked_animation ? "--baked" : "--pipelined");
+
+	if (headless_frames_count > 0)
+	{
+		if (!headless_context.create(SCR_Width, SCR_Height))
+			exit(EXIT_FAILURE);
+
+		aspect_ratio = static_cast<float>(SCR_Width) / static_cast<float>(SCR_Height);
+	}
+	else
+		open_window();
+
+	setup();
+
+	if (pipeline_slots_count > 0 && !baked_animation)
+	{
+		// From here on only the animation thread touches the players and the lod state
+		FramePipeline<AnimationRequest, FramePalette> pipeline(animate_frame, pipeline_slots_count, supersede_palette);
+
+		pipeline.submit(animation_request());
+
+		run_frames([&pipeline](bool a_first) {
+			// Latest completed palette, only the very first frame has to wait for one, otherwise the previous upload stays
+			const FramePalette *frame = pipeline.acquire(a_first);
+
+			if (frame)
+			{
+				upload_palette(*frame);
+				upload_crowd(frame->m_crowd_palettes);
+				pipeline.release();
+			}
+
+			// Next frame animates while this one renders and swaps
+			pipeline.submit(animation_request());
+		});
+	}
+	else
+		run_frames([](bool) { animate(); });
+
+	if (headless_frames_count > 0)
+	{
+		headless_context.destroy();
+		return 0;
 	}
 
 	// Terminate GLFW
@@ -25,14 +25,26 @@
 #pragma once
 
 #include "astro_boy_animation.hpp"
+#include "astro_boy_animation_curves.hpp"
 #include "astro_boy_geometry.hpp"
+#include "animation_clip.hpp"
+#include "animation_lod.hpp"
+#include "animation_track.hpp"
+#include "curve_track.hpp"
 #include "geometry.hpp"
 #include "math/rorvector3.hpp"
+#include "pose_blend.hpp"
+#include "simd_kernels.hpp"
+#include "skeleton.hpp"
+#include "transform.hpp"
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <iostream>
 #include <map>
 
+static_assert(sizeof(ror::Matrix4f) == sizeof(float) * 16, "SIMD kernels expect tightly packed ror::Matrix4f arrays");
+
 ror::Matrix4f get_ror_matrix4(ColladaMatrix &mat)
 {
 	ror::Matrix4f matrix;
@@ -45,45 +57,109 @@ ror::Matrix4f get_ror_matrix4(ColladaMatrix &mat)
 	return matrix.transposed();
 }
 
-ror::Matrix4f get_animated_transform(AstroBoyTreePtr a_node, unsigned int a_index, unsigned int a_keyframe_prev, double a_delta_time)
+// Samples the dense track table and falls back to the local bind transforms of the runtime skeleton
+Transform get_animated_transform(const Skeleton &a_skeleton, const TrackTable &a_tracks, unsigned int a_index, const KeyframeSpan &a_span)
 {
-	if (astro_boy_animation_keyframe_matrices.find(a_index) != astro_boy_animation_keyframe_matrices.end())
-	{
-		assert(a_keyframe_prev + 1 < astro_boy_animation_keyframes_count);
+	int track = a_tracks.track(a_index);
+
+	if (track != -1)
+		return a_tracks.sample(track, a_span);
+
+	return a_skeleton.local_bind(a_index);
+}
 
-		float a = astro_boy_animation_keyframe_times[a_keyframe_prev];
-		float b = astro_boy_animation_keyframe_times[a_keyframe_prev + 1];
-		float t = a_delta_time / (b - a);
+// Same as above for the keyframe reduced curves
+Transform get_animated_transform(const Skeleton &a_skeleton, const CurveTrackTable &a_tracks, unsigned int a_index, float a_time)
+{
+	int track = a_tracks.track(a_index);
+
+	if (track != -1)
+		return a_tracks.sample(track, a_time);
+
+	return a_skeleton.local_bind(a_index);
+}
 
-		return ror::matrix4_interpolate(get_ror_matrix4(astro_boy_animation_keyframe_matrices[a_index][a_keyframe_prev]),
-										get_ror_matrix4(astro_boy_animation_keyframe_matrices[a_index][a_keyframe_prev + 1]), t);
+// Creates the runtime skeleton from the tree, should only be done once at load time
+// This is the only place the static collada matrices are converted, everything else reads the converted copies
+Skeleton create_skeleton(AstroBoyTreePtr a_node, unsigned int a_nodes_count, ColladaMatrix &a_bind_shape)
+{
+	Skeleton skeleton;
+	skeleton.reserve(a_nodes_count);
+	skeleton.set_bind_shape(get_ror_matrix4(a_bind_shape));
+
+	for (unsigned int i = 0; i < a_nodes_count; ++i)
+	{
+		assert(a_node[i].m_index == static_cast<int>(i));
+
+		auto local_bind = get_ror_matrix4(a_node[i].m_transform);
+		skeleton.add_node(a_node[i].m_name, a_node[i].m_parent_id, a_node[i].m_type == 1,
+						  transform_from_matrix(local_bind), local_bind, get_ror_matrix4(a_node[i].m_inverse));
 	}
-	else
+
+	return skeleton;
+}
+
+// Decomposes all keyframe matrices into a dense track table, should only be done once at load time
+TrackTable create_track_table(const Skeleton &a_skeleton, std::map<unsigned int, std::vector<ColladaMatrix>> &a_keyframe_matrices, unsigned int a_keyframes_count)
+{
+	TrackTable             tracks(a_skeleton.size(), a_keyframes_count, static_cast<unsigned int>(a_keyframe_matrices.size()));
+	std::vector<Transform> keyframes;
+
+	for (auto &node : a_keyframe_matrices)
 	{
-		return get_ror_matrix4(a_node[a_index].m_transform);
+		keyframes.clear();
+
+		for (auto &matrix : node.second)
+			keyframes.push_back(transform_from_matrix(get_ror_matrix4(matrix)));
+
+		tracks.add_track(node.first, keyframes);
 	}
 
-	return ror::Matrix4f();
+	return tracks;
 }
 
-// Recursive function to get valid parent matrix, This is very unoptimised
-// These matrices are calculated for each node, It should be cached instead, and have an iterative solution to it
-ror::Matrix4f get_world_matrix(AstroBoyTreePtr a_node, unsigned int a_index)
+// Astro boy runtime skeleton and its dense looping clip, what the demo and the benchmarks animate
+Skeleton create_astro_boy_skeleton()
 {
-	if (a_node[a_index].m_parent_id == -1)
-		return get_ror_matrix4(a_node[a_index].m_transform);
-	else
-		return get_world_matrix(a_node, a_node[a_index].m_parent_id) * get_ror_matrix4(a_node[a_index].m_transform);
+	return create_skeleton(astro_boy_tree, astro_boy_nodes_count, astro_boy_skeleton_bind_shape_matrix);
+}
+
+TrackTable create_astro_boy_track_table(const Skeleton &a_skeleton)
+{
+	return create_track_table(a_skeleton, astro_boy_animation_keyframe_matrices, astro_boy_animation_keyframes_count);
+}
+
+AnimationClip create_astro_boy_clip(const Skeleton &a_skeleton)
+{
+	return AnimationClip(create_astro_boy_track_table(a_skeleton), astro_boy_animation_keyframe_times);
+}
+
+// Keyframe reduced astro boy tracks written out by the generator, already decomposed so this is only a copy
+CurveTrackTable create_astro_boy_curve_track_table(const Skeleton &a_skeleton)
+{
+	return CurveTrackTable(a_skeleton.size(), astro_boy_curve_tracks, astro_boy_curve_tracks_count,
+						   astro_boy_curve_rotation_times, astro_boy_curve_rotation_values, astro_boy_curve_rotation_keys_count,
+						   astro_boy_curve_translation_times, astro_boy_curve_translation_values, astro_boy_curve_translation_keys_count,
+						   astro_boy_curve_scale_times, astro_boy_curve_scale_values, astro_boy_curve_scale_keys_count);
+}
+
+// Animation lods of astro boy, fingers go first, then the whole hands and the toes
+// The fingers have no tracks in this clip, so only the last level drops animated nodes and samples fewer tracks
+std::vector<AnimationLodLevel> get_astro_boy_lod_levels()
+{
+	return {{0.3f, 1, {}},
+			{0.12f, 2, {"*End", "*pinky*", "*index*"}},
+			{0.0f, 4, {"*End", "*wrist", "*toeBall"}}};
 }
 
 // Recursive function to get valid parent matrix, This is very unoptimised
 // These matrices are calculated for each node, It should be cached instead, and have an iterative solution to it
-ror::Matrix4f get_world_matrix_animated(AstroBoyTreePtr a_node, unsigned int a_index, unsigned int a_keyframe_prev, double a_delta_time)
+ror::Matrix4f get_world_matrix(AstroBoyTreePtr a_node, unsigned int a_index)
 {
 	if (a_node[a_index].m_parent_id == -1)
-		return get_animated_transform(a_node, a_index, a_keyframe_prev, a_delta_time);
+		return get_ror_matrix4(a_node[a_index].m_transform);
 	else
-		return get_world_matrix_animated(a_node, a_node[a_index].m_parent_id, a_keyframe_prev, a_delta_time) * get_animated_transform(a_node, a_index, a_keyframe_prev, a_delta_time);
+		return get_world_matrix(a_node, a_node[a_index].m_parent_id) * get_ror_matrix4(a_node[a_index].m_transform);
 }
 
 std::map<int, std::pair<int, ror::Matrix4f>> get_world_matrices_for_skeleton(AstroBoyTreePtr root, unsigned int joint_count)
@@ -100,21 +176,215 @@ std::map<int, std::pair<int, ror::Matrix4f>> get_world_matrices_for_skeleton(Ast
 	return world_matrices;
 }
 
-std::vector<ror::Matrix4f> get_world_matrices_for_skinning(AstroBoyTreePtr root, unsigned int joint_count, unsigned int a_keyframe_prev, double a_delta_time)
+// Same as above but reads the rest pose cached in the runtime skeleton, no recursion or conversions
+std::map<int, std::pair<int, ror::Matrix4f>> get_world_matrices_for_skeleton(const Skeleton &a_skeleton)
 {
-	std::vector<ror::Matrix4f> world_matrices;
-	world_matrices.reserve(joint_count);
+	std::map<int, std::pair<int, ror::Matrix4f>> world_matrices;
 
-	for (unsigned int i = 0; i < joint_count; ++i)
+	for (unsigned int i = 0; i < a_skeleton.size(); ++i)
 	{
-		auto matrix = get_world_matrix_animated(root, i, a_keyframe_prev, a_delta_time);
-		matrix      = matrix * get_ror_matrix4(astro_boy_skeleton_bind_shape_matrix);        // at the moment bind_shape is identity
-		world_matrices.push_back(matrix);
+		if (a_skeleton.bind_shape_identity())
+			world_matrices[i] = std::make_pair(a_skeleton.parent(i), a_skeleton.rest_matrix(i));
+		else
+			world_matrices[i] = std::make_pair(a_skeleton.parent(i), a_skeleton.rest_matrix(i) * a_skeleton.bind_shape());
 	}
 
 	return world_matrices;
 }
 
+// Rest pose palette, rest * bind shape * inverse bind for each joint in node order
+void get_joint_matrices(const Skeleton &a_skeleton, std::vector<ror::Matrix4f> &a_joint_matrices)
+{
+	a_joint_matrices.resize(a_skeleton.joints_count());
+
+	for (unsigned int i = 0, j = 0; i < a_skeleton.size(); ++i)
+	{
+		if (a_skeleton.is_joint(i))
+			a_joint_matrices[j++] = a_skeleton.rest_matrix(i);
+	}
+
+	simd_kernels().m_matrix4_multiply_batch(a_joint_matrices.data()->m_values, a_skeleton.joint_inverse_binds()->m_values,
+											a_joint_matrices.data()->m_values, a_skeleton.joints_count());
+}
+
+// Affine rest palette
+void get_joint_matrices(const Skeleton &a_skeleton, std::vector<Matrix3x4> &a_joint_matrices)
+{
+	std::vector<ror::Matrix4f> joint_matrices;
+	get_joint_matrices(a_skeleton, joint_matrices);
+
+	a_joint_matrices.resize(joint_matrices.size());
+	for (size_t i = 0; i < joint_matrices.size(); ++i)
+		a_joint_matrices[i] = matrix3x4_from_matrix4(joint_matrices[i]);
+}
+
+// Dual quaternion rest palette
+void get_joint_matrices(const Skeleton &a_skeleton, std::vector<DualQuaternion> &a_joint_matrices)
+{
+	std::vector<ror::Matrix4f> joint_matrices;
+	get_joint_matrices(a_skeleton, joint_matrices);
+
+	a_joint_matrices.resize(joint_matrices.size());
+	for (size_t i = 0; i < joint_matrices.size(); ++i)
+		a_joint_matrices[i] = dual_quaternion_from_transform(transform_from_matrix(joint_matrices[i]));
+}
+
+// Hierarchy pass over the a_nodes_count nodes a_node(0), a_node(1) ..., which must come parent before child
+// a_local(i) fetches the local transform of node i, world transforms of nodes not visited are left as they were
+template <typename _node_function, typename _local_function>
+void evaluate_hierarchy(const Skeleton &a_skeleton, unsigned int a_nodes_count, _node_function a_node, _local_function a_local, std::vector<Transform> &a_world_transforms)
+{
+	a_world_transforms.resize(a_skeleton.size());
+
+	for (unsigned int k = 0; k < a_nodes_count; ++k)
+	{
+		unsigned int i      = a_node(k);
+		auto         parent = a_skeleton.parent(i);
+		auto         local  = a_local(i);
+
+		if (parent == -1)
+			a_world_transforms[i] = local;
+		else
+			a_world_transforms[i] = transform_multiply(a_world_transforms[parent], local);
+	}
+}
+
+// Skeleton nodes are already parent before child so a linear walk is enough
+// The pose is carried through the hierarchy as decomposed transforms, only converted to matrices for the palette
+template <typename _local_function>
+void evaluate_hierarchy(const Skeleton &a_skeleton, _local_function a_local, std::vector<Transform> &a_world_transforms)
+{
+	evaluate_hierarchy(a_skeleton, a_skeleton.size(), [](unsigned int a_index) { return a_index; }, a_local, a_world_transforms);
+}
+
+void evaluate_world_transforms(const Skeleton &a_skeleton, const TrackTable &a_tracks, const KeyframeSpan &a_span, std::vector<Transform> &a_world_transforms)
+{
+	evaluate_hierarchy(a_skeleton, [&](unsigned int a_index) { return get_animated_transform(a_skeleton, a_tracks, a_index, a_span); }, a_world_transforms);
+}
+
+// Pose of the keyframe reduced curves at a_time, which must be within the keys, no wrap around segment
+void evaluate_world_transforms(const Skeleton &a_skeleton, const CurveTrackTable &a_tracks, float a_time, std::vector<Transform> &a_world_transforms)
+{
+	evaluate_hierarchy(a_skeleton, [&](unsigned int a_index) { return get_animated_transform(a_skeleton, a_tracks, a_index, a_time); }, a_world_transforms);
+}
+
+// Hierarchy pass for a blended local pose from PoseBlender
+void evaluate_world_transforms(const Skeleton &a_skeleton, const LocalPose &a_pose, std::vector<Transform> &a_world_transforms)
+{
+	evaluate_hierarchy(a_skeleton, [&](unsigned int a_index) { return a_pose.get(a_index); }, a_world_transforms);
+}
+
+// Pose of a_player's clip at its current time
+void evaluate_world_transforms(const Skeleton &a_skeleton, AnimationPlayer &a_player, std::vector<Transform> &a_world_transforms)
+{
+	evaluate_world_transforms(a_skeleton, a_player.clip()->tracks(), a_player.sample(), a_world_transforms);
+}
+
+// Only evaluates the nodes kept by a_level of a_lod, world transforms of dropped nodes are left as they were
+void evaluate_world_transforms(const Skeleton &a_skeleton, AnimationPlayer &a_player, const AnimationLod &a_lod, unsigned int a_level,
+							   std::vector<Transform> &a_world_transforms)
+{
+	const TrackTable            &tracks = a_player.clip()->tracks();
+	const std::vector<uint16_t> &nodes  = a_lod.nodes(a_level);
+	KeyframeSpan                 span   = a_player.sample();
+
+	evaluate_hierarchy(a_skeleton, static_cast<unsigned int>(nodes.size()), [&](unsigned int a_index) { return nodes[a_index]; },
+					   [&](unsigned int a_index) { return get_animated_transform(a_skeleton, tracks, a_index, span); }, a_world_transforms);
+}
+
+// Skinning palette entry of joint a_joint posed at a_world, world * bind shape * inverse bind
+// Bind shape is already folded into the inverse binds of the skeleton
+void get_joint_matrix(const Skeleton &a_skeleton, const Transform &a_world, unsigned int a_joint, ror::Matrix4f &a_joint_matrix)
+{
+	simd_kernels().m_matrix4_multiply_affine(transform_to_matrix(a_world).m_values, a_skeleton.joint_inverse_bind(a_joint).m_values, a_joint_matrix.m_values);
+}
+
+// Affine palette entry, same as above with only the top three rows of the matrix stored row-major
+void get_joint_matrix(const Skeleton &a_skeleton, const Transform &a_world, unsigned int a_joint, Matrix3x4 &a_joint_matrix)
+{
+	a_joint_matrix = matrix3x4_multiply(transform_to_matrix3x4(a_world), a_skeleton.joint_inverse_bind(a_joint));
+}
+
+// Dual quaternion palette entry built straight from the quaternion pose without going through matrices
+// Scale in the pose or inverse binds is ignored, which is fine for rigid rigs like astro boy
+void get_joint_matrix(const Skeleton &a_skeleton, const Transform &a_world, unsigned int a_joint, DualQuaternion &a_joint_matrix)
+{
+	a_joint_matrix = dual_quaternion_from_transform(transform_multiply(a_world, a_skeleton.joint_inverse_bind_transform(a_joint)));
+}
+
+// Palette for skinning, one get_joint_matrix entry for each joint in node order
+template <typename _palette>
+void get_joint_matrices(const Skeleton &a_skeleton, const std::vector<Transform> &a_world_transforms, std::vector<_palette> &a_joint_matrices)
+{
+	a_joint_matrices.resize(a_skeleton.joints_count());
+
+	for (unsigned int i = 0, j = 0; i < a_skeleton.size(); ++i)
+	{
+		if (a_skeleton.is_joint(i))
+		{
+			get_joint_matrix(a_skeleton, a_world_transforms[i], j, a_joint_matrices[j]);
+			++j;
+		}
+	}
+}
+
+// Compact palettes of a_level of a_lod, one entry per kept joint in AnimationLod::joints order
+// Meshes drawn with these need their joint indices remapped with AnimationLod::remap_vertex_joints
+template <typename _palette>
+void get_joint_matrices(const Skeleton &a_skeleton, const std::vector<Transform> &a_world_transforms, const AnimationLod &a_lod, unsigned int a_level,
+						std::vector<_palette> &a_joint_matrices)
+{
+	auto &joints      = a_lod.joints(a_level);
+	auto &joint_nodes = a_lod.joint_nodes(a_level);
+
+	a_joint_matrices.resize(joints.size());
+
+	for (size_t k = 0; k < joints.size(); ++k)
+		get_joint_matrix(a_skeleton, a_world_transforms[joint_nodes[k]], joints[k], a_joint_matrices[k]);
+}
+
+// Palette between two palettes of the same joints, for drawing between fixed rate animation ticks
+// Matrices are lerped element wise, which shears a little while joints rotate but is close at animation tick rates
+void interpolate_joint_matrices(const std::vector<ror::Matrix4f> &a_from, const std::vector<ror::Matrix4f> &a_to, float a_t, std::vector<ror::Matrix4f> &a_joint_matrices)
+{
+	assert(a_from.size() == a_to.size() && "Palettes don't match");
+
+	a_joint_matrices.resize(a_from.size());
+	simd_kernels().m_interpolate_batch(a_from.data()->m_values, a_to.data()->m_values, a_t, a_joint_matrices.data()->m_values, static_cast<unsigned int>(a_from.size() * 16));
+}
+
+void interpolate_joint_matrices(const std::vector<Matrix3x4> &a_from, const std::vector<Matrix3x4> &a_to, float a_t, std::vector<Matrix3x4> &a_joint_matrices)
+{
+	assert(a_from.size() == a_to.size() && "Palettes don't match");
+
+	a_joint_matrices.resize(a_from.size());
+	simd_kernels().m_interpolate_batch(a_from.data()->m_values, a_to.data()->m_values, a_t, a_joint_matrices.data()->m_values, static_cast<unsigned int>(a_from.size() * 12));
+}
+
+// Dual quaternions are blended in the same hemisphere and normalised, so the result stays a rigid transform
+void interpolate_joint_matrices(const std::vector<DualQuaternion> &a_from, const std::vector<DualQuaternion> &a_to, float a_t, std::vector<DualQuaternion> &a_joint_matrices)
+{
+	assert(a_from.size() == a_to.size() && "Palettes don't match");
+
+	a_joint_matrices.resize(a_from.size());
+
+	for (size_t i = 0; i < a_from.size(); ++i)
+	{
+		const DualQuaternion &from = a_from[i], &to = a_to[i];
+
+		float s = 1.0f - a_t;
+		float t = quaternion_dot(from.m_real, to.m_real) < 0.0f ? -a_t : a_t;
+
+		Quaternion real{from.m_real.x * s + to.m_real.x * t, from.m_real.y * s + to.m_real.y * t, from.m_real.z * s + to.m_real.z * t, from.m_real.w * s + to.m_real.w * t};
+		Quaternion dual{from.m_dual.x * s + to.m_dual.x * t, from.m_dual.y * s + to.m_dual.y * t, from.m_dual.z * s + to.m_dual.z * t, from.m_dual.w * s + to.m_dual.w * t};
+
+		float length = std::sqrt(quaternion_dot(real, real));
+
+		a_joint_matrices[i] = DualQuaternion{Quaternion{real.x / length, real.y / length, real.z / length, real.w / length},
+											 Quaternion{dual.x / length, dual.y / length, dual.z / length, dual.w / length}};
+	}
+}
+
 void add_vector(std::vector<float> &a_vertices, ror::Vector3f &&a_position, ror::Vector3f &&a_color,
 				std::vector<unsigned int> &a_indices, unsigned int a_index)
 {
@@ -0,0 +1,189 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "math/rormatrix4.hpp"
+#include "transform.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runtime skeleton in structure of arrays form, created once at load time from a node tree like AstroBoyTree
+// Hot data used by the per frame hierarchy walk is kept in tightly packed parallel arrays
+// Names are only needed for tools and debugging so live in their own cold table
+// Nodes must be added parent before child, so the hierarchy can be evaluated with one linear walk
+class Skeleton
+{
+  public:
+	Skeleton(){};
+
+	void reserve(unsigned int a_nodes_count)
+	{
+		this->m_parents.reserve(a_nodes_count);
+		this->m_joint_flags.reserve((a_nodes_count + 31) / 32);
+		this->m_local_binds.reserve(a_nodes_count);
+		this->m_inverse_binds.reserve(a_nodes_count);
+		this->m_inverse_bind_transforms.reserve(a_nodes_count);
+		this->m_rest_matrices.reserve(a_nodes_count);
+		this->m_names.reserve(a_nodes_count);
+	}
+
+	// a_local_bind_matrix is the same transform as a_local_bind, used to calculate the rest pose without decomposition error
+	void add_node(const char *a_name, int a_parent, bool a_is_joint, const Transform &a_local_bind, const ror::Matrix4f &a_local_bind_matrix, const ror::Matrix4f &a_inverse_bind)
+	{
+		unsigned int index = this->size();
+
+		assert(a_parent < static_cast<int>(index) && "Parent must be added before its children");
+		assert(index < INT16_MAX && "Too many nodes for int16_t parent indices");
+
+		if ((index & 31) == 0)
+			this->m_joint_flags.push_back(0);
+
+		if (a_is_joint)
+		{
+			this->m_joint_flags[index >> 5] |= 1u << (index & 31);
+			++this->m_joints_count;
+		}
+
+		this->m_parents.push_back(static_cast<int16_t>(a_parent));
+		this->m_local_binds.push_back(a_local_bind);
+		if (a_is_joint)
+		{
+			this->m_inverse_binds.push_back(this->m_bind_shape_identity ? a_inverse_bind : this->m_bind_shape * a_inverse_bind);
+			this->m_inverse_bind_transforms.push_back(transform_from_matrix(this->m_inverse_binds.back()));
+		}
+
+		this->m_rest_matrices.push_back(a_parent == -1 ? a_local_bind_matrix : this->m_rest_matrices[a_parent] * a_local_bind_matrix);
+		this->m_names.emplace_back(a_name);
+	}
+
+	// Bind shape matrix of the skin, must be set before adding nodes because its folded into the inverse binds
+	// Identity bind shapes (like astro boy's) are detected so no multiply happens at all
+	void set_bind_shape(const ror::Matrix4f &a_bind_shape)
+	{
+		assert(this->size() == 0 && "Bind shape must be set before adding nodes");
+
+		this->m_bind_shape          = a_bind_shape;
+		this->m_bind_shape_identity = true;
+
+		ror::Matrix4f identity;
+		for (int i = 0; i < 16; ++i)
+			if (std::abs(a_bind_shape.m_values[i] - identity.m_values[i]) > 1e-6f)
+				this->m_bind_shape_identity = false;
+	}
+
+	const ror::Matrix4f &bind_shape() const
+	{
+		return this->m_bind_shape;
+	}
+
+	bool bind_shape_identity() const
+	{
+		return this->m_bind_shape_identity;
+	}
+
+	unsigned int size() const
+	{
+		return static_cast<unsigned int>(this->m_parents.size());
+	}
+
+	unsigned int joints_count() const
+	{
+		return this->m_joints_count;
+	}
+
+	bool is_joint(unsigned int a_index) const
+	{
+		return (this->m_joint_flags[a_index >> 5] >> (a_index & 31)) & 1u;
+	}
+
+	int parent(unsigned int a_index) const
+	{
+		return this->m_parents[a_index];
+	}
+
+	const Transform &local_bind(unsigned int a_index) const
+	{
+		return this->m_local_binds[a_index];
+	}
+
+	// Indexed by joint not node, already includes the bind shape matrix, so world * inverse_bind is the skinning matrix
+	const ror::Matrix4f &joint_inverse_bind(unsigned int a_joint_index) const
+	{
+		return this->m_inverse_binds[a_joint_index];
+	}
+
+	// All joints_count() inverse binds contiguous in joint order, for batched palette building
+	const ror::Matrix4f *joint_inverse_binds() const
+	{
+		return this->m_inverse_binds.data();
+	}
+
+	// Decomposed joint_inverse_bind(), for palettes built directly from transforms like dual quaternions
+	const Transform &joint_inverse_bind_transform(unsigned int a_joint_index) const
+	{
+		return this->m_inverse_bind_transforms[a_joint_index];
+	}
+
+	// World matrix in bind pose, doesn't include the bind shape matrix
+	const ror::Matrix4f &rest_matrix(unsigned int a_index) const
+	{
+		return this->m_rest_matrices[a_index];
+	}
+
+	const std::string &name(unsigned int a_index) const
+	{
+		return this->m_names[a_index];
+	}
+
+	// Returns -1 if not found, linear search on the cold data, don't use per frame
+	int find(const std::string &a_name) const
+	{
+		for (size_t i = 0; i < this->m_names.size(); ++i)
+			if (this->m_names[i] == a_name)
+				return static_cast<int>(i);
+
+		return -1;
+	}
+
+  private:
+	// Hot data
+	std::vector<int16_t>       m_parents;              // -1 for root nodes
+	std::vector<uint32_t>      m_joint_flags;          // One bit per node, 0=NODE, 1=JOINT
+	std::vector<Transform>     m_local_binds;          // Local bind transforms, decomposed
+	std::vector<ror::Matrix4f> m_inverse_binds;                  // Bind shape * inverse bind matrices, one per joint
+	std::vector<Transform>     m_inverse_bind_transforms;        // Same as m_inverse_binds decomposed
+	unsigned int               m_joints_count = 0;
+
+	// Static data only used at load time or by tools, already in ror column-major layout
+	std::vector<ror::Matrix4f> m_rest_matrices;
+	ror::Matrix4f              m_bind_shape;
+	bool                       m_bind_shape_identity = true;
+
+	// Cold data
+	std::vector<std::string> m_names;
+};
@@ -0,0 +1,250 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation_track.hpp"
+#include "skeleton.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Per instance state of a StaticHierarchy, last sampled locals and which nodes changed in the last evaluate
+typedef struct
+{
+	std::vector<Transform> m_locals;                       // Per evaluated node, only animated ones are used
+	std::vector<uint8_t>   m_dirty;                        // Per evaluated node
+	KeyframeSpan           m_span{0, 0, -1.0f};            // Span of the last evaluate, a negative m_t means never evaluated
+	unsigned int           m_multiplies_count = 0;        // Transform multiplies done by the last evaluate
+} HierarchyState;
+
+// Hierarchy pass that only does the work that can change, classified once at load time from the skeleton and its tracks
+// Nodes that are neither animated nor under an animated node have a constant world transform, computed here once
+// Non joints without tracks under animated nodes, like *Orient and *End, are folded, their locals are pre-multiplied into their
+// children so they aren't evaluated at all. Every other node is evaluated, and only when its own track or an ancestor changed
+// World transforms of folded nodes aren't written, the palette only needs joints
+class StaticHierarchy
+{
+  public:
+	StaticHierarchy(){};
+
+	StaticHierarchy(const Skeleton &a_skeleton, const TrackTable &a_tracks)
+	{
+		unsigned int nodes_count = a_skeleton.size();
+
+		std::vector<bool> animated(nodes_count, false);        // Node or one of its ancestors has a track
+		std::vector<int>  slots(nodes_count, -1);              // Evaluated node index of each node
+		std::vector<int>  bases(nodes_count, -1);              // Closest evaluated node at or above each node
+		std::vector<bool> folds(nodes_count, false);           // Node is folded into its children
+
+		// Transform from the closest evaluated node above each node down to and including the node itself
+		std::vector<Transform> chains(nodes_count);
+
+		this->m_constant_worlds.resize(nodes_count);
+		this->m_full_multiplies_count = 0;
+
+		for (unsigned int i = 0; i < nodes_count; ++i)
+		{
+			int       parent = a_skeleton.parent(i);
+			Transform local  = a_skeleton.local_bind(i);
+
+			animated[i] = a_tracks.track(i) != -1 || (parent != -1 && animated[static_cast<unsigned int>(parent)]);
+
+			if (parent != -1)
+				++this->m_full_multiplies_count;
+
+			if (!animated[i])
+			{
+				this->m_constant_worlds[i] = parent == -1 ? local : transform_multiply(this->m_constant_worlds[static_cast<unsigned int>(parent)], local);
+				this->m_constant_nodes.push_back(static_cast<uint16_t>(i));
+				continue;
+			}
+
+			// Evaluated nodes above this one, -1 when everything above is constant
+			int base = parent != -1 ? bases[static_cast<unsigned int>(parent)] : -1;
+
+			// Prefix is whatever lies between the base and this node, the parent's constant world when there is no base
+			bool      has_prefix = false;
+			Transform prefix     = transform_identity();
+
+			if (parent != -1)
+			{
+				unsigned int p = static_cast<unsigned int>(parent);
+
+				if (!animated[p])
+				{
+					prefix     = this->m_constant_worlds[p];
+					has_prefix = true;
+				}
+				else if (folds[p])
+				{
+					prefix     = chains[p];
+					has_prefix = true;
+				}
+			}
+
+			if (a_tracks.track(i) == -1 && !a_skeleton.is_joint(i))
+			{
+				// Folded, its children pick up the chain
+				folds[i]  = true;
+				bases[i]  = base;
+				chains[i] = has_prefix ? transform_multiply(prefix, local) : local;
+				++this->m_folded_count;
+				continue;
+			}
+
+			Node node;
+			node.m_node  = static_cast<uint16_t>(i);
+			node.m_track = static_cast<int16_t>(a_tracks.track(i));
+			node.m_base  = base == -1 ? -1 : static_cast<int16_t>(slots[static_cast<unsigned int>(base)]);
+
+			// Static nodes have the local folded into the prefix as well, one multiply with the base world
+			if (node.m_track == -1)
+			{
+				node.m_prefix     = has_prefix ? transform_multiply(prefix, local) : local;
+				node.m_has_prefix = true;
+			}
+			else
+			{
+				node.m_prefix     = prefix;
+				node.m_has_prefix = has_prefix;
+			}
+
+			slots[i] = static_cast<int>(this->m_nodes.size());
+			bases[i] = static_cast<int>(i);
+			this->m_nodes.push_back(node);
+		}
+	}
+
+	// Updates a_world_transforms for a_span, a_state and a_world_transforms belong to one instance and must be the same every frame
+	void evaluate(const TrackTable &a_tracks, const KeyframeSpan &a_span, HierarchyState &a_state, std::vector<Transform> &a_world_transforms) const
+	{
+		bool first = a_state.m_span.m_t < 0.0f;
+
+		a_state.m_multiplies_count = 0;
+
+		if (first)
+		{
+			a_world_transforms.resize(this->m_constant_worlds.size());
+			a_state.m_locals.resize(this->m_nodes.size());
+			a_state.m_dirty.assign(this->m_nodes.size(), 1);
+
+			for (auto node : this->m_constant_nodes)
+				a_world_transforms[node] = this->m_constant_worlds[node];
+		}
+		else if (a_span.m_from == a_state.m_span.m_from && a_span.m_to == a_state.m_span.m_to && a_span.m_t == a_state.m_span.m_t)
+		{
+			// Paused or held, nothing can have changed
+			std::fill(a_state.m_dirty.begin(), a_state.m_dirty.end(), 0);
+			return;
+		}
+
+		a_state.m_span = a_span;
+
+		for (unsigned int i = 0; i < this->m_nodes.size(); ++i)
+		{
+			const Node &node  = this->m_nodes[i];
+			bool        dirty = first || (node.m_base != -1 && a_state.m_dirty[static_cast<unsigned int>(node.m_base)]);
+
+			if (node.m_track != -1)
+			{
+				Transform local = a_tracks.sample(node.m_track, a_span);
+
+				if (first || std::memcmp(&local, &a_state.m_locals[i], sizeof(Transform)) != 0)
+				{
+					a_state.m_locals[i] = local;
+					dirty               = true;
+				}
+			}
+
+			a_state.m_dirty[i] = dirty;
+
+			if (!dirty)
+				continue;
+
+			Transform &world = a_world_transforms[node.m_node];
+
+			if (node.m_track == -1)
+			{
+				world = transform_multiply(a_world_transforms[this->m_nodes[static_cast<unsigned int>(node.m_base)].m_node], node.m_prefix);
+				++a_state.m_multiplies_count;
+				continue;
+			}
+
+			world = a_state.m_locals[i];
+
+			if (node.m_has_prefix)
+			{
+				world = transform_multiply(node.m_prefix, world);
+				++a_state.m_multiplies_count;
+			}
+
+			if (node.m_base != -1)
+			{
+				world = transform_multiply(a_world_transforms[this->m_nodes[static_cast<unsigned int>(node.m_base)].m_node], world);
+				++a_state.m_multiplies_count;
+			}
+		}
+	}
+
+	// Multiplies done by evaluate_world_transforms every frame, one per node with a parent
+	unsigned int full_multiplies_count() const
+	{
+		return this->m_full_multiplies_count;
+	}
+
+	unsigned int evaluated_count() const
+	{
+		return static_cast<unsigned int>(this->m_nodes.size());
+	}
+
+	unsigned int constant_count() const
+	{
+		return static_cast<unsigned int>(this->m_constant_nodes.size());
+	}
+
+	unsigned int folded_count() const
+	{
+		return this->m_folded_count;
+	}
+
+  private:
+	typedef struct
+	{
+		Transform m_prefix;              // Folded chain above an animated node, or the whole chain including the local of a static node
+		uint16_t  m_node;
+		int16_t   m_track;               // -1 for static nodes
+		int16_t   m_base;                // Evaluated node the prefix hangs off, -1 when it's constant
+		bool      m_has_prefix;
+	} Node;
+
+	std::vector<Node>      m_nodes;                  // Evaluated nodes, parent before child
+	std::vector<uint16_t>  m_constant_nodes;
+	std::vector<Transform> m_constant_worlds;        // Per node, only valid for constant nodes
+	unsigned int           m_folded_count          = 0;
+	unsigned int           m_full_multiplies_count = 0;
+};
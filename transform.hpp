@@ -0,0 +1,327 @@
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2019
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "math/rormatrix4.hpp"
+#include "math/rorvector3.hpp"
+#include <cmath>
+
+// Unit quaternion, (x, y, z) is the vector part and w the scalar part
+typedef struct
+{
+	float x, y, z, w;
+} Quaternion;
+
+// Decomposed QVV transform, 40 bytes instead of 64 for a full matrix
+// Order of application is scale, then rotate, then translate
+typedef struct
+{
+	Quaternion    m_rotation;
+	ror::Vector3f m_translation;
+	ror::Vector3f m_scale;
+} Transform;
+
+// Affine matrix stored as its top three rows, row-major, the last row is always 0, 0, 0, 1
+// Same layout as three std140 vec4s so palettes upload as is, 48 bytes instead of 64 per joint
+typedef struct
+{
+	float m_values[12];
+} Matrix3x4;
+
+// Unit dual quaternion for rigid transforms, m_dual is 0.5 * translation * m_real
+// 32 bytes per joint and blends without the volume loss of linear blend skinning, scale can't be represented
+typedef struct
+{
+	Quaternion m_real;
+	Quaternion m_dual;
+} DualQuaternion;
+
+Quaternion quaternion_identity()
+{
+	return Quaternion{0.0f, 0.0f, 0.0f, 1.0f};
+}
+
+Transform transform_identity()
+{
+	return Transform{quaternion_identity(), ror::Vector3f(0.0f, 0.0f, 0.0f), ror::Vector3f(1.0f, 1.0f, 1.0f)};
+}
+
+float quaternion_dot(const Quaternion &a_left, const Quaternion &a_right)
+{
+	return a_left.x * a_right.x + a_left.y * a_right.y + a_left.z * a_right.z + a_left.w * a_right.w;
+}
+
+Quaternion quaternion_normalize(const Quaternion &a_quaternion)
+{
+	float length = std::sqrt(quaternion_dot(a_quaternion, a_quaternion));
+
+	if (length <= 0.0f)
+		return quaternion_identity();
+
+	float inverse = 1.0f / length;
+	return Quaternion{a_quaternion.x * inverse, a_quaternion.y * inverse, a_quaternion.z * inverse, a_quaternion.w * inverse};
+}
+
+Quaternion quaternion_multiply(const Quaternion &a_left, const Quaternion &a_right)
+{
+	return Quaternion{a_left.w * a_right.x + a_left.x * a_right.w + a_left.y * a_right.z - a_left.z * a_right.y,
+					  a_left.w * a_right.y - a_left.x * a_right.z + a_left.y * a_right.w + a_left.z * a_right.x,
+					  a_left.w * a_right.z + a_left.x * a_right.y - a_left.y * a_right.x + a_left.z * a_right.w,
+					  a_left.w * a_right.w - a_left.x * a_right.x - a_left.y * a_right.y - a_left.z * a_right.z};
+}
+
+ror::Vector3f quaternion_rotate(const Quaternion &a_quaternion, const ror::Vector3f &a_vector)
+{
+	// v' = v + w * t + q.xyz x t, where t = 2 * (q.xyz x v)
+	float tx = 2.0f * (a_quaternion.y * a_vector.z - a_quaternion.z * a_vector.y);
+	float ty = 2.0f * (a_quaternion.z * a_vector.x - a_quaternion.x * a_vector.z);
+	float tz = 2.0f * (a_quaternion.x * a_vector.y - a_quaternion.y * a_vector.x);
+
+	return ror::Vector3f(a_vector.x + a_quaternion.w * tx + (a_quaternion.y * tz - a_quaternion.z * ty),
+						 a_vector.y + a_quaternion.w * ty + (a_quaternion.z * tx - a_quaternion.x * tz),
+						 a_vector.z + a_quaternion.w * tz + (a_quaternion.x * ty - a_quaternion.y * tx));
+}
+
+// Normalized lerp, takes the shortest path, good enough for closely spaced keyframes
+Quaternion quaternion_nlerp(const Quaternion &a_from, const Quaternion &a_to, float a_t)
+{
+	float sign = quaternion_dot(a_from, a_to) < 0.0f ? -1.0f : 1.0f;
+	float s    = 1.0f - a_t;
+	float t    = a_t * sign;
+
+	return quaternion_normalize(Quaternion{a_from.x * s + a_to.x * t, a_from.y * s + a_to.y * t, a_from.z * s + a_to.z * t, a_from.w * s + a_to.w * t});
+}
+
+// Constant angular velocity version, falls back to nlerp when the two are very close
+Quaternion quaternion_slerp(const Quaternion &a_from, const Quaternion &a_to, float a_t)
+{
+	float cosine = quaternion_dot(a_from, a_to);
+	float sign   = 1.0f;
+
+	if (cosine < 0.0f)
+	{
+		cosine = -cosine;
+		sign   = -1.0f;
+	}
+
+	if (cosine > 0.9995f)
+		return quaternion_nlerp(a_from, a_to, a_t);
+
+	float angle = std::acos(cosine);
+	float sine  = std::sin(angle);
+	float s     = std::sin((1.0f - a_t) * angle) / sine;
+	float t     = std::sin(a_t * angle) / sine * sign;
+
+	return Quaternion{a_from.x * s + a_to.x * t, a_from.y * s + a_to.y * t, a_from.z * s + a_to.z * t, a_from.w * s + a_to.w * t};
+}
+
+ror::Vector3f vector3_lerp(const ror::Vector3f &a_from, const ror::Vector3f &a_to, float a_t)
+{
+	return ror::Vector3f(a_from.x + (a_to.x - a_from.x) * a_t,
+						 a_from.y + (a_to.y - a_from.y) * a_t,
+						 a_from.z + (a_to.z - a_from.z) * a_t);
+}
+
+// Decomposes an affine column-major matrix, shear is dropped
+Transform transform_from_matrix(const ror::Matrix4f &a_matrix)
+{
+	const float *m = a_matrix.m_values;
+
+	Transform transform;
+	transform.m_translation = ror::Vector3f(m[12], m[13], m[14]);
+	transform.m_scale       = ror::Vector3f(std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]),
+                                      std::sqrt(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]),
+                                      std::sqrt(m[8] * m[8] + m[9] * m[9] + m[10] * m[10]));
+
+	// Mirrored matrices have negative determinant, put that into scale so whats left is a pure rotation
+	float determinant = m[0] * (m[5] * m[10] - m[6] * m[9]) - m[4] * (m[1] * m[10] - m[2] * m[9]) + m[8] * (m[1] * m[6] - m[2] * m[5]);
+	if (determinant < 0.0f)
+		transform.m_scale.x = -transform.m_scale.x;
+
+	float sx = transform.m_scale.x != 0.0f ? 1.0f / transform.m_scale.x : 0.0f;
+	float sy = transform.m_scale.y != 0.0f ? 1.0f / transform.m_scale.y : 0.0f;
+	float sz = transform.m_scale.z != 0.0f ? 1.0f / transform.m_scale.z : 0.0f;
+
+	// rRC is row R column C of the rotation part
+	float r00 = m[0] * sx, r10 = m[1] * sx, r20 = m[2] * sx;
+	float r01 = m[4] * sy, r11 = m[5] * sy, r21 = m[6] * sy;
+	float r02 = m[8] * sz, r12 = m[9] * sz, r22 = m[10] * sz;
+
+	Quaternion &q     = transform.m_rotation;
+	float       trace = r00 + r11 + r22;
+
+	if (trace > 0.0f)
+	{
+		float s = std::sqrt(trace + 1.0f) * 2.0f;
+		q       = Quaternion{(r21 - r12) / s, (r02 - r20) / s, (r10 - r01) / s, 0.25f * s};
+	}
+	else if (r00 > r11 && r00 > r22)
+	{
+		float s = std::sqrt(1.0f + r00 - r11 - r22) * 2.0f;
+		q       = Quaternion{0.25f * s, (r01 + r10) / s, (r02 + r20) / s, (r21 - r12) / s};
+	}
+	else if (r11 > r22)
+	{
+		float s = std::sqrt(1.0f + r11 - r00 - r22) * 2.0f;
+		q       = Quaternion{(r01 + r10) / s, 0.25f * s, (r12 + r21) / s, (r02 - r20) / s};
+	}
+	else
+	{
+		float s = std::sqrt(1.0f + r22 - r00 - r11) * 2.0f;
+		q       = Quaternion{(r02 + r20) / s, (r12 + r21) / s, 0.25f * s, (r10 - r01) / s};
+	}
+
+	q = quaternion_normalize(q);
+
+	return transform;
+}
+
+ror::Matrix4f transform_to_matrix(const Transform &a_transform)
+{
+	const Quaternion &q = a_transform.m_rotation;
+
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	const ror::Vector3f &s = a_transform.m_scale;
+	const ror::Vector3f &t = a_transform.m_translation;
+
+	ror::Matrix4f matrix;
+	float *       m = matrix.m_values;
+
+	m[0]  = (1.0f - 2.0f * (yy + zz)) * s.x;
+	m[1]  = (2.0f * (xy + wz)) * s.x;
+	m[2]  = (2.0f * (xz - wy)) * s.x;
+	m[3]  = 0.0f;
+	m[4]  = (2.0f * (xy - wz)) * s.y;
+	m[5]  = (1.0f - 2.0f * (xx + zz)) * s.y;
+	m[6]  = (2.0f * (yz + wx)) * s.y;
+	m[7]  = 0.0f;
+	m[8]  = (2.0f * (xz + wy)) * s.z;
+	m[9]  = (2.0f * (yz - wx)) * s.z;
+	m[10] = (1.0f - 2.0f * (xx + yy)) * s.z;
+	m[11] = 0.0f;
+	m[12] = t.x;
+	m[13] = t.y;
+	m[14] = t.z;
+	m[15] = 1.0f;
+
+	return matrix;
+}
+
+// Concatenates a_parent * a_child, scale is treated per axis without creating shear which is exact for uniform scales
+Transform transform_multiply(const Transform &a_parent, const Transform &a_child)
+{
+	ror::Vector3f scaled(a_child.m_translation.x * a_parent.m_scale.x,
+						 a_child.m_translation.y * a_parent.m_scale.y,
+						 a_child.m_translation.z * a_parent.m_scale.z);
+
+	return Transform{quaternion_multiply(a_parent.m_rotation, a_child.m_rotation),
+					 a_parent.m_translation + quaternion_rotate(a_parent.m_rotation, scaled),
+					 ror::Vector3f(a_parent.m_scale.x * a_child.m_scale.x, a_parent.m_scale.y * a_child.m_scale.y, a_parent.m_scale.z * a_child.m_scale.z)};
+}
+
+Transform transform_interpolate(const Transform &a_from, const Transform &a_to, float a_t)
+{
+	return Transform{quaternion_nlerp(a_from.m_rotation, a_to.m_rotation, a_t),
+					 vector3_lerp(a_from.m_translation, a_to.m_translation, a_t),
+					 vector3_lerp(a_from.m_scale, a_to.m_scale, a_t)};
+}
+
+Matrix3x4 matrix3x4_from_matrix4(const ror::Matrix4f &a_matrix)
+{
+	const float *m = a_matrix.m_values;
+
+	return Matrix3x4{{m[0], m[4], m[8], m[12],
+					  m[1], m[5], m[9], m[13],
+					  m[2], m[6], m[10], m[14]}};
+}
+
+ror::Matrix4f matrix3x4_to_matrix4(const Matrix3x4 &a_matrix)
+{
+	const float * r = a_matrix.m_values;
+	ror::Matrix4f matrix;
+	float *       m = matrix.m_values;
+
+	for (unsigned int c = 0; c < 4; ++c)
+	{
+		m[c * 4 + 0] = r[c];
+		m[c * 4 + 1] = r[4 + c];
+		m[c * 4 + 2] = r[8 + c];
+		m[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+	}
+
+	return matrix;
+}
+
+// a_left * a_right where a_right is an affine column-major matrix, only three rows are calculated
+Matrix3x4 matrix3x4_multiply(const Matrix3x4 &a_left, const ror::Matrix4f &a_right)
+{
+	const float *l = a_left.m_values;
+	const float *r = a_right.m_values;
+
+	Matrix3x4 matrix;
+	float *   m = matrix.m_values;
+
+	for (unsigned int row = 0; row < 3; ++row)
+	{
+		const float *left_row = l + row * 4;
+
+		for (unsigned int c = 0; c < 3; ++c)
+			m[row * 4 + c] = left_row[0] * r[c * 4] + left_row[1] * r[c * 4 + 1] + left_row[2] * r[c * 4 + 2];
+
+		m[row * 4 + 3] = left_row[0] * r[12] + left_row[1] * r[13] + left_row[2] * r[14] + left_row[3];
+	}
+
+	return matrix;
+}
+
+Matrix3x4 transform_to_matrix3x4(const Transform &a_transform)
+{
+	const Quaternion &q = a_transform.m_rotation;
+
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	const ror::Vector3f &s = a_transform.m_scale;
+	const ror::Vector3f &t = a_transform.m_translation;
+
+	return Matrix3x4{{(1.0f - 2.0f * (yy + zz)) * s.x, (2.0f * (xy - wz)) * s.y, (2.0f * (xz + wy)) * s.z, t.x,
+					  (2.0f * (xy + wz)) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, (2.0f * (yz - wx)) * s.z, t.y,
+					  (2.0f * (xz - wy)) * s.x, (2.0f * (yz + wx)) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z}};
+}
+
+// Scale is dropped, a_transform should be rigid
+DualQuaternion dual_quaternion_from_transform(const Transform &a_transform)
+{
+	const Quaternion &   real        = a_transform.m_rotation;
+	const ror::Vector3f &translation = a_transform.m_translation;
+
+	Quaternion dual = quaternion_multiply(Quaternion{translation.x, translation.y, translation.z, 0.0f}, real);
+
+	return DualQuaternion{real, Quaternion{dual.x * 0.5f, dual.y * 0.5f, dual.z * 0.5f, dual.w * 0.5f}};
+}